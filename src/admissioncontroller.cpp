@@ -0,0 +1,113 @@
+#include "admissioncontroller.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+  AdmissionLimits normalize(AdmissionLimits limits) noexcept {
+    limits.maxInFlight_ = max<size_t>(limits.maxInFlight_, 1);
+    return limits;
+  }
+}
+
+AdmissionController::Ticket::Ticket(AdmissionController* controller,
+  const Outcome outcome) noexcept : controller_(controller), outcome_(outcome) { }
+
+AdmissionController::Ticket::Ticket(Ticket&& other) noexcept :
+  controller_(other.controller_), outcome_(other.outcome_) {
+  other.controller_ = nullptr;
+}
+
+AdmissionController::Ticket::~Ticket() {
+  if (controller_ != nullptr && outcome_ == Outcome::admitted) {
+    controller_->release();
+  }
+}
+
+AdmissionController::AdmissionController(const AdmissionLimits& limits) :
+  limits_(normalize(limits)) { }
+
+AdmissionController::Ticket AdmissionController::admit() {
+  ServerMetrics& metrics = ServerMetrics::instance();
+  unique_lock lock(mutex_);
+  if (inFlight_ < limits_.maxInFlight_ && queue_.empty()) {
+    ++inFlight_;
+    return Ticket(this, Outcome::admitted);
+  }
+  if (queue_.size() >= limits_.maxQueued_) {
+    metrics.queueFullRejections_.increment();
+    return Ticket(this, Outcome::queueFull);
+  }
+
+  Waiter waiter;
+  queue_.push_back(&waiter);
+  metrics.admissionQueueDepth_.add(1);
+  const bool admitted = waiter.condition_.wait_for(lock, limits_.maxQueueTime_,
+    [&waiter] { return waiter.admitted_; });
+  if (! admitted) {
+    // The waiter is still queued, as release() removes the waiters it admits.
+    queue_.erase(find(queue_.begin(), queue_.end(), &waiter));
+    metrics.admissionQueueDepth_.add(-1);
+    metrics.queueTimeoutRejections_.increment();
+    return Ticket(this, Outcome::queueTimeout);
+  }
+  return Ticket(this, Outcome::admitted);
+}
+
+void AdmissionController::release() noexcept {
+  lock_guard lock(mutex_);
+  if (queue_.empty()) {
+    --inFlight_;
+    return;
+  }
+  // The slot is handed over to the oldest waiter, so inFlight_ is unchanged.
+  Waiter* waiter = queue_.front();
+  queue_.pop_front();
+  ServerMetrics::instance().admissionQueueDepth_.add(-1);
+  waiter->admitted_ = true;
+  waiter->condition_.notify_one();
+}
+
+size_t AdmissionController::numberOfRequestsInFlight() const {
+  lock_guard lock(mutex_);
+  return inFlight_;
+}
+
+size_t AdmissionController::numberOfQueuedRequests() const {
+  lock_guard lock(mutex_);
+  return queue_.size();
+}
+
+long AdmissionController::retryAfterSeconds() const noexcept {
+  const auto queueTime = chrono::ceil<chrono::seconds>(limits_.maxQueueTime_).count();
+  return max<long>(static_cast<long>(queueTime), 1);
+}
+
+Bulkhead::Entry::Entry(Bulkhead* bulkhead) noexcept :
+  bulkhead_(bulkhead), admitted_(bulkhead == nullptr || bulkhead->tryEnter()) { }
+
+Bulkhead::Entry::~Entry() {
+  if (bulkhead_ != nullptr && admitted_) {
+    bulkhead_->leave();
+  }
+}
+
+Bulkhead::Bulkhead(const size_t maxConcurrentCalls) noexcept :
+  maxConcurrentCalls_(max<size_t>(maxConcurrentCalls, 1)) { }
+
+bool Bulkhead::tryEnter() noexcept {
+  size_t calls = calls_.load(memory_order_relaxed);
+  do {
+    if (calls >= maxConcurrentCalls_) {
+      return false;
+    }
+  } while (! calls_.compare_exchange_weak(calls, calls + 1, memory_order_acquire,
+    memory_order_relaxed));
+  return true;
+}
+
+void Bulkhead::leave() noexcept {
+  calls_.fetch_sub(1, memory_order_release);
+}
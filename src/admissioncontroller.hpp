@@ -0,0 +1,115 @@
+#pragma once
+
+#include "globals.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+/// @brief The limits of an AdmissionController.
+struct AdmissionLimits {
+  /// The maximum number of requests that are processed at the same time, at least 1.
+  std::size_t maxInFlight_ { globals::DEFAULT_MAX_REQUESTS_IN_FLIGHT };
+  /// The maximum number of requests that wait for one of the requests in flight to finish.
+  std::size_t maxQueued_ { globals::DEFAULT_MAX_QUEUED_REQUESTS };
+  /// The maximum time a request waits in the queue.
+  std::chrono::milliseconds maxQueueTime_ { globals::DEFAULT_MAX_QUEUE_TIME_IN_MILLISECONDS };
+};
+
+/// @brief Bounds the number of requests that are processed at the same time.
+///
+/// A request that arrives while the maximum number of requests is in flight waits in a FIFO
+/// queue. It is rejected at once if the queue is full, and rejected when its time in the queue
+/// exceeds the deadline. Rejecting requests early under overload keeps the latency of the
+/// admitted requests bounded, instead of slowing down all requests until they time out.
+class AdmissionController {
+public:
+  enum class Outcome {
+    admitted, queueFull, queueTimeout
+  };
+
+  /// @brief The admission of a request, which releases its slot on destruction.
+  class Ticket {
+  public:
+    Ticket(Ticket&& other) noexcept;
+    Ticket& operator=(Ticket&&) = delete;
+    ~Ticket();
+
+    Outcome outcome() const noexcept { return outcome_; }
+    bool isAdmitted() const noexcept { return outcome_ == Outcome::admitted; }
+
+  private:
+    friend class AdmissionController;
+    Ticket(AdmissionController* controller, const Outcome outcome) noexcept;
+
+    AdmissionController* controller_;
+    const Outcome outcome_;
+  };
+
+  explicit AdmissionController(const AdmissionLimits& limits);
+
+  /// @brief Admits a request, waiting in the queue if necessary.
+  /// @return a ticket, whose outcome tells whether the request may be processed.
+  Ticket admit();
+
+  std::size_t numberOfRequestsInFlight() const;
+  std::size_t numberOfQueuedRequests() const;
+
+  /// @brief The number of seconds after which a rejected client should retry.
+  long retryAfterSeconds() const noexcept;
+
+  AdmissionController(const AdmissionController&) = delete;
+  AdmissionController& operator=(const AdmissionController&) = delete;
+
+private:
+  struct Waiter {
+    std::condition_variable condition_;
+    bool admitted_ { false };
+  };
+
+  void release() noexcept;
+
+  const AdmissionLimits limits_;
+  mutable std::mutex mutex_;
+  std::size_t inFlight_ { 0 };
+  std::deque<Waiter*> queue_;
+};
+
+/// @brief Limits the number of concurrent calls of a MCP tool, so that a slow tool cannot
+/// occupy all threads of the server. Calls beyond the limit are rejected at once.
+class Bulkhead {
+public:
+  /// @brief The entry of a call into a bulkhead, which it leaves on destruction.
+  class Entry {
+  public:
+    /// @param bulkhead may be nullptr, in which case the call is always admitted.
+    explicit Entry(Bulkhead* bulkhead) noexcept;
+    ~Entry();
+
+    bool isAdmitted() const noexcept { return admitted_; }
+
+    Entry(const Entry&) = delete;
+    Entry& operator=(const Entry&) = delete;
+
+  private:
+    Bulkhead* const bulkhead_;
+    const bool admitted_;
+  };
+
+  explicit Bulkhead(const std::size_t maxConcurrentCalls) noexcept;
+
+  std::size_t maxConcurrentCalls() const noexcept { return maxConcurrentCalls_; }
+
+  Bulkhead(const Bulkhead&) = delete;
+  Bulkhead& operator=(const Bulkhead&) = delete;
+
+private:
+  bool tryEnter() noexcept;
+  void leave() noexcept;
+
+  const std::size_t maxConcurrentCalls_;
+  std::atomic<std::size_t> calls_ { 0 };
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "requestarena.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/// The JSON type used throughout the server. Objects and arrays are allocated by the
+/// ArenaAllocator, so all JSON built while processing a request lives in the request's arena
+/// (see ArenaScope); strings use the global allocator.
+using json = nlohmann::basic_json<std::map, std::vector, std::string, bool, std::int64_t,
+  std::uint64_t, double, ArenaAllocator>;
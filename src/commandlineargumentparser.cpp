@@ -1,4 +1,8 @@
 #include "commandlineargumentparser.hpp"
+#include "globals.hpp"
+
+#include <charconv>
+#include <stdexcept>
 
 CommandLineArgumentParser::CommandLineArgumentParser(const std::string_view applicationName,
     const std::string_view applicationVersion) :
@@ -14,15 +18,40 @@ ProgramOptions CommandLineArgumentParser::parse(int argc, const char** argv) con
   options.sysmlv2ApiUrl_ = parser.get("apiurl");
   options.mcpTransportUrl_ = parser.get("serverurl");
   options.mcpTransportKind_ = determineMcpTransportKind(parser.get("transport"));
+  options.unixSocketPath_ = parser.get("socketpath");
+  options.allowedPeerUids_ = determineAllowedPeerUids(parser.get("allowuids"));
   options.logLevel_ = determineLogLevel(parser.get("loglevel"));
   options.logFileName_ = parser.get("logfile");
+  options.maxLoggedPayloadSize_ = parser.get<std::size_t>("logpayloadsize");
+  options.payloadLogSampling_ = parser.get<unsigned int>("logsampling");
+  options.traceFileName_ = parser.get("tracefile");
+  options.traceSampling_ = parser.get<unsigned int>("tracesampling");
+  options.upstreamRecordFileName_ = parser.get("record");
+  options.upstreamReplayFileName_ = parser.get("replay");
+  const std::string replayLatency = parser.get("replaylatency");
+  options.replayRecordedLatency_ = replayLatency == "recorded";
+  options.replayLatencyInMilliseconds_ = options.replayRecordedLatency_ ? 0 :
+    determineReplayLatency(replayLatency);
+  options.hedgingPercentile_ = parser.get<double>("hedge");
+  if (options.hedgingPercentile_ < 0.0 || options.hedgingPercentile_ > 100.0) {
+    throw std::runtime_error("Invalid percentile in --hedge: '" +
+      std::to_string(options.hedgingPercentile_) + "'");
+  }
+  options.hedgingBudgetInPercent_ = parser.get<double>("hedgebudget");
+  options.maxUpstreamConcurrency_ = parser.get<std::size_t>("maxupstreamconcurrency");
+  options.minCompressedRequestSize_ = parser.get<std::size_t>("compressrequests");
+  options.maxRequestsInFlight_ = parser.get<std::size_t>("maxinflight");
+  options.maxQueuedRequests_ = parser.get<std::size_t>("maxqueued");
+  options.maxQueueTimeInMilliseconds_ = parser.get<unsigned int>("queuetimeout");
+  options.minCompressedResponseSize_ = parser.get<std::size_t>("compressresponses");
   return options;
 }
 
 void CommandLineArgumentParser::addArgumentsToParser(argparse::ArgumentParser &parser) const {
   parser.add_argument("-t", "--transport")
-    .help("defines the transport layer for MCP requests/responses. Can be either one of the\n"
-          "values 'stdinout' or 'http'.")
+    .help("defines the transport layer for MCP requests/responses. Can be one of the values\n"
+          "'stdinout', 'http', 'epoll' (HTTP served by a native Linux event loop) or 'unix'\n"
+          "(newline-delimited JSON-RPC via a Unix domain socket, Linux only).")
     .required()
     .default_value("http");
 
@@ -33,37 +62,176 @@ void CommandLineArgumentParser::addArgumentsToParser(argparse::ArgumentParser &p
     .required()
     .default_value("127.0.0.1:8080");
 
+  parser.add_argument("--socketpath")
+    .help("the file system path of the Unix domain socket if 'unix' is chosen as MCP transport.")
+    .default_value(std::string(globals::DEFAULT_UNIX_SOCKET_PATH));
+
+  parser.add_argument("--allowuids")
+    .help("a comma-separated list of user ids that are allowed to connect if 'unix' is chosen as\n"
+          "MCP transport, e.g. '1000,1001'. Only the user running the server may connect if no list\n"
+          "has been specified.")
+    .default_value(std::string());
+
   parser.add_argument("-a", "--apiurl")
     .help("the uniform resource locator (URL) specifying the address of a REST endpoint providing\n"
           "a SysML v2 API for accessing models. Examples: 'http://api.hostname.tld', 'http://sysml2.domain.com:9000'.\n"
+          "A comma-separated list of URLs names a primary followed by its read replicas, e.g.\n"
+          "'http://primary:9000,http://replica1:9000'. Reads are balanced across all of them, writes go to the primary.\n"
           "Default is 'http://127.0.0.1:9000' if no explicit URL has been specified.")
     .required()
     .default_value("http://sysml2.intercax.com:9000");
 
   parser.add_argument("-l", "--loglevel")
-    .help("the log level, which defines the scope (verbosity) of logging. Can be INFO, WARN or ERROR.\n"
+    .help("the log level, which defines the scope (verbosity) of logging. Can be TRACE, DEBUG, INFO,\n"
+          "WARN or ERROR. Request and response payloads are only logged at the levels TRACE and DEBUG.\n"
           "ERROR is the default log level if no explicit level has been specified.")
     .default_value("ERROR");
 
   parser.add_argument("-f", "--logfile")
     .help("the name of the logfile.")
     .default_value("mcpsrv_logfile.log");
+
+  parser.add_argument("--logpayloadsize")
+    .help("the maximum number of characters of a request or response payload that are written into\n"
+          "the log. Longer payloads are truncated.")
+    .default_value(globals::DEFAULT_MAX_LOGGED_PAYLOAD_SIZE)
+    .scan<'u', std::size_t>();
+
+  parser.add_argument("--logsampling")
+    .help("logs only every n-th request or response payload, e.g. '100'. All payloads are logged\n"
+          "by default.")
+    .default_value(1u)
+    .scan<'u', unsigned int>();
+
+  parser.add_argument("--tracefile")
+    .help("the name of a file to which the phases of MCP requests are written as a trace in the\n"
+          "Chrome trace event format (viewable with chrome://tracing or Perfetto). Requests are\n"
+          "not traced if no file has been specified.")
+    .default_value(std::string());
+
+  parser.add_argument("--tracesampling")
+    .help("traces only every n-th MCP request, e.g. '100'. All requests are traced by default.")
+    .default_value(1u)
+    .scan<'u', unsigned int>();
+
+  parser.add_argument("--record")
+    .help("the name of a file to which all requests to the SysML v2 API and their responses are\n"
+          "written, so that they can be replayed later with --replay.")
+    .default_value(std::string());
+
+  parser.add_argument("--replay")
+    .help("the name of a file recorded with --record from which requests to the SysML v2 API are\n"
+          "answered. The SysML v2 API is not accessed, requests that have not been recorded fail.")
+    .default_value(std::string());
+
+  parser.add_argument("--replaylatency")
+    .help("the latency of replayed responses, either in milliseconds, e.g. '20', or 'recorded' for\n"
+          "the latency with which each response has been recorded. Default is '0'.")
+    .default_value(std::string("0"));
+
+  parser.add_argument("--hedge")
+    .help("the percentile of the recent latencies of reads from the SysML v2 API, e.g. '95', after\n"
+          "which a read is sent a second time on another connection. The first response is taken.\n"
+          "Reads are not hedged by default.")
+    .default_value(0.0)
+    .scan<'g', double>();
+
+  parser.add_argument("--hedgebudget")
+    .help("the maximum number of hedged reads in percent of all reads, e.g. '5' (the default).")
+    .default_value(globals::DEFAULT_HEDGING_BUDGET * 100.0)
+    .scan<'g', double>();
+
+  parser.add_argument("--maxupstreamconcurrency")
+    .help("the upper bound of the adaptive limit of concurrent requests to each server of the\n"
+          "SysML v2 API. Further requests wait until a request is done. '0' disables the limit.")
+    .default_value(globals::DEFAULT_MAX_UPSTREAM_CONCURRENCY)
+    .scan<'u', std::size_t>();
+
+  parser.add_argument("--compressrequests")
+    .help("the minimum size in bytes, e.g. '8192', from which the bodies of requests to the SysML v2\n"
+          "API (commits, queries) are compressed with gzip. The API must accept gzip-encoded\n"
+          "requests. Request bodies are not compressed by default.")
+    .default_value(std::size_t { 0 })
+    .scan<'u', std::size_t>();
+
+  parser.add_argument("--maxinflight")
+    .help("the maximum number of MCP requests that are processed at the same time if 'http' is\n"
+          "chosen as MCP transport. Further requests wait in a queue.")
+    .default_value(globals::DEFAULT_MAX_REQUESTS_IN_FLIGHT)
+    .scan<'u', std::size_t>();
+
+  parser.add_argument("--maxqueued")
+    .help("the maximum number of MCP requests that wait to be processed if 'http' is chosen as\n"
+          "MCP transport. Requests beyond are rejected at once with HTTP status 503.")
+    .default_value(globals::DEFAULT_MAX_QUEUED_REQUESTS)
+    .scan<'u', std::size_t>();
+
+  parser.add_argument("--queuetimeout")
+    .help("the maximum number of milliseconds a MCP request waits to be processed if 'http' is\n"
+          "chosen as MCP transport. Requests waiting longer are rejected with HTTP status 503.")
+    .default_value(globals::DEFAULT_MAX_QUEUE_TIME_IN_MILLISECONDS)
+    .scan<'u', unsigned int>();
+
+  parser.add_argument("--compressresponses")
+    .help("the minimum size in bytes from which responses to MCP requests are compressed with gzip\n"
+          "or zstd, if 'http' is chosen as MCP transport and the client accepts it. Default is\n"
+          "'4096', '0' disables the compression.")
+    .default_value(globals::DEFAULT_MIN_COMPRESSED_RESPONSE_SIZE)
+    .scan<'u', std::size_t>();
 }
 
 McpTransportKind CommandLineArgumentParser::determineMcpTransportKind(const std::string_view parsedTransport) const {
   if (parsedTransport == "stdinout") {
     return McpTransportKind::stdinout;
+  } else if (parsedTransport == "epoll") {
+    return McpTransportKind::epoll;
+  } else if (parsedTransport == "unix") {
+    return McpTransportKind::unixsocket;
   } else {
     return McpTransportKind::http;
   }
 }
 
 LogLevel CommandLineArgumentParser::determineLogLevel(const std::string_view parsedLogLevel) const {
-  if (parsedLogLevel == "INFO") {
+  if (parsedLogLevel == "TRACE") {
+    return LogLevel::trace;
+  } else if (parsedLogLevel == "DEBUG") {
+    return LogLevel::debug;
+  } else if (parsedLogLevel == "INFO") {
     return LogLevel::info;
   } else if (parsedLogLevel == "WARN") {
     return LogLevel::warn;
   } else {
     return LogLevel::error;
   }
+}
+
+std::vector<uint32_t> CommandLineArgumentParser::determineAllowedPeerUids(
+  const std::string_view parsedUids) const {
+  std::vector<uint32_t> uids;
+  std::string_view remainder = parsedUids;
+  while (! remainder.empty()) {
+    const auto comma = remainder.find(',');
+    const std::string_view token = remainder.substr(0, comma);
+    uint32_t uid { 0 };
+    const auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), uid);
+    if (ec != std::errc() || ptr != token.data() + token.size()) {
+      throw std::runtime_error("Invalid user id in --allowuids: '" + std::string(token) + "'");
+    }
+    uids.push_back(uid);
+    remainder = comma == std::string_view::npos ? std::string_view() : remainder.substr(comma + 1);
+  }
+  return uids;
+}
+
+unsigned int CommandLineArgumentParser::determineReplayLatency(
+  const std::string_view parsedLatency) const {
+  unsigned int latency { 0 };
+  const auto [ptr, ec] = std::from_chars(parsedLatency.data(),
+    parsedLatency.data() + parsedLatency.size(), latency);
+  if (ec != std::errc() || ptr != parsedLatency.data() + parsedLatency.size()) {
+    throw std::runtime_error("Invalid latency in --replaylatency: '" + std::string(parsedLatency) +
+      "'");
+  }
+  return latency;
 }
\ No newline at end of file
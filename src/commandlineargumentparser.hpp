@@ -23,6 +23,8 @@ private:
   void addArgumentsToParser(argparse::ArgumentParser& parser) const;
   McpTransportKind determineMcpTransportKind(const std::string_view parsedTransport) const;
   LogLevel determineLogLevel(const std::string_view parsedLogLevel) const;
+  std::vector<uint32_t> determineAllowedPeerUids(const std::string_view parsedUids) const;
+  unsigned int determineReplayLatency(const std::string_view parsedLatency) const;
 
   const std::string applicationName_ { "n/a" };
   const std::string applicationVersion_ { "n/a" };
@@ -0,0 +1,32 @@
+#include "compression.hpp"
+
+#include <zlib.h>
+
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+  /// Added to the window bits, this selects the gzip format instead of the zlib format.
+  constexpr int GZIP_FORMAT { 16 };
+}
+
+string compressWithGzip(const string_view data) {
+  z_stream stream { };
+  if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, MAX_WBITS + GZIP_FORMAT, MAX_MEM_LEVEL,
+    Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw runtime_error("The gzip compression could not be initialized.");
+  }
+  string compressed(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+  stream.avail_out = static_cast<uInt>(compressed.size());
+  const int result = deflate(&stream, Z_FINISH);
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+  if (result != Z_STREAM_END) {
+    throw runtime_error("The data could not be compressed with gzip.");
+  }
+  return compressed;
+}
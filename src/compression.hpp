@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/// @brief Compresses data in the gzip format (RFC 1952), e.g. a request body sent with the
+/// 'Content-Encoding' gzip. The fastest level is used, as it already shrinks JSON to a
+/// fraction, and the compression must not take longer than the transfer it saves.
+/// @throw std::runtime_error if the data could not be compressed.
+std::string compressWithGzip(const std::string_view data);
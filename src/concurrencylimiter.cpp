@@ -0,0 +1,177 @@
+#include "concurrencylimiter.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+  /// The weights of the latest latency in the short-term and the long-term moving averages.
+  constexpr double SHORT_LATENCY_WEIGHT { 0.1 };
+  constexpr double LONG_LATENCY_WEIGHT { 0.005 };
+  /// By how much the current latency may exceed the long-term latency before the limit shrinks.
+  constexpr double LATENCY_TOLERANCE { 1.5 };
+  /// The weight of a new limit, so that the limit does not follow every spike.
+  constexpr double LIMIT_SMOOTHING { 0.2 };
+  /// The factor by which a failed request shrinks the limit.
+  constexpr double FAILURE_BACKOFF { 0.9 };
+
+  ConcurrencyLimits normalize(ConcurrencyLimits limits) noexcept {
+    limits.minLimit_ = max<size_t>(limits.minLimit_, 1);
+    limits.maxLimit_ = max(limits.maxLimit_, limits.minLimit_);
+    limits.initialLimit_ = clamp(limits.initialLimit_, limits.minLimit_, limits.maxLimit_);
+    return limits;
+  }
+}
+
+AdaptiveConcurrencyLimiter::Permit::Permit(AdaptiveConcurrencyLimiter* limiter) noexcept :
+  limiter_(limiter) { }
+
+AdaptiveConcurrencyLimiter::Permit::Permit(Permit&& other) noexcept :
+  limiter_(other.limiter_) {
+  other.limiter_ = nullptr;
+}
+
+AdaptiveConcurrencyLimiter::Permit::~Permit() {
+  if (limiter_ != nullptr) {
+    limiter_->release(chrono::microseconds(0), true, {});
+  }
+}
+
+void AdaptiveConcurrencyLimiter::Permit::complete(const chrono::microseconds latency,
+  const bool failed, const string& endpoint) noexcept {
+  if (limiter_ != nullptr) {
+    limiter_->release(latency, failed, endpoint);
+    limiter_ = nullptr;
+  }
+}
+
+void AdaptiveConcurrencyLimiter::Permit::abandon() noexcept {
+  if (limiter_ != nullptr) {
+    limiter_->releaseWithoutOutcome();
+    limiter_ = nullptr;
+  }
+}
+
+AdaptiveConcurrencyLimiter::AdaptiveConcurrencyLimiter(const string& server,
+  const ConcurrencyLimits& limits) :
+  limits_(normalize(limits)), limit_(static_cast<double>(limits_.initialLimit_)),
+  limitGauge_(ServerMetrics::instance().upstreamConcurrencyLimit_.withLabels({ server })),
+  publishedLimit_(static_cast<int64_t>(limits_.initialLimit_)) {
+  limitGauge_.add(publishedLimit_);
+}
+
+AdaptiveConcurrencyLimiter::~AdaptiveConcurrencyLimiter() {
+  limitGauge_.add(-publishedLimit_);
+}
+
+AdaptiveConcurrencyLimiter::Permit AdaptiveConcurrencyLimiter::acquire(
+  const chrono::steady_clock::time_point deadline) {
+  ServerMetrics& metrics = ServerMetrics::instance();
+  unique_lock lock(mutex_);
+  if (hasFreeSlot() && queue_.empty()) {
+    ++inFlight_;
+    return Permit(this);
+  }
+
+  Waiter waiter;
+  queue_.push_back(&waiter);
+  GaugeIncrement queued(metrics.upstreamQueuedRequests_);
+  const bool admitted = waiter.condition_.wait_until(lock, deadline,
+    [&waiter] { return waiter.admitted_; });
+  if (! admitted) {
+    // The waiter is still queued, as admitWaiters() removes the waiters it admits.
+    queue_.erase(find(queue_.begin(), queue_.end(), &waiter));
+    metrics.upstreamDeadlineRejections_.increment();
+    return Permit(nullptr);
+  }
+  return Permit(this);
+}
+
+AdaptiveConcurrencyLimiter::Permit AdaptiveConcurrencyLimiter::tryAcquire() {
+  lock_guard lock(mutex_);
+  if (hasFreeSlot() && queue_.empty()) {
+    ++inFlight_;
+    return Permit(this);
+  }
+  return Permit(nullptr);
+}
+
+size_t AdaptiveConcurrencyLimiter::limit() const {
+  lock_guard lock(mutex_);
+  return static_cast<size_t>(limit_);
+}
+
+size_t AdaptiveConcurrencyLimiter::numberOfRequestsInFlight() const {
+  lock_guard lock(mutex_);
+  return inFlight_;
+}
+
+size_t AdaptiveConcurrencyLimiter::numberOfQueuedRequests() const {
+  lock_guard lock(mutex_);
+  return queue_.size();
+}
+
+void AdaptiveConcurrencyLimiter::release(const chrono::microseconds latency,
+  const bool failed, const string& endpoint) noexcept {
+  lock_guard lock(mutex_);
+  updateLimit(static_cast<double>(latency.count()), failed, inFlight_, endpoint);
+  --inFlight_;
+  admitWaiters();
+  const auto newLimit = static_cast<int64_t>(limit_);
+  if (newLimit != publishedLimit_) {
+    limitGauge_.add(newLimit - publishedLimit_);
+    publishedLimit_ = newLimit;
+  }
+}
+
+void AdaptiveConcurrencyLimiter::releaseWithoutOutcome() noexcept {
+  lock_guard lock(mutex_);
+  --inFlight_;
+  admitWaiters();
+}
+
+void AdaptiveConcurrencyLimiter::updateLimit(const double latency, const bool failed,
+  const size_t inFlight, const string& endpoint) noexcept {
+  const auto minLimit = static_cast<double>(limits_.minLimit_);
+  const auto maxLimit = static_cast<double>(limits_.maxLimit_);
+  if (failed) {
+    limit_ = max(limit_ * FAILURE_BACKOFF, minLimit);
+    return;
+  }
+  auto& [shortLatency, longLatency] = endpointLatencies_[endpoint];
+  if (longLatency == 0.0) {
+    shortLatency = latency;
+    longLatency = latency;
+  }
+  shortLatency = SHORT_LATENCY_WEIGHT * latency + (1.0 - SHORT_LATENCY_WEIGHT) * shortLatency;
+  longLatency = LONG_LATENCY_WEIGHT * latency + (1.0 - LONG_LATENCY_WEIGHT) * longLatency;
+  if (longLatency > 2.0 * shortLatency) {
+    // The server has recovered from an overload, which the long-term latency must not remember.
+    longLatency *= 0.95;
+  }
+  if (static_cast<double>(inFlight) < limit_ / 2.0) {
+    // A limit that is not used says nothing about the capacity of the server.
+    return;
+  }
+  const double gradient = shortLatency > 0.0 ?
+    clamp(LATENCY_TOLERANCE * longLatency / shortLatency, 0.5, 1.0) : 1.0;
+  const double newLimit = limit_ * gradient + sqrt(limit_);
+  limit_ = clamp((1.0 - LIMIT_SMOOTHING) * limit_ + LIMIT_SMOOTHING * newLimit, minLimit,
+    maxLimit);
+}
+
+void AdaptiveConcurrencyLimiter::admitWaiters() noexcept {
+  while (! queue_.empty() && hasFreeSlot()) {
+    Waiter* waiter = queue_.front();
+    queue_.pop_front();
+    ++inFlight_;
+    waiter->admitted_ = true;
+    waiter->condition_.notify_one();
+  }
+}
+
+bool AdaptiveConcurrencyLimiter::hasFreeSlot() const noexcept {
+  return static_cast<double>(inFlight_) + 1.0 <= limit_;
+}
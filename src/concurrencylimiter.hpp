@@ -0,0 +1,108 @@
+#pragma once
+
+#include "globals.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+class Gauge;
+
+/// @brief The bounds of an AdaptiveConcurrencyLimiter.
+struct ConcurrencyLimits {
+  /// The limit with which the limiter starts, before any latency has been observed.
+  std::size_t initialLimit_ { globals::INITIAL_UPSTREAM_CONCURRENCY };
+  std::size_t minLimit_ { 1 };
+  std::size_t maxLimit_ { globals::DEFAULT_MAX_UPSTREAM_CONCURRENCY };
+};
+
+/// @brief Limits the number of concurrent requests to an upstream server, adapting the limit
+/// to the latency of the server.
+///
+/// The limit follows the gradient between the long-term latency of the server and its current
+/// latency. Both are kept per endpoint, and the gradient is taken from the endpoint of each
+/// request, so that a shift of the traffic between fast and slow endpoints is not taken for a
+/// change of the server. As long as the current latency does not exceed the long-term latency by more than a
+/// tolerance, the limit grows by its square root, otherwise it shrinks in proportion to the
+/// gradient. Failed requests shrink it multiplicatively. So the limit settles just below the
+/// concurrency at which the server starts to queue requests.
+///
+/// Requests beyond the limit wait in a FIFO queue until one of the requests in flight is done,
+/// or until their deadline has passed.
+class AdaptiveConcurrencyLimiter {
+public:
+  /// @brief The permission of a request to be sent, which must report its outcome.
+  class Permit {
+  public:
+    Permit(Permit&& other) noexcept;
+    Permit& operator=(Permit&&) = delete;
+    /// An acquired permit whose outcome has not been reported counts as failure.
+    ~Permit();
+
+    bool isAcquired() const noexcept { return limiter_ != nullptr; }
+
+    /// @param failed is true if the request failed or was rejected by an overloaded server.
+    /// @param endpoint identifies the endpoint of the request, e.g. its normalised path.
+    void complete(const std::chrono::microseconds latency, const bool failed,
+      const std::string& endpoint = {}) noexcept;
+
+    /// @brief Releases the permit without an outcome, for a request that has not been sent or
+    /// has been cancelled, so that it neither shrinks nor grows the limit.
+    void abandon() noexcept;
+
+  private:
+    friend class AdaptiveConcurrencyLimiter;
+    explicit Permit(AdaptiveConcurrencyLimiter* limiter) noexcept;
+
+    AdaptiveConcurrencyLimiter* limiter_;
+  };
+
+  /// @param server identifies the limited server in the metrics.
+  AdaptiveConcurrencyLimiter(const std::string& server, const ConcurrencyLimits& limits);
+  ~AdaptiveConcurrencyLimiter();
+
+  /// @brief Acquires a permit, waiting in the queue until the deadline if necessary.
+  /// @return a permit, which has not been acquired if the deadline has passed.
+  Permit acquire(const std::chrono::steady_clock::time_point deadline);
+
+  /// @brief Acquires a permit only if it is available at once, without queueing.
+  /// @return a permit, which has not been acquired if the limit has been reached.
+  Permit tryAcquire();
+
+  std::size_t limit() const;
+  std::size_t numberOfRequestsInFlight() const;
+  std::size_t numberOfQueuedRequests() const;
+
+  AdaptiveConcurrencyLimiter(const AdaptiveConcurrencyLimiter&) = delete;
+  AdaptiveConcurrencyLimiter& operator=(const AdaptiveConcurrencyLimiter&) = delete;
+
+private:
+  struct Waiter {
+    std::condition_variable condition_;
+    bool admitted_ { false };
+  };
+
+  void release(const std::chrono::microseconds latency, const bool failed,
+    const std::string& endpoint) noexcept;
+  void releaseWithoutOutcome() noexcept;
+  void updateLimit(const double latency, const bool failed, const std::size_t inFlight,
+    const std::string& endpoint) noexcept;
+  void admitWaiters() noexcept;
+  bool hasFreeSlot() const noexcept;
+
+  const ConcurrencyLimits limits_;
+  mutable std::mutex mutex_;
+  double limit_;
+  // The short-term and the long-term moving average of the latency of each endpoint.
+  std::map<std::string, std::pair<double, double>> endpointLatencies_;
+  std::size_t inFlight_ { 0 };
+  std::deque<Waiter*> queue_;
+  Gauge& limitGauge_;
+  std::int64_t publishedLimit_ { 0 };
+};
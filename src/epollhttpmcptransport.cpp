@@ -0,0 +1,502 @@
+#include "epollhttpmcptransport.hpp"
+#include "globals.hpp"
+#include "logpayload.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+  string_view reasonPhrase(const int status) {
+    switch (status) {
+      case 200: return "OK";
+      case 202: return "Accepted";
+      case 204: return "No Content";
+      case 400: return "Bad Request";
+      case 404: return "Not Found";
+      case 413: return "Payload Too Large";
+      default: return "Internal Server Error";
+    }
+  }
+
+  string systemErrorMessage(const string_view what) {
+    string message(what);
+    message += ": ";
+    message += strerror(errno);
+    return message;
+  }
+}
+
+EpollHttpMcpTransport::EpollHttpMcpTransport(const string& serverName,
+  const string serverVersion) :
+  EpollHttpMcpTransport(globals::DEFAULT_SERVER_ADDRESS, 8080, serverName, serverVersion) { }
+
+EpollHttpMcpTransport::EpollHttpMcpTransport(const string& hostAddress, const uint16_t port,
+  const string& serverName, const string serverVersion, const size_t numberOfWorkers) :
+  hostAddress_(hostAddress), port_(port), serverName_(serverName),
+  serverVersion_(serverVersion), numberOfWorkers_(numberOfWorkers) { }
+
+void EpollHttpMcpTransport::start(McpRequestHandler requestHandler) {
+  if (running_)
+    return;
+
+  requestHandler_ = move(requestHandler);
+  openListeningSocket();
+  workerPool_ = make_unique<WorkerPool>(numberOfWorkers_, globals::FAST_LANE_WORKERS);
+
+  running_ = true;
+  eventLoopThread_ = thread([this]() { runEventLoop(); });
+  spdlog::info("Starting {0} (epoll) on {1}:{2}.", serverName_, hostAddress_, port_);
+}
+
+void EpollHttpMcpTransport::stop() {
+  if (! running_.exchange(false))
+    return;
+
+  const uint64_t wakeup { 1 };
+  [[maybe_unused]] const auto written = ::write(wakeupFd_, &wakeup, sizeof(wakeup));
+  if (eventLoopThread_.joinable()) {
+    eventLoopThread_.join();
+  }
+  workerPool_->shutdown();
+  closeAllDescriptors();
+}
+
+bool EpollHttpMcpTransport::isRunning() const noexcept {
+  return running_;
+}
+
+EpollHttpMcpTransport::~EpollHttpMcpTransport() {
+  stop();
+}
+
+void EpollHttpMcpTransport::openListeningSocket() {
+  listenFd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd_ < 0) {
+    throw runtime_error(systemErrorMessage("Cannot create listening socket"));
+  }
+
+  const int enable { 1 };
+  ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  sockaddr_in address {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port_);
+  if (::inet_pton(AF_INET, hostAddress_.c_str(), &address.sin_addr) != 1) {
+    closeAllDescriptors();
+    throw runtime_error("Invalid IPv4 host address: " + hostAddress_);
+  }
+
+  if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+      ::listen(listenFd_, SOMAXCONN) < 0) {
+    const string message = systemErrorMessage("Cannot listen on " + hostAddress_ + ":" +
+      to_string(port_));
+    closeAllDescriptors();
+    throw runtime_error(message);
+  }
+
+  epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+  wakeupFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epollFd_ < 0 || wakeupFd_ < 0) {
+    const string message = systemErrorMessage("Cannot create epoll instance");
+    closeAllDescriptors();
+    throw runtime_error(message);
+  }
+
+  epoll_event event {};
+  event.events = EPOLLIN | EPOLLET;
+  event.data.fd = listenFd_;
+  ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &event);
+  event.data.fd = wakeupFd_;
+  ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeupFd_, &event);
+}
+
+void EpollHttpMcpTransport::runEventLoop() {
+  epoll_event events[MAX_EVENTS_PER_WAIT];
+
+  while (running_) {
+    // Connections with requests left over from the last wakeup are served again right after
+    // the pending events, so epoll is only polled while there are any.
+    const int numberOfEvents = ::epoll_wait(epollFd_, events, MAX_EVENTS_PER_WAIT,
+      deferredConnections_.empty() ? -1 : 0);
+    if (numberOfEvents < 0) {
+      if (errno == EINTR)
+        continue;
+      spdlog::critical("FATAL ERROR -- epoll_wait failed: {}", strerror(errno));
+      running_ = false;
+      break;
+    }
+
+    for (int index = 0; index < numberOfEvents; ++index) {
+      const int fd = events[index].data.fd;
+      const uint32_t flags = events[index].events;
+
+      if (fd == listenFd_) {
+        acceptConnections();
+      } else if (fd == wakeupFd_) {
+        uint64_t counter;
+        while (::read(wakeupFd_, &counter, sizeof(counter)) > 0) { }
+        drainCompletedResponses();
+      } else {
+        auto iter = connections_.find(fd);
+        if (iter == connections_.end())
+          continue;
+
+        if (flags & (EPOLLERR | EPOLLHUP)) {
+          closeConnection(fd);
+          continue;
+        }
+        if (flags & EPOLLOUT) {
+          writeToConnection(iter->second);
+          iter = connections_.find(fd);
+          if (iter == connections_.end())
+            continue;
+        }
+        serviceConnection(iter->second, flags & (EPOLLIN | EPOLLRDHUP));
+      }
+    }
+
+    vector<pair<int, uint64_t>> deferredConnections;
+    deferredConnections.swap(deferredConnections_);
+    for (const auto& [fd, generation] : deferredConnections) {
+      const auto iter = connections_.find(fd);
+      if (iter != connections_.end() && iter->second.generation_ == generation) {
+        serviceConnection(iter->second, false);
+      }
+    }
+  }
+}
+
+void EpollHttpMcpTransport::acceptConnections() {
+  while (true) {
+    const int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        spdlog::error("Accepting a connection failed: {}", strerror(errno));
+      }
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+
+    const int enable { 1 };
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    epoll_event event {};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = fd;
+    if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+      ::close(fd);
+      continue;
+    }
+
+    Connection& connection = connections_[fd];
+    connection.fd_ = fd;
+    connection.generation_ = nextGeneration_++;
+  }
+}
+
+bool EpollHttpMcpTransport::readFromConnection(Connection& connection) {
+  // The input is not read beyond the size of the largest request, nor while the peer has not
+  // read MAX_BUFFERED_OUTPUT_SIZE of output, so a client that pipelines requests faster than it
+  // reads the responses cannot grow either buffer without bound. Reading is resumed by
+  // serviceConnection() once requests have been taken from the buffer or the output drained.
+  connection.readPaused_ = false;
+  char chunk[READ_CHUNK_SIZE];
+  while (! connection.readClosed_) {
+    if (! hasRoomForInput(connection)) {
+      connection.readPaused_ = true;
+      break;
+    }
+    const size_t room = HttpRequestParser::MAX_REQUEST_SIZE -
+      (connection.inputBuffer_.size() - connection.inputOffset_);
+    const ssize_t received = ::recv(connection.fd_, chunk, min(sizeof(chunk), room), 0);
+    if (received > 0) {
+      connection.inputBuffer_.append(chunk, static_cast<size_t>(received));
+      continue;
+    }
+    if (received == 0) {
+      // Orderly shutdown by the peer: Requests that have already been received are answered
+      // before the connection is closed.
+      connection.readClosed_ = true;
+      break;
+    }
+    if (errno == EINTR)
+      continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      break;
+
+    closeConnection(connection.fd_);
+    return false;
+  }
+  return true;
+}
+
+bool EpollHttpMcpTransport::hasRoomForInput(const Connection& connection) const noexcept {
+  return connection.inputBuffer_.size() - connection.inputOffset_ <
+      HttpRequestParser::MAX_REQUEST_SIZE &&
+    connection.outputBuffer_.size() - connection.outputOffset_ < MAX_BUFFERED_OUTPUT_SIZE;
+}
+
+void EpollHttpMcpTransport::serviceConnection(Connection& connection, const bool readable) {
+  // With edge-triggered epoll, no further event arrives for data that has been left in the
+  // socket, so a paused connection is read again whenever it is serviced.
+  if ((readable || connection.readPaused_) && ! readFromConnection(connection))
+    return;
+  processBufferedRequests(connection);
+}
+
+void EpollHttpMcpTransport::processBufferedRequests(Connection& connection) {
+  // Requests on one connection are answered strictly in order, so parsing stops at a request
+  // that has been handed to a worker until its response has been queued for writing. At most
+  // MAX_REQUESTS_PER_WAKEUP requests are taken at once, so a pipelining client cannot starve
+  // the other connections, and none while the output backlog exceeds MAX_BUFFERED_OUTPUT_SIZE.
+  bool stoppedEarly { false };
+  for (size_t budget = MAX_REQUESTS_PER_WAKEUP;
+       ! connection.requestInProgress_ && ! connection.closeAfterWrite_; --budget) {
+    if (budget == 0 ||
+        connection.outputBuffer_.size() - connection.outputOffset_ >= MAX_BUFFERED_OUTPUT_SIZE) {
+      stoppedEarly = true;
+      break;
+    }
+
+    HttpRequest request;
+    size_t requestSize { 0 };
+    const HttpRequestParser::Status status = parser_.parse(
+      string_view(connection.inputBuffer_).substr(connection.inputOffset_), request, requestSize);
+    if (status == HttpRequestParser::Status::incomplete) {
+      if (connection.readClosed_) {
+        // No more requests can arrive, so the connection is closed once the output is written.
+        connection.closeAfterWrite_ = true;
+      }
+      break;
+    }
+    if (status != HttpRequestParser::Status::complete) {
+      connection.inputBuffer_.clear();
+      connection.inputOffset_ = 0;
+      connection.outputBuffer_ += buildHttpResponse(status == HttpRequestParser::Status::tooLarge ?
+        globals::HTTP_STATUS_PAYLOAD_TOO_LARGE : globals::HTTP_STATUS_BAD_REQUEST, "", false);
+      connection.closeAfterWrite_ = true;
+      break;
+    }
+    connection.inputOffset_ += requestSize;
+    dispatchRequest(connection, move(request));
+  }
+
+  // The parsed requests are removed from the buffer at once. Compacting only when they
+  // outweigh the remainder moves every received byte a bounded number of times.
+  if (connection.inputOffset_ >= connection.inputBuffer_.size() - connection.inputOffset_) {
+    connection.inputBuffer_.erase(0, connection.inputOffset_);
+    connection.inputOffset_ = 0;
+  }
+
+  const int fd = connection.fd_;
+  writeToConnection(connection);
+  const auto iter = connections_.find(fd);
+  if (iter == connections_.end())
+    return;
+
+  // A connection that has been stopped by the output backlog is continued on EPOLLOUT, unless
+  // writing has already drained it.
+  const Connection& remaining = iter->second;
+  const bool canContinue = stoppedEarly &&
+    remaining.outputBuffer_.size() - remaining.outputOffset_ < MAX_BUFFERED_OUTPUT_SIZE;
+  if (canContinue || (remaining.readPaused_ && hasRoomForInput(remaining))) {
+    deferredConnections_.emplace_back(fd, remaining.generation_);
+  }
+}
+
+void EpollHttpMcpTransport::dispatchRequest(Connection& connection, HttpRequest&& request) {
+  const bool keepAlive = request.keepAlive();
+
+  if (request.method_ == "POST" && request.target_ == "/mcp") {
+    connection.requestInProgress_ = true;
+    const int fd = connection.fd_;
+    const uint64_t generation = connection.generation_;
+    const RequestLane lane = classifyRequest(request.body_);
+    workerPool_->submit([this, fd, generation, keepAlive, request = move(request)]() {
+      completeResponse(fd, generation, handleMcpRequest(request), keepAlive);
+    }, lane);
+    return;
+  }
+
+  // All other endpoints are cheap and are answered directly on the event loop thread.
+  if (request.method_ == "OPTIONS") {
+    connection.outputBuffer_ += buildHttpResponse(204, "", keepAlive);
+  } else if (request.method_ == "GET" && request.target_ == "/health") {
+    const json healthResponse = {
+      {"status", "ok"},
+      {"timestamp", std::time(nullptr)}
+    };
+    connection.outputBuffer_ += buildHttpResponse(globals::HTTP_STATUS_OK,
+      healthResponse.dump(), keepAlive);
+  } else if (request.method_ == "GET" && request.target_ == "/info") {
+    connection.outputBuffer_ += buildHttpResponse(globals::HTTP_STATUS_OK,
+      buildInfoResponse(), keepAlive);
+  } else if (request.method_ == "GET" && request.target_ == "/metrics") {
+    connection.outputBuffer_ += buildHttpResponse(globals::HTTP_STATUS_OK,
+      MetricsRegistry::global().exportAsText(), keepAlive, MetricsRegistry::CONTENT_TYPE);
+  } else {
+    connection.outputBuffer_ += buildHttpResponse(404, "", keepAlive);
+  }
+  connection.closeAfterWrite_ = ! keepAlive;
+}
+
+void EpollHttpMcpTransport::writeToConnection(Connection& connection) {
+  while (connection.outputOffset_ < connection.outputBuffer_.size()) {
+    const ssize_t sent = ::send(connection.fd_,
+      connection.outputBuffer_.data() + connection.outputOffset_,
+      connection.outputBuffer_.size() - connection.outputOffset_, MSG_NOSIGNAL);
+    if (sent > 0) {
+      connection.outputOffset_ += static_cast<size_t>(sent);
+      continue;
+    }
+    if (sent < 0 && errno == EINTR)
+      continue;
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return; // The remainder is written when epoll signals EPOLLOUT.
+
+    closeConnection(connection.fd_);
+    return;
+  }
+
+  connection.outputBuffer_.clear();
+  connection.outputOffset_ = 0;
+  if (connection.closeAfterWrite_) {
+    closeConnection(connection.fd_);
+  }
+}
+
+void EpollHttpMcpTransport::drainCompletedResponses() {
+  vector<CompletedResponse> completedResponses;
+  {
+    lock_guard lock(completionMutex_);
+    completedResponses.swap(completedResponses_);
+  }
+
+  for (auto& completed : completedResponses) {
+    const auto iter = connections_.find(completed.fd_);
+    if (iter == connections_.end() || iter->second.generation_ != completed.generation_)
+      continue; // The client has gone away in the meantime.
+
+    Connection& connection = iter->second;
+    connection.outputBuffer_ += completed.bytes_;
+    connection.requestInProgress_ = false;
+    connection.closeAfterWrite_ = ! completed.keepAlive_;
+    serviceConnection(connection, false);
+  }
+}
+
+void EpollHttpMcpTransport::completeResponse(const int fd, const uint64_t generation,
+  string bytes, const bool keepAlive) {
+  {
+    lock_guard lock(completionMutex_);
+    completedResponses_.push_back({fd, generation, move(bytes), keepAlive});
+  }
+  const uint64_t wakeup { 1 };
+  [[maybe_unused]] const auto written = ::write(wakeupFd_, &wakeup, sizeof(wakeup));
+}
+
+void EpollHttpMcpTransport::closeConnection(const int fd) {
+  ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+  ::close(fd);
+  connections_.erase(fd);
+}
+
+void EpollHttpMcpTransport::closeAllDescriptors() noexcept {
+  for (const auto& [fd, connection] : connections_) {
+    ::close(fd);
+  }
+  connections_.clear();
+  deferredConnections_.clear();
+
+  for (int* fd : { &listenFd_, &epollFd_, &wakeupFd_ }) {
+    if (*fd >= 0) {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+string EpollHttpMcpTransport::handleMcpRequest(const HttpRequest& request) const {
+  ArenaScope arenaScope; // All JSON of the request is released at once on return.
+  const TracedRequest tracedRequest;
+  const TraceSpan requestSpan("HTTP MCP request");
+  ServerMetrics::instance().mcpRequestSize_.observe(request.body_.size());
+  spdlog::debug("MCP request received. Content: '{}'.", LogPayload(request.body_));
+  try {
+    json mcpRequest;
+    {
+      const TraceSpan parseSpan("parse request");
+      mcpRequest = json::parse(request.body_);
+    }
+    const string response = requestHandler_(mcpRequest);
+    spdlog::debug("Response to MCP request is: '{}'.", LogPayload(response));
+    return buildHttpResponse(response.empty() ? globals::HTTP_STATUS_ACCEPTED :
+      globals::HTTP_STATUS_OK, response, request.keepAlive());
+  } catch (const std::exception& ex) {
+    const json errorResponse = {
+      {"jsonrpc", "2.0"},
+      {"id", nullptr},
+      {"error", {
+        {"code", -32700},
+        {"message", std::string(ex.what())}
+      }}
+    };
+    spdlog::error("Error while processing MCP request: {}", ex.what());
+    return buildHttpResponse(globals::HTTP_STATUS_BAD_REQUEST, errorResponse.dump(),
+      request.keepAlive());
+  }
+}
+
+string EpollHttpMcpTransport::buildHttpResponse(const int status, const string_view body,
+  const bool keepAlive, const string_view contentType) const {
+  string response;
+  response.reserve(body.size() + 320);
+  response += "HTTP/1.1 ";
+  response += to_string(status);
+  response += ' ';
+  response += reasonPhrase(status);
+  response += "\r\nContent-Type: ";
+  response += contentType;
+  response += "\r\nContent-Length: ";
+  response += to_string(body.size());
+  response += "\r\nConnection: ";
+  response += keepAlive ? "keep-alive" : "close";
+  // Cross-Origin Resource Sharing (CORS) Headers for browser compatibility
+  response += "\r\nAccess-Control-Allow-Origin: *"
+    "\r\nAccess-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS"
+    "\r\nAccess-Control-Allow-Headers: Content-Type, Authorization\r\n\r\n";
+  response += body;
+  return response;
+}
+
+string EpollHttpMcpTransport::buildInfoResponse() const {
+  const json infoResponse = {
+    {"server", serverName_},
+    {"version", serverVersion_},
+    {"transport", "HTTP (epoll)"},
+    {"endpoints", {
+      {"mcp", "/mcp"},
+      {"health", "/health"},
+      {"info", "/info"},
+      {"metrics", "/metrics"}
+    }}
+  };
+  return infoResponse.dump();
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "globals.hpp"
+#include "httprequestparser.hpp"
+#include "mcptransport.hpp"
+#include "workerpool.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// @brief Implements MCP transport via HTTP on top of a native Linux epoll event loop.
+///
+/// In contrast to HttpMcpTransport, which dedicates a thread to every open connection, a
+/// single event loop thread serves all connections with edge-triggered epoll and non-blocking
+/// sockets. Connections are kept alive (HTTP/1.1), so idle clients only cost a file descriptor
+/// and a few buffers. Parsed MCP requests are handed off to a pool of worker threads, and the
+/// serialized responses are passed back to the event loop for writing.
+class EpollHttpMcpTransport final : public MCPTransport {
+public:
+  /// @brief An initialization constructor.
+  /// @param serverName is the name of the server.
+  /// @param serverVersion is the version of the server.
+  EpollHttpMcpTransport(const std::string& serverName, const std::string serverVersion);
+
+  /// @brief An initialization constructor.
+  /// @param hostAddress is the IPv4 address the server shall listen on.
+  /// @param port is the TCP port the server shall listen on.
+  /// @param serverName is the name of the server.
+  /// @param serverVersion is the version of the server.
+  /// @param numberOfWorkers is the number of threads processing MCP requests (0 means one per
+  /// hardware thread). Additional threads only process requests of the fast lane.
+  EpollHttpMcpTransport(const std::string& hostAddress, const uint16_t port,
+    const std::string& serverName, const std::string serverVersion,
+    const std::size_t numberOfWorkers = 0);
+  EpollHttpMcpTransport() = delete;
+
+  void start(McpRequestHandler requestHandler) override;
+  void stop() override;
+  bool isRunning() const noexcept override;
+
+  ~EpollHttpMcpTransport() override;
+
+private:
+  struct Connection {
+    int fd_ { -1 };
+    uint64_t generation_ { 0 };
+    std::string inputBuffer_;
+    // The bytes at the front of inputBuffer_ that have already been parsed.
+    std::size_t inputOffset_ { 0 };
+    std::string outputBuffer_;
+    std::size_t outputOffset_ { 0 };
+    bool requestInProgress_ { false };
+    bool closeAfterWrite_ { false };
+    // The peer has shut down its side; the buffered requests are still answered.
+    bool readClosed_ { false };
+    // Reading has stopped because the input buffer holds the largest acceptable request or the
+    // peer has not read MAX_BUFFERED_OUTPUT_SIZE of output yet.
+    bool readPaused_ { false };
+  };
+
+  struct CompletedResponse {
+    int fd_;
+    uint64_t generation_;
+    std::string bytes_;
+    bool keepAlive_;
+  };
+
+  void openListeningSocket();
+  void runEventLoop();
+  void acceptConnections();
+  bool readFromConnection(Connection& connection);
+  void serviceConnection(Connection& connection, bool readable);
+  void processBufferedRequests(Connection& connection);
+  bool hasRoomForInput(const Connection& connection) const noexcept;
+  void dispatchRequest(Connection& connection, HttpRequest&& request);
+  void writeToConnection(Connection& connection);
+  void drainCompletedResponses();
+  void completeResponse(int fd, uint64_t generation, std::string bytes, bool keepAlive);
+  void closeConnection(int fd);
+  void closeAllDescriptors() noexcept;
+
+  std::string handleMcpRequest(const HttpRequest& request) const;
+  std::string buildHttpResponse(int status, std::string_view body, bool keepAlive,
+    std::string_view contentType = globals::JSON_MIME_TYPE) const;
+  std::string buildInfoResponse() const;
+
+  std::string hostAddress_;
+  uint16_t port_;
+  std::string serverName_;
+  std::string serverVersion_;
+  std::size_t numberOfWorkers_;
+
+  int listenFd_ { -1 };
+  int epollFd_ { -1 };
+  int wakeupFd_ { -1 };
+  uint64_t nextGeneration_ { 1 };
+  std::unordered_map<int, Connection> connections_;
+  // Connections with buffered requests left over after the last wakeup, by fd and generation.
+  std::vector<std::pair<int, uint64_t>> deferredConnections_;
+  HttpRequestParser parser_;
+
+  std::mutex completionMutex_;
+  std::vector<CompletedResponse> completedResponses_;
+
+  McpRequestHandler requestHandler_;
+  std::unique_ptr<WorkerPool> workerPool_;
+  std::thread eventLoopThread_;
+  std::atomic<bool> running_ { false };
+
+  static constexpr int MAX_EVENTS_PER_WAIT { 256 };
+  static constexpr std::size_t READ_CHUNK_SIZE { 16 * 1024 };
+  static constexpr std::size_t MAX_REQUESTS_PER_WAKEUP { 64 };
+  static constexpr std::size_t MAX_BUFFERED_OUTPUT_SIZE { 1024 * 1024 };
+};
@@ -2,6 +2,7 @@
 
 ///@file Global constants and configuration data
 
+#include <cstddef>
 #include <cstdint>
 
 namespace globals {
@@ -14,10 +15,46 @@ namespace globals {
   const char* const SERVERSENTEVENTS_CONTENT_TYPE { "text/event-stream" };
   const char* const DEFAULT_SERVER_ADDRESS { "127.0.0.1" };
   const char* const DEFAULT_SERVER_PORT { "8080" };
+  const char* const DEFAULT_UNIX_SOCKET_PATH { "/tmp/sysmlv2mcpserver.sock" };
+
+  /// The capacity of the queue between the threads that log and the thread writing the log file.
+  /// If it is full, the oldest messages are dropped rather than blocking a request.
+  const std::size_t LOG_QUEUE_CAPACITY { 8192 };
+  const std::size_t DEFAULT_MAX_LOGGED_PAYLOAD_SIZE { 2048 };
+
+  /// The number of worker threads of a transport that only process requests of the fast lane.
+  const std::size_t FAST_LANE_WORKERS { 2 };
+
+  /// The default limits of the admission control of the HTTP MCP transport.
+  const std::size_t DEFAULT_MAX_REQUESTS_IN_FLIGHT { 64 };
+  const std::size_t DEFAULT_MAX_QUEUED_REQUESTS { 128 };
+  const unsigned int DEFAULT_MAX_QUEUE_TIME_IN_MILLISECONDS { 1000 };
+  /// The limits of the admission control of requests of the fast lane, which must never wait long.
+  const std::size_t FAST_LANE_MAX_REQUESTS_IN_FLIGHT { 16 };
+  const std::size_t FAST_LANE_MAX_QUEUED_REQUESTS { 32 };
+  const unsigned int FAST_LANE_MAX_QUEUE_TIME_IN_MILLISECONDS { 100 };
+  /// The default size in bytes from which MCP responses of the HTTP transport are compressed.
+  const std::size_t DEFAULT_MIN_COMPRESSED_RESPONSE_SIZE { 4096 };
+
+  /// The defaults of the hedging of reads from the SysML v2 API.
+  const double DEFAULT_HEDGING_PERCENTILE { 95.0 };
+  const double DEFAULT_HEDGING_BUDGET { 0.05 };
+  const unsigned int MIN_HEDGING_DELAY_IN_MILLISECONDS { 5 };
+  /// The number of threads that send the hedges of reads, whose delays are kept by a timer.
+  const std::size_t HEDGING_THREADS { 16 };
+
+  /// The bounds of the adaptive limit of concurrent requests per upstream server.
+  const std::size_t INITIAL_UPSTREAM_CONCURRENCY { 8 };
+  const std::size_t DEFAULT_MAX_UPSTREAM_CONCURRENCY { 64 };
 
   const int16_t JSONRPC_ERROR_METHOD_NOT_FOUND = -32601;
   const int16_t JSONRPC_ERROR_GENERAL = -31999;
+  const int16_t JSONRPC_ERROR_SERVER_OVERLOADED = -32001;
 
   const int16_t HTTP_STATUS_OK = 200;
+  const int16_t HTTP_STATUS_ACCEPTED = 202;
   const int16_t HTTP_STATUS_BAD_REQUEST = 400;
+  const int16_t HTTP_STATUS_PAYLOAD_TOO_LARGE = 413;
+  const int16_t HTTP_STATUS_TOO_MANY_REQUESTS = 429;
+  const int16_t HTTP_STATUS_SERVICE_UNAVAILABLE = 503;
 }
\ No newline at end of file
@@ -1,13 +1,118 @@
 #include "httpmcptransport.hpp"
 #include "globals.hpp"
+#include "logpayload.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
 
 #include <spdlog/spdlog.h>
-#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <string_view>
 #include <thread>
 
 using namespace std;
 using namespace globals;
 
+namespace {
+  /// Threads for requests to /health, /info and /metrics while all others wait for admission.
+  constexpr size_t SPARE_SERVER_THREADS { 4 };
+  /// The limits of the requests of the fast lane, which are admitted apart from the slow ones.
+  const AdmissionLimits FAST_LANE_ADMISSION_LIMITS { globals::FAST_LANE_MAX_REQUESTS_IN_FLIGHT,
+    globals::FAST_LANE_MAX_QUEUED_REQUESTS,
+    chrono::milliseconds(globals::FAST_LANE_MAX_QUEUE_TIME_IN_MILLISECONDS) };
+  /// Connections beyond the threads of the pool and its queue are served by these threads.
+  constexpr size_t OVERFLOW_SERVER_THREADS { 2 };
+  constexpr size_t MAX_QUEUED_OVERFLOW_CONNECTIONS { 64 };
+  /// An idle keep-alive connection holds a thread of the pool, so it is closed soon.
+  constexpr time_t KEEP_ALIVE_TIMEOUT_IN_SECONDS { 2 };
+
+  /// Set while a thread serves a connection for which no thread of the pool was free.
+  thread_local bool isOverflowConnection { false };
+
+  /// @brief The task queue in which httplib queues one task per accepted connection.
+  ///
+  /// httplib serves a connection by one thread for as long as it is kept alive. Connections that
+  /// find all threads busy wait in a bounded queue. Those beyond are not queued without bound,
+  /// but served by a few overflow threads, which reject their MCP requests at once. So every
+  /// MCP request is either admitted or rejected quickly, and /health and /metrics stay reachable
+  /// under overload.
+  class BoundedTaskQueue final : public httplib::TaskQueue {
+  public:
+    BoundedTaskQueue(const size_t numberOfThreads, const size_t maxQueuedConnections) :
+      pool_(numberOfThreads, max<size_t>(maxQueuedConnections, 1)),
+      overflowPool_(OVERFLOW_SERVER_THREADS, MAX_QUEUED_OVERFLOW_CONNECTIONS) { }
+
+    bool enqueue(function<void()> task) override {
+      if (pool_.enqueue(task)) {
+        return true;
+      }
+      return overflowPool_.enqueue([task = move(task)] {
+        isOverflowConnection = true;
+        task();
+        isOverflowConnection = false;
+      });
+    }
+
+    void shutdown() override {
+      pool_.shutdown();
+      overflowPool_.shutdown();
+    }
+
+  private:
+    httplib::ThreadPool pool_;
+    httplib::ThreadPool overflowPool_;
+  };
+  /// The size of the chunks in which a compressed response is handed to httplib.
+  constexpr size_t COMPRESSED_RESPONSE_CHUNK_SIZE { 64 * 1024 };
+
+  /// @return true if httplib has been built with support for the given content coding.
+  bool isCompressionSupported([[maybe_unused]] const string_view coding) {
+#ifdef CPPHTTPLIB_BROTLI_SUPPORT
+    if (coding == "br")
+      return true;
+#endif
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+    if (coding == "gzip")
+      return true;
+#endif
+#ifdef CPPHTTPLIB_ZSTD_SUPPORT
+    if (coding == "zstd")
+      return true;
+#endif
+    return false;
+  }
+
+  /// @brief Determines whether the client accepts a content coding in which httplib can
+  /// compress a response. A coding that the client refuses with a quality of 0 is skipped.
+  bool isCompressionAccepted(const httplib::Request& req) {
+    const string acceptEncoding = req.get_header_value("Accept-Encoding");
+    string_view remaining(acceptEncoding);
+    while (! remaining.empty()) {
+      const size_t comma = remaining.find(',');
+      string_view element = remaining.substr(0, comma);
+      remaining = comma == string_view::npos ? string_view() : remaining.substr(comma + 1);
+
+      const size_t semicolon = element.find(';');
+      string coding(element.substr(0, semicolon));
+      coding.erase(remove_if(coding.begin(), coding.end(),
+        [](const unsigned char character) { return isspace(character); }), coding.end());
+      transform(coding.begin(), coding.end(), coding.begin(),
+        [](const unsigned char character) { return static_cast<char>(tolower(character)); });
+      string parameters(semicolon == string_view::npos ? string_view() :
+        element.substr(semicolon + 1));
+      parameters.erase(remove_if(parameters.begin(), parameters.end(),
+        [](const unsigned char character) { return isspace(character); }), parameters.end());
+      const bool isRefused = parameters.starts_with("q=0") &&
+        parameters.find_first_not_of("0.", 2) == string::npos;
+      if (isCompressionSupported(coding) && ! isRefused) {
+        return true;
+      }
+    }
+    return false;
+  }
+}
+
 HttpMcpTransport::HttpMcpTransport(const string& serverName, const string serverVersion) :
   HttpMcpTransport("127.0.0.1", 8080, serverName, serverVersion) { }
 
@@ -17,12 +122,34 @@ HttpMcpTransport::HttpMcpTransport(const std::string& hostAddress, const uint16_
     server_ = std::make_unique<httplib::Server>();
 }
 
-void HttpMcpTransport::start(function<json(const json&)> requestHandler) {
+void HttpMcpTransport::setAdmissionLimits(const AdmissionLimits& admissionLimits) noexcept {
+  admissionLimits_ = admissionLimits;
+}
+
+void HttpMcpTransport::setMinCompressedResponseSize(const size_t minCompressedResponseSize)
+  noexcept {
+  minCompressedResponseSize_ = minCompressedResponseSize;
+}
+
+void HttpMcpTransport::start(McpRequestHandler requestHandler) {
   if (running_)
     return;
 
   configureLogging();
 
+  // httplib serves each connection by a thread of its pool, so the pool must hold a thread for
+  // every request that is in flight or waits for admission.
+  admissionController_ = make_shared<AdmissionController>(admissionLimits_);
+  fastLaneAdmissionController_ = make_shared<AdmissionController>(FAST_LANE_ADMISSION_LIMITS);
+  const size_t numberOfThreads = admissionLimits_.maxInFlight_ + admissionLimits_.maxQueued_ +
+    FAST_LANE_ADMISSION_LIMITS.maxInFlight_ + FAST_LANE_ADMISSION_LIMITS.maxQueued_ +
+    SPARE_SERVER_THREADS;
+  const size_t maxQueuedConnections = admissionLimits_.maxQueued_;
+  server_->new_task_queue = [numberOfThreads, maxQueuedConnections] {
+    return new BoundedTaskQueue(numberOfThreads, maxQueuedConnections);
+  };
+  server_->set_keep_alive_timeout(KEEP_ALIVE_TIMEOUT_IN_SECONDS);
+
   // Cross-Origin Resource Sharing (CORS) Headers for browser compatibility
   server_->set_pre_routing_handler([]([[maybe_unused]]const httplib::Request& request, httplib::Response& response) {
     response.set_header("Access-Control-Allow-Origin", "*");
@@ -58,7 +185,7 @@ HttpMcpTransport::~HttpMcpTransport() {
 
 void HttpMcpTransport::configureLogging() noexcept {
   server_->set_logger([](const httplib::Request& req, const httplib::Response& res) {
-    std::cerr << req.method << " " << req.path << " -> " << res.status << std::endl;
+    spdlog::debug("{0} {1} -> {2}", req.method, req.path, res.status);
   });
 
   // server_->set_error_logger([](const httplib::Error& error, const httplib::Request* req) {
@@ -71,7 +198,7 @@ void HttpMcpTransport::configureLogging() noexcept {
   // });
 }
 
-void HttpMcpTransport::createEndpoints(function<json(const json&)> requestHandler) {
+void HttpMcpTransport::createEndpoints(McpRequestHandler requestHandler) {
   spdlog::trace("Entering <HttpMcpTransport::createEndpoints>.");
 
   // OPTIONS handler for CORS preflight
@@ -79,13 +206,47 @@ void HttpMcpTransport::createEndpoints(function<json(const json&)> requestHandle
     { return; });
 
   // Main end point for MCP requests
-  server_->Post("/mcp", [requestHandler](const httplib::Request& req, httplib::Response& res) {
-    spdlog::debug("MCP request received. Content: '{}'.", req.body);
+  server_->Post("/mcp", [this, requestHandler, admissionController = admissionController_,
+    fastLaneAdmissionController = fastLaneAdmissionController_](
+    const httplib::Request& req, httplib::Response& res) {
+    if (isOverflowConnection) {
+      spdlog::debug("MCP request rejected, no thread was free for its connection.");
+      ServerMetrics::instance().connectionOverflowRejections_.increment();
+      res.set_header("Connection", "close");
+      rejectAsOverloaded(req, res, admissionController->retryAfterSeconds());
+      return;
+    }
+    // Requests of the fast lane are cheap, they are admitted separately, so that they are not
+    // queued behind slow ones.
+    AdmissionController& controller = classifyRequest(req.body) == RequestLane::fast ?
+      *fastLaneAdmissionController : *admissionController;
+    const AdmissionController::Ticket ticket = controller.admit();
+    if (! ticket.isAdmitted()) {
+      const bool isQueueFull = ticket.outcome() == AdmissionController::Outcome::queueFull;
+      spdlog::debug("MCP request rejected, {}.", isQueueFull ? "the admission queue is full" :
+        "its time in the admission queue has expired");
+      rejectAsOverloaded(req, res, controller.retryAfterSeconds());
+      return;
+    }
+
+    ArenaScope arenaScope; // All JSON of the request is released at once on return.
+    const TracedRequest tracedRequest;
+    const TraceSpan requestSpan("HTTP MCP request");
+    ServerMetrics::instance().mcpRequestSize_.observe(req.body.size());
+    spdlog::debug("MCP request received. Content: '{}'.", LogPayload(req.body));
     try {
-      json request = json::parse(req.body);
-      json response = requestHandler(request);
-      spdlog::debug("Response to MCP request is: '{}'.", response.dump());
-      res.set_content(response.dump(), globals::JSON_MIME_TYPE);
+      json request;
+      {
+        const TraceSpan parseSpan("parse request");
+        request = json::parse(req.body);
+      }
+      string response = requestHandler(request);
+      spdlog::debug("Response to MCP request is: '{}'.", LogPayload(response));
+      if (response.empty()) {
+        res.status = globals::HTTP_STATUS_ACCEPTED; // Notifications are not answered.
+        return;
+      }
+      setResponseContent(req, res, move(response));
       res.status = globals::HTTP_STATUS_OK;
     } catch (const std::exception& ex) {
       json errorResponse = {
@@ -96,8 +257,8 @@ void HttpMcpTransport::createEndpoints(function<json(const json&)> requestHandle
           {"message", std::string(ex.what())}
         }}
       };
-      spdlog::error("Error while processing MCP request: {}", errorResponse.dump());
-      res.set_content(errorResponse.dump(), globals::JSON_MIME_TYPE);
+      spdlog::error("Error while processing MCP request: {}", ex.what());
+      setResponseContent(req, res, errorResponse.dump());
       res.status = globals::HTTP_STATUS_BAD_REQUEST;
     }
   });
@@ -120,14 +281,69 @@ void HttpMcpTransport::createEndpoints(function<json(const json&)> requestHandle
       {"endpoints", {
         {"mcp", "/mcp"},
         {"health", "/health"},
-        {"info", "/info"}
+        {"info", "/info"},
+        {"metrics", "/metrics"}
       }}
     };
     res.set_content(infoResponse.dump(), globals::JSON_MIME_TYPE);
   });
+
+  // Metrics endpoint in the Prometheus text exposition format
+  server_->Get("/metrics", [](const httplib::Request &, httplib::Response &res) {
+    res.set_content(MetricsRegistry::global().exportAsText(), MetricsRegistry::CONTENT_TYPE);
+  });
   spdlog::trace("Leaving <HttpMcpTransport::createEndpoints>.");
 }
 
+void HttpMcpTransport::rejectAsOverloaded(const httplib::Request& req, httplib::Response& res,
+  const long retryAfterSeconds) const {
+  const json errorResponse = {
+    {"jsonrpc", "2.0"},
+    {"id", nullptr},
+    {"error", {
+      {"code", globals::JSONRPC_ERROR_SERVER_OVERLOADED},
+      {"message", "Server overloaded, retry later."}
+    }}
+  };
+  res.set_header("Retry-After", to_string(retryAfterSeconds));
+  setResponseContent(req, res, errorResponse.dump());
+  res.status = globals::HTTP_STATUS_SERVICE_UNAVAILABLE;
+}
+
+void HttpMcpTransport::setResponseContent(const httplib::Request& req, httplib::Response& res,
+  string content) const {
+  // httplib compresses every body set by set_content() in one piece if the client accepts it.
+  // Instead, the body is handed over by a content provider: A chunked one is compressed chunk
+  // by chunk while it is sent (gzip or zstd, as accepted by the client), so no compressed copy
+  // of the whole body is buffered. One with a known length is never compressed, and it is
+  // used whenever the body is below the threshold or the client accepts none of the codings
+  // built into httplib. JSON is a content type that httplib compresses.
+  auto body = make_shared<string>(move(content));
+  const bool isCompressible = minCompressedResponseSize_ > 0 &&
+    body->size() >= minCompressedResponseSize_;
+  if (isCompressible) {
+    res.set_header("Vary", "Accept-Encoding");
+  }
+  if (isCompressible && isCompressionAccepted(req)) {
+    res.set_chunked_content_provider(JSON_MIME_TYPE,
+      [body](const size_t offset, httplib::DataSink& sink) {
+        const size_t length = min(COMPRESSED_RESPONSE_CHUNK_SIZE, body->size() - offset);
+        if (! sink.write(body->data() + offset, length)) {
+          return false;
+        }
+        if (offset + length == body->size()) {
+          sink.done();
+        }
+        return true;
+      });
+    return;
+  }
+  res.set_content_provider(body->size(), JSON_MIME_TYPE,
+    [body](const size_t offset, const size_t length, httplib::DataSink& sink) {
+      return sink.write(body->data() + offset, length);
+    });
+}
+
 void HttpMcpTransport::launchServerThread() {
   spdlog::trace("Entering <HttpMcpTransport::launchServerThread>.");
   running_ = true;
@@ -1,11 +1,16 @@
 #pragma once
 
+#include "admissioncontroller.hpp"
+#include "globals.hpp"
 #include "mcptransport.hpp"
 
 // IMPORTANT: httplib.h must be included BEFORE Windows.h!
 #include <httplib.h>
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <string>
@@ -23,7 +28,17 @@ public:
     const std::string& serverName, const std::string serverVersion);
   HttpMcpTransport() = delete;
 
-  void start(std::function<json(const json &)> requestHandler) override;
+  /// @brief Defines the limits of the admission control of MCP requests of the slow lane. The
+  /// requests of the fast lane are admitted separately, with fixed limits.
+  /// Requests beyond the limits are answered with HTTP status 503 and a Retry-After header.
+  /// Must be called before start().
+  void setAdmissionLimits(const AdmissionLimits& admissionLimits) noexcept;
+
+  /// @brief Defines the size in bytes from which responses to MCP requests are compressed, if
+  /// the client accepts it (Accept-Encoding gzip or zstd). 0 switches compression off.
+  void setMinCompressedResponseSize(const std::size_t minCompressedResponseSize) noexcept;
+
+  void start(McpRequestHandler requestHandler) override;
   void stop() override;
   bool isRunning() const noexcept override;
 
@@ -31,8 +46,12 @@ public:
 
 private:
   void configureLogging() noexcept;
-  void createEndpoints(std::function<json(const json&)> requestHandler);
+  void createEndpoints(McpRequestHandler requestHandler);
   void launchServerThread();
+  void rejectAsOverloaded(const httplib::Request& req, httplib::Response& res,
+    const long retryAfterSeconds) const;
+  void setResponseContent(const httplib::Request& req, httplib::Response& res,
+    std::string content) const;
 
   std::string hostAddress_;
   uint16_t port_;
@@ -40,5 +59,9 @@ private:
   std::string serverVersion_;
   std::thread serverThread_;
   std::unique_ptr<httplib::Server> server_;
+  AdmissionLimits admissionLimits_;
+  std::shared_ptr<AdmissionController> admissionController_;
+  std::shared_ptr<AdmissionController> fastLaneAdmissionController_;
+  std::size_t minCompressedResponseSize_ { globals::DEFAULT_MIN_COMPRESSED_RESPONSE_SIZE };
   bool running_ { false };
 };
\ No newline at end of file
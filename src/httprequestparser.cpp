@@ -0,0 +1,125 @@
+#include "httprequestparser.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+using namespace std;
+
+namespace {
+  string toLowerCase(string_view text) {
+    string result(text);
+    transform(result.begin(), result.end(), result.begin(),
+      [](unsigned char character) { return static_cast<char>(tolower(character)); });
+    return result;
+  }
+
+  string_view trim(string_view text) {
+    const auto first = text.find_first_not_of(" \t");
+    if (first == string_view::npos) {
+      return {};
+    }
+    const auto last = text.find_last_not_of(" \t");
+    return text.substr(first, last - first + 1);
+  }
+}
+
+string HttpRequest::headerValue(const string& lowerCaseName) const {
+  const auto iter = headers_.find(lowerCaseName);
+  return iter != headers_.end() ? iter->second : string();
+}
+
+bool HttpRequest::keepAlive() const {
+  const string connection = toLowerCase(headerValue("connection"));
+  if (version_ == "HTTP/1.0") {
+    return connection == "keep-alive";
+  }
+  return connection != "close";
+}
+
+HttpRequestParser::Status HttpRequestParser::parse(string& buffer, HttpRequest& request) const {
+  size_t requestSize { 0 };
+  const Status status = parse(string_view(buffer), request, requestSize);
+  if (status == Status::complete) {
+    buffer.erase(0, requestSize);
+  }
+  return status;
+}
+
+HttpRequestParser::Status HttpRequestParser::parse(const string_view input, HttpRequest& request,
+  size_t& requestSize) const {
+  const auto endOfHeaders = input.find("\r\n\r\n");
+  if (endOfHeaders == string_view::npos) {
+    return input.size() > MAX_HEADER_SIZE ? Status::error : Status::incomplete;
+  }
+  if (endOfHeaders > MAX_HEADER_SIZE) {
+    return Status::error;
+  }
+
+  request = HttpRequest();
+  const string_view head = input.substr(0, endOfHeaders);
+  auto endOfLine = head.find("\r\n");
+  if (! parseRequestLine(head.substr(0, endOfLine), request)) {
+    return Status::error;
+  }
+
+  while (endOfLine != string_view::npos) {
+    const auto startOfLine = endOfLine + 2;
+    endOfLine = head.find("\r\n", startOfLine);
+    const auto line = head.substr(startOfLine, endOfLine == string_view::npos ?
+      string_view::npos : endOfLine - startOfLine);
+    if (! parseHeaderLine(line, request)) {
+      return Status::error;
+    }
+  }
+
+  if (! request.headerValue("transfer-encoding").empty()) {
+    return Status::error;
+  }
+
+  size_t contentLength { 0 };
+  const string lengthValue = request.headerValue("content-length");
+  if (! lengthValue.empty()) {
+    const auto [ptr, ec] = from_chars(lengthValue.data(), lengthValue.data() + lengthValue.size(),
+      contentLength);
+    if (ec == errc::result_out_of_range ||
+        (ec == errc() && ptr == lengthValue.data() + lengthValue.size() &&
+         contentLength > MAX_BODY_SIZE)) {
+      return Status::tooLarge;
+    }
+    if (ec != errc() || ptr != lengthValue.data() + lengthValue.size()) {
+      return Status::error;
+    }
+  }
+
+  const size_t startOfBody = endOfHeaders + 4;
+  if (input.size() - startOfBody < contentLength) {
+    return Status::incomplete;
+  }
+
+  request.body_.assign(input.substr(startOfBody, contentLength));
+  requestSize = startOfBody + contentLength;
+  return Status::complete;
+}
+
+bool HttpRequestParser::parseRequestLine(string_view line, HttpRequest& request) const {
+  const auto firstSpace = line.find(' ');
+  const auto secondSpace = line.find(' ', firstSpace + 1);
+  if (firstSpace == string_view::npos || secondSpace == string_view::npos) {
+    return false;
+  }
+  request.method_ = line.substr(0, firstSpace);
+  request.target_ = line.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+  request.version_ = line.substr(secondSpace + 1);
+  return ! request.method_.empty() && ! request.target_.empty() &&
+    request.version_.starts_with("HTTP/1.");
+}
+
+bool HttpRequestParser::parseHeaderLine(string_view line, HttpRequest& request) const {
+  const auto colon = line.find(':');
+  if (colon == string_view::npos || colon == 0) {
+    return false;
+  }
+  request.headers_[toLowerCase(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+  return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+
+/// @brief A single HTTP/1.1 request as received from a client.
+struct HttpRequest {
+  std::string method_;
+  std::string target_;
+  std::string version_;
+  std::map<std::string, std::string> headers_; ///< header names are stored in lower case
+  std::string body_;
+
+  /// @brief Returns the value of the given header, or an empty string if it is not present.
+  /// @param lowerCaseName is the name of the header in lower case.
+  std::string headerValue(const std::string& lowerCaseName) const;
+
+  /// @brief Determines whether the connection shall be kept open after the response.
+  bool keepAlive() const;
+};
+
+/// @brief An incremental parser for HTTP/1.1 requests.
+///
+/// The parser consumes bytes from a connection's input buffer. It can be called again and
+/// again as more data arrives, and extracts at most one complete request per call.
+/// Chunked request bodies are not supported; clients must send a Content-Length header.
+class HttpRequestParser {
+public:
+  /// tooLarge means that the declared body exceeds MAX_BODY_SIZE, error that the request is
+  /// malformed or its header exceeds MAX_HEADER_SIZE.
+  enum class Status {
+    incomplete, complete, error, tooLarge
+  };
+
+  /// @brief Tries to extract one request from the front of the buffer.
+  /// @param buffer contains the bytes received so far. The bytes of a complete request are
+  /// removed from it.
+  /// @param request receives the parsed request if the status is Status::complete.
+  /// @return the status of the parse attempt.
+  Status parse(std::string& buffer, HttpRequest& request) const;
+
+  /// @brief Tries to parse one request from the front of the input, which is left unchanged.
+  /// This lets several pipelined requests be parsed before the buffer is compacted once.
+  /// @param requestSize receives the number of bytes of the request if it is complete.
+  Status parse(std::string_view input, HttpRequest& request, std::size_t& requestSize) const;
+
+  static constexpr std::size_t MAX_HEADER_SIZE { 64 * 1024 };
+  static constexpr std::size_t MAX_BODY_SIZE { 16 * 1024 * 1024 };
+  /// The size of the largest request that is accepted, including the blank line after the
+  /// header. A connection need not buffer more than this before a request can be parsed.
+  static constexpr std::size_t MAX_REQUEST_SIZE { MAX_HEADER_SIZE + 4 + MAX_BODY_SIZE };
+
+private:
+  bool parseRequestLine(std::string_view line, HttpRequest& request) const;
+  bool parseHeaderLine(std::string_view line, HttpRequest& request) const;
+};
@@ -1,9 +1,104 @@
 #include "httptoolclient.hpp"
+#include "compression.hpp"
+#include "logpayload.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
+#include <simdjson.h>
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <optional>
 #include <regex>
 
 using namespace std;
 
+namespace {
+  /// The maximum number of idle connections per server that are kept for hedged reads.
+  constexpr size_t MAX_IDLE_HEDGING_CLIENTS { 32 };
+
+  UpstreamResponse toUpstreamResponse(httplib::Result& result) {
+    UpstreamResponse response;
+    if (! result) {
+      response.body_ = "HTTP request failed: " + httplib::to_string(result.error());
+      return response;
+    }
+    response.status_ = result->status;
+    response.headers_ = move(result->headers);
+    response.body_ = move(result->body);
+    // httplib has already decompressed the body, so the headers that describe the encoded body
+    // no longer apply, neither for the caller nor in a recording.
+    if (response.headers_.find("Content-Encoding") != response.headers_.end()) {
+      response.headers_.erase("Content-Encoding");
+      response.headers_.erase("Content-Length");
+    }
+    return response;
+  }
+
+  /// @brief Sends a GET request. The body is decompressed chunk by chunk while it is received,
+  /// into a buffer that keeps spare capacity for the padding of the JSON parser. So neither is
+  /// the compressed body kept, nor is the decompressed body copied before it is parsed.
+  /// @param isCancelled aborts the receipt of the body once it is set, if it is given.
+  UpstreamResponse receive(httplib::Client& client, const string& path,
+    const httplib::Headers& headers, const atomic<bool>* isCancelled = nullptr) {
+    string body;
+    httplib::Result result = client.Get(path, headers,
+      [&body, isCancelled](const char* data, const size_t length) {
+        if (isCancelled != nullptr && isCancelled->load()) {
+          return false;
+        }
+        const size_t requiredCapacity = body.size() + length + simdjson::SIMDJSON_PADDING;
+        if (body.capacity() < requiredCapacity) {
+          body.reserve(max(2 * body.capacity(), requiredCapacity));
+        }
+        body.append(data, length);
+        return true;
+      });
+    UpstreamResponse response = toUpstreamResponse(result);
+    if (response.status_ > 0) {
+      response.body_ = move(body);
+    }
+    return response;
+  }
+
+  /// @return true if the status shows that the request failed or the server is overloaded.
+  bool isFailureOrOverload(const int status) noexcept {
+    return status <= 0 || status >= 500 || status == globals::HTTP_STATUS_TOO_MANY_REQUESTS;
+  }
+
+  /// @brief Bounds a request of the client, including its connection, by the deadline.
+  void limitTimeout(httplib::Client& client, const chrono::steady_clock::time_point deadline) {
+    const auto remaining = max(chrono::duration_cast<chrono::milliseconds>(
+      deadline - chrono::steady_clock::now()), chrono::milliseconds(1));
+    client.set_connection_timeout(remaining.count() / 1000, (remaining.count() % 1000) * 1000);
+    client.set_max_timeout(remaining.count());
+  }
+}
+
+/// @brief The state shared by the two attempts of a hedged read.
+struct HttpToolClient::HedgedRead {
+  explicit HedgedRead(const chrono::steady_clock::time_point deadline) : deadline_(deadline) { }
+
+  // Neither attempt outlives the timeout of the read.
+  const chrono::steady_clock::time_point deadline_;
+  mutex mutex_;
+  condition_variable condition_;
+  // The clients are only set while their request is outstanding, so that the winner can stop
+  // the client of the loser. Stopping a client does not abort a connection that is still being
+  // established, so the loser additionally stops receiving once it is cancelled.
+  httplib::Client* firstClient_ { nullptr };
+  httplib::Client* hedgeClient_ { nullptr };
+  atomic<bool> isFirstCancelled_ { false };
+  atomic<bool> isHedgeCancelled_ { false };
+  bool isFirstDone_ { false };
+  bool isHedgeSent_ { false };
+  bool isHedgeDone_ { false };
+  optional<UpstreamResponse> hedgeResponse_;
+  // The hedge is only sent with a permit of the concurrency limiter, if there is one.
+  optional<AdaptiveConcurrencyLimiter::Permit> hedgePermit_;
+};
+
 json HttpToolClient::httpGet(const string& url, const Headers& headers) {
   return performHttpRequest("GET", url, "", headers);
 }
@@ -31,51 +126,71 @@ json HttpToolClient::httpDelete(const string& url, const Headers& headers) {
 json HttpToolClient::performHttpRequest(const string& method, const string& url,
   const string& body, const Headers& headers) {
   spdlog::trace("Try to perform HTTP request with method='{0}', url='{1}', body='{2}'.",
-    method, url, body);
+    method, url, LogPayload(body));
   try {
-    const string baseUrl = extractBaseUrl(url);
+    string baseUrl = extractBaseUrl(url);
     if (baseUrl.empty()) {
       throw std::runtime_error("Invalid URL format: " + url);
     }
     const string path = extractPathFromUrl(url);
-    
-    httplib::Client* client = retrieveClient(baseUrl);
-    
-    httplib::Headers httpHeaders;
-    for (const auto& [key, value] : headers) {
-      httpHeaders.emplace(key, value);
-    }
-
-    httplib::Result result;
-            
-    if (method == "GET") {
-      result = client->Get(path, httpHeaders);
-    } else if (method == "POST") {
-      result = client->Post(path, httpHeaders, body, JSON_MIME_TYPE);
-    } else if (method == "PUT") {
-      result = client->Put(path, httpHeaders, body, JSON_MIME_TYPE);
-    } else if (method == "DELETE") {
-      result = client->Delete(path, httpHeaders);
-    } else {
-      throw std::runtime_error("Unsupported HTTP method: " + method);
+    optional<UpstreamBalancer::Lease> replica;
+    if (upstreamBalancer_ && method == "GET" && baseUrl == upstreamBalancer_->primaryUrl()) {
+      replica.emplace(upstreamBalancer_->acquireReplica());
+      baseUrl = replica->baseUrl();
     }
 
-    if (! result) {
-      throw std::runtime_error("HTTP request failed: " + httplib::to_string(result.error()));
+    optional<AdaptiveConcurrencyLimiter::Permit> permit;
+    if (concurrencyLimits_ && ! upstreamTrafficReplayer_) {
+      permit.emplace(retrieveConcurrencyLimiter(baseUrl).acquire(
+        chrono::steady_clock::now() + chrono::seconds(timeoutInSeconds_)));
+      if (! permit->isAcquired()) {
+        throw std::runtime_error("Too many concurrent requests to " + baseUrl +
+          ", the request could not be sent in time.");
+      }
+    }
+
+    ServerMetrics& metrics = ServerMetrics::instance();
+    const string endpoint = determineEndpointLabel(path);
+    UpstreamResponse result;
+    chrono::microseconds latency { 0 };
+    {
+      const TraceSpan span("upstream request", endpoint);
+      GaugeIncrement requestInFlight(metrics.upstreamRequestsInFlight_);
+      result = exchange(method, baseUrl, path, body, headers, latency);
+    }
+    if (replica) {
+      replica->complete(latency, result.status_ <= 0 || result.status_ >= 500);
+    }
+    if (permit) {
+      permit->complete(latency, isFailureOrOverload(result.status_), endpoint);
+    }
+    metrics.upstreamRequestDuration_.withLabels({ method, endpoint,
+      result.status_ > 0 ? to_string(result.status_) : "error" }).observe(
+      static_cast<uint64_t>(max<chrono::microseconds::rep>(latency.count(), 0)));
+
+    if (result.status_ <= 0) {
+      throw std::runtime_error(result.body_);
+    }
+    metrics.upstreamResponseSize_.withLabels({ endpoint }).observe(result.body_.size());
+    if (upstreamTrafficRecorder_) {
+      upstreamTrafficRecorder_->record(method, path, body, result, latency);
     }
 
     json response = {
-      {"status", result->status},
-      {"headers", json::object()},
-      {"body", result->body}
+      {"status", result.status_},
+      {"headers", json::object()}
     };
 
-    for (const auto& [key, value] : result->headers) {
+    for (const auto& [key, value] : result.headers_) {
       response["headers"][key] = value;
     }
 
-    tryToParseResultAsJson(result, response);
-    spdlog::trace("HTTP request successful. Response was: '{}'.", response.dump());
+    if (parseJsonBodies_) {
+      const TraceSpan span("parse upstream response");
+      tryToParseResultAsJson(result.body_, response);
+    }
+    response["body"] = move(result.body_);
+    spdlog::trace("HTTP request successful. Response was: '{}'.", LogPayload(response));
     return response;
 
   } catch (const std::exception& ex) {
@@ -88,6 +203,222 @@ json HttpToolClient::performHttpRequest(const string& method, const string& url,
   }
 }
 
+UpstreamResponse HttpToolClient::exchange(const string& method, const string& baseUrl,
+  const string& path, const string& body, const Headers& headers,
+  chrono::microseconds& latency) {
+  // A failed exchange is returned with status 0 and the reason as body, so that it is measured
+  // like any other exchange before it is turned into an error. The latency is taken from
+  // sending the request to receiving the response, so that it neither includes checking out a
+  // client nor compressing the body.
+  UpstreamResponse response;
+  auto start = chrono::steady_clock::now();
+  if (upstreamTrafficReplayer_) {
+    if (! upstreamTrafficReplayer_->replay(method, path, body, response)) {
+      response.body_ = "No recorded response for " + method + " " + path;
+    }
+    latency = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+    return response;
+  }
+
+  httplib::Headers httpHeaders;
+  for (const auto& [key, value] : headers) {
+    httpHeaders.emplace(key, value);
+  }
+  if (hedgingController_ && method == "GET") {
+    if (const auto delay = hedgingController_->hedgeDelay()) {
+      response = exchangeHedged(baseUrl, path, httpHeaders, *delay);
+      latency = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+      return response;
+    }
+  }
+
+  unique_ptr<httplib::Client> client = checkOutClient(idleClients_, baseUrl);
+  if (method == "GET") {
+    start = chrono::steady_clock::now();
+    response = receive(*client, path, httpHeaders);
+    latency = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+    if (hedgingController_ && response.status_ > 0) {
+      hedgingController_->recordLatency(latency);
+    }
+  } else {
+    const bool isCompressed = requestCompressionThreshold_ > 0 &&
+      body.size() >= requestCompressionThreshold_;
+    const string compressedBody = isCompressed ? compressWithGzip(body) : string();
+    if (isCompressed) {
+      httpHeaders.emplace("Content-Encoding", "gzip");
+    }
+    start = chrono::steady_clock::now();
+    httplib::Result result = sendRequest(*client, method, path, httpHeaders,
+      isCompressed ? compressedBody : body);
+    latency = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+    response = toUpstreamResponse(result);
+  }
+  checkInClient(idleClients_, baseUrl, move(client), determineClientPoolSize(baseUrl));
+  return response;
+}
+
+UpstreamResponse HttpToolClient::exchangeHedged(const string& baseUrl, const string& path,
+  const httplib::Headers& headers, const chrono::microseconds delay) {
+  // Both attempts use a client of their own, so that the loser can be cancelled by stopping
+  // its client without affecting other requests.
+  const auto start = chrono::steady_clock::now();
+  auto read = make_shared<HedgedRead>(start + chrono::seconds(timeoutInSeconds_));
+  unique_ptr<httplib::Client> client = checkOutClient(idleHedgingClients_, baseUrl);
+  limitTimeout(*client, read->deadline_);
+  read->firstClient_ = client.get();
+  hedgeTimer_->schedule(start + delay, [this, read, baseUrl, path, headers] {
+    startHedge(read, baseUrl, path, headers);
+  });
+  UpstreamResponse response = receive(*client, path, headers, &read->isFirstCancelled_);
+  // Only the latency of the first attempt is recorded, as the delay is derived from the
+  // latencies of unhedged reads. A first attempt that has been cancelled took at least as
+  // long as it ran.
+  const auto firstLatency = chrono::duration_cast<chrono::microseconds>(
+    chrono::steady_clock::now() - start);
+
+  unique_lock lock(read->mutex_);
+  read->firstClient_ = nullptr;
+  read->isFirstDone_ = true;
+  if (! read->hedgeResponse_ && response.status_ > 0) {
+    hedgingController_->recordLatency(firstLatency);
+    read->isHedgeCancelled_ = true;
+    if (read->hedgeClient_ != nullptr) {
+      read->hedgeClient_->stop();
+    }
+  } else {
+    // The first attempt failed, or it has been cancelled because the hedge won.
+    if (read->hedgeResponse_) {
+      hedgingController_->recordLatency(firstLatency);
+    }
+    read->condition_.wait_until(lock, read->deadline_,
+      [&read] { return ! read->isHedgeSent_ || read->isHedgeDone_; });
+    if (read->hedgeResponse_) {
+      response = move(*read->hedgeResponse_);
+    } else if (read->isHedgeSent_ && ! read->isHedgeDone_) {
+      read->isHedgeCancelled_ = true;
+      if (read->hedgeClient_ != nullptr) {
+        read->hedgeClient_->stop();
+      }
+    }
+  }
+  lock.unlock();
+  checkInClient(idleHedgingClients_, baseUrl, move(client), MAX_IDLE_HEDGING_CLIENTS);
+  return response;
+}
+
+void HttpToolClient::startHedge(const shared_ptr<HedgedRead>& read, const string& baseUrl,
+  const string& path, const httplib::Headers& headers) {
+  {
+    lock_guard lock(read->mutex_);
+    if (read->isFirstDone_) {
+      return;
+    }
+    // The hedge is skipped rather than queued if the limit of the server has been reached, as a
+    // queued hedge would be too late anyway, and it must not wait on the thread of the timer.
+    if (concurrencyLimits_) {
+      read->hedgePermit_.emplace(retrieveConcurrencyLimiter(baseUrl).tryAcquire());
+      if (! read->hedgePermit_->isAcquired()) {
+        return;
+      }
+    }
+    if (! hedgingController_->tryToSpendBudget()) {
+      if (read->hedgePermit_) {
+        read->hedgePermit_->abandon();
+      }
+      return;
+    }
+    read->isHedgeSent_ = true;
+  }
+  const bool isSubmitted = hedgingPool_->submit([this, read, baseUrl, path, headers] {
+    sendHedge(*read, baseUrl, path, headers);
+  });
+  if (! isSubmitted) {
+    {
+      lock_guard lock(read->mutex_);
+      if (read->hedgePermit_) {
+        read->hedgePermit_->abandon();
+      }
+      read->isHedgeDone_ = true;
+    }
+    read->condition_.notify_all();
+  }
+}
+
+void HttpToolClient::sendHedge(HedgedRead& read, const string& baseUrl, const string& path,
+  const httplib::Headers& headers) {
+  unique_ptr<httplib::Client> client = checkOutClient(idleHedgingClients_, baseUrl);
+  limitTimeout(*client, read.deadline_);
+  unique_lock lock(read.mutex_);
+  if (! read.isHedgeCancelled_) {
+    read.hedgeClient_ = client.get();
+    lock.unlock();
+    const auto start = chrono::steady_clock::now();
+    UpstreamResponse response = receive(*client, path, headers, &read.isHedgeCancelled_);
+    const auto latency = chrono::duration_cast<chrono::microseconds>(
+      chrono::steady_clock::now() - start);
+    lock.lock();
+    read.hedgeClient_ = nullptr;
+    if (read.hedgePermit_) {
+      // A cancelled hedge says nothing about the server.
+      if (read.isHedgeCancelled_) {
+        read.hedgePermit_->abandon();
+      } else {
+        read.hedgePermit_->complete(latency, isFailureOrOverload(response.status_),
+          determineEndpointLabel(path));
+      }
+    }
+    ServerMetrics& metrics = ServerMetrics::instance();
+    if (! read.isHedgeCancelled_ && response.status_ > 0) {
+      read.hedgeResponse_ = move(response);
+      read.isFirstCancelled_ = true;
+      if (read.firstClient_ != nullptr) {
+        read.firstClient_->stop();
+      }
+      metrics.upstreamHedgesWon_.increment();
+    } else {
+      metrics.upstreamHedgesLost_.increment();
+    }
+  } else if (read.hedgePermit_) {
+    read.hedgePermit_->abandon();
+  }
+  read.isHedgeDone_ = true;
+  lock.unlock();
+  read.condition_.notify_all();
+  checkInClient(idleHedgingClients_, baseUrl, move(client), MAX_IDLE_HEDGING_CLIENTS);
+}
+
+httplib::Result HttpToolClient::sendRequest(httplib::Client& client, const string& method,
+  const string& path, const httplib::Headers& headers, const string& body) const {
+  if (method == "POST") {
+    return client.Post(path, headers, body, JSON_MIME_TYPE);
+  } else if (method == "PUT") {
+    return client.Put(path, headers, body, JSON_MIME_TYPE);
+  } else if (method == "DELETE") {
+    return client.Delete(path, headers);
+  }
+  throw std::runtime_error("Unsupported HTTP method: " + method);
+}
+
+string HttpToolClient::determineEndpointLabel(const string& path) const {
+  // Path segments that contain digits are identifiers (UUIDs, commit ids, ...). They are
+  // replaced, so that all requests to the same endpoint share one label value.
+  const string_view pathWithoutQuery = string_view(path).substr(0, path.find('?'));
+  string label;
+  size_t segmentStart { 0 };
+  while (segmentStart < pathWithoutQuery.size()) {
+    size_t segmentEnd = pathWithoutQuery.find('/', segmentStart + 1);
+    if (segmentEnd == string_view::npos) {
+      segmentEnd = pathWithoutQuery.size();
+    }
+    const string_view segment = pathWithoutQuery.substr(segmentStart, segmentEnd - segmentStart);
+    const bool isIdentifier = any_of(segment.begin(), segment.end(),
+      [](const char character) { return character >= '0' && character <= '9'; });
+    label += isIdentifier ? "/{id}" : segment;
+    segmentStart = segmentEnd;
+  }
+  return label.empty() ? "/" : label;
+}
+
 string HttpToolClient::extractBaseUrl(const string& fullUrl) const {
   const regex url_regex(R"((https?://[^/]+))");
   smatch match;
@@ -106,26 +437,96 @@ string HttpToolClient::extractPathFromUrl(const string& fullUrl) const {
   return "/";
 }
 
-httplib::Client* HttpToolClient::retrieveClient(const std::string& baseUrl) {
-  if (httpClients_.find(baseUrl) == httpClients_.end()) {
-    httpClients_[baseUrl] = std::make_unique<httplib::Client>(baseUrl);
-    httpClients_[baseUrl]->set_read_timeout(timeoutInSeconds_);
-    httpClients_[baseUrl]->set_write_timeout(timeoutInSeconds_);
-    httpClients_[baseUrl]->set_connection_timeout(timeoutInSeconds_);
-    spdlog::info("New HTTP client created for server at URL {}.", baseUrl);
+unique_ptr<httplib::Client> HttpToolClient::createClient(const string& baseUrl) const {
+  auto client = std::make_unique<httplib::Client>(baseUrl);
+  client->set_read_timeout(timeoutInSeconds_);
+  client->set_write_timeout(timeoutInSeconds_);
+  client->set_connection_timeout(timeoutInSeconds_);
+  // Responses are requested in the encodings compiled into httplib (gzip, zstd), which sends
+  // them as Accept-Encoding, and are decompressed while they are received.
+  client->set_decompress(true);
+  return client;
+}
+
+AdaptiveConcurrencyLimiter& HttpToolClient::retrieveConcurrencyLimiter(const string& baseUrl) {
+  lock_guard lock(httpClientsMutex_);
+  auto& limiter = concurrencyLimiters_[baseUrl];
+  if (! limiter) {
+    limiter = make_unique<AdaptiveConcurrencyLimiter>(baseUrl, *concurrencyLimits_);
   }
-  return httpClients_[baseUrl].get();
+  return *limiter;
 }
 
-void HttpToolClient::tryToParseResultAsJson(const httplib::Result& result, json& response) const {
-  if (! result->body.empty()) {
+unique_ptr<httplib::Client> HttpToolClient::checkOutClient(IdleClients& idleClients,
+  const string& baseUrl) {
+  {
+    lock_guard lock(httpClientsMutex_);
+    auto& idleClientsOfServer = idleClients[baseUrl];
+    if (! idleClientsOfServer.empty()) {
+      unique_ptr<httplib::Client> client = move(idleClientsOfServer.back());
+      idleClientsOfServer.pop_back();
+      return client;
+    }
+  }
+  return createClient(baseUrl);
+}
+
+void HttpToolClient::checkInClient(IdleClients& idleClients, const string& baseUrl,
+  unique_ptr<httplib::Client> client, const size_t maxIdleClients) {
+  lock_guard lock(httpClientsMutex_);
+  auto& idleClientsOfServer = idleClients[baseUrl];
+  if (idleClientsOfServer.size() < maxIdleClients) {
+    idleClientsOfServer.push_back(move(client));
+  }
+}
+
+size_t HttpToolClient::determineClientPoolSize(const string& baseUrl) {
+  // As many clients are kept as requests may be in flight to the server. A limit that shrinks
+  // is followed as the surplus clients are checked in.
+  return concurrencyLimits_ ? retrieveConcurrencyLimiter(baseUrl).limit() :
+    globals::DEFAULT_MAX_UPSTREAM_CONCURRENCY;
+}
+
+void HttpToolClient::tryToParseResultAsJson(const string& body, json& response) const {
+  if (! body.empty()) {
     try {
-      const json parsedBody = json::parse(result->body);
-      response["json"] = parsedBody;
+      response["json"] = json::parse(body);
     } catch (...) {
-      // result->body is not valid JSON: Do nothing and leave the response untouched.
+      // body is not valid JSON: Do nothing and leave the response untouched.
     }
   }
 }
 
+void HttpToolClient::setParseJsonBodies(const bool parseJsonBodies) noexcept {
+  parseJsonBodies_ = parseJsonBodies;
+}
+
+void HttpToolClient::recordUpstreamTraffic(
+  shared_ptr<UpstreamTrafficRecorder> recorder) noexcept {
+  upstreamTrafficRecorder_ = move(recorder);
+}
+
+void HttpToolClient::replayUpstreamTraffic(
+  shared_ptr<UpstreamTrafficReplayer> replayer) noexcept {
+  upstreamTrafficReplayer_ = move(replayer);
+}
+
+void HttpToolClient::balanceUpstreamRequests(shared_ptr<UpstreamBalancer> balancer) noexcept {
+  upstreamBalancer_ = move(balancer);
+}
+
+void HttpToolClient::hedgeUpstreamReads(const HedgingPolicy& policy) {
+  hedgingController_ = make_unique<HedgingController>(policy);
+  hedgingPool_ = make_unique<WorkerPool>(globals::HEDGING_THREADS);
+  hedgeTimer_ = make_unique<HedgeTimer>();
+}
+
+void HttpToolClient::limitUpstreamConcurrency(const ConcurrencyLimits& limits) {
+  concurrencyLimits_ = limits;
+}
+
+void HttpToolClient::compressRequestBodies(const size_t minBodySize) noexcept {
+  requestCompressionThreshold_ = minBodySize;
+}
+
 const char* const HttpToolClient::JSON_MIME_TYPE = "application/json";
\ No newline at end of file
@@ -1,13 +1,22 @@
 #pragma once
 
 #include <httplib.h>
-#include <nlohmann/json.hpp>
+#include "arenajson.hpp"
+#include "concurrencylimiter.hpp"
+#include "upstreambalancer.hpp"
+#include "upstreamhedging.hpp"
+#include "upstreamtraffic.hpp"
+#include "workerpool.hpp"
 
+#include <chrono>
+#include <cstddef>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <vector>
 
-using json = nlohmann::json;
 using Headers = std::map<std::string, std::string>;
 
 /// @brief HTTP client for external tool calls.
@@ -42,20 +51,90 @@ public:
   /// @return The response from the server.
   json httpDelete(const std::string& url, const Headers& headers = {});
 
+  /// @brief Writes every upstream request and its response to the recorder.
+  void recordUpstreamTraffic(std::shared_ptr<UpstreamTrafficRecorder> recorder) noexcept;
+
+  /// @brief Answers upstream requests from the replayer without any network access. Requests
+  /// for which no response has been recorded fail.
+  void replayUpstreamTraffic(std::shared_ptr<UpstreamTrafficReplayer> replayer) noexcept;
+
+  /// @brief Balances GET requests to the primary URL of the balancer across its replicas.
+  /// All other requests are sent to the primary.
+  void balanceUpstreamRequests(std::shared_ptr<UpstreamBalancer> balancer) noexcept;
+
+  /// @brief Hedges GET requests: If the response to a GET request is later than the delay
+  /// chosen by the policy, the request is sent a second time on another connection. The
+  /// first response is taken, and the other request is cancelled. Neither request outlives
+  /// the timeout of the read.
+  void hedgeUpstreamReads(const HedgingPolicy& policy);
+
+  /// @brief Limits the number of concurrent requests to each upstream server adaptively.
+  /// Requests beyond the limit wait until their deadline, which is the timeout of the request.
+  /// Hedges are only sent if a permit is free at once.
+  void limitUpstreamConcurrency(const ConcurrencyLimits& limits);
+
+  /// @brief Compresses the bodies of POST and PUT requests with gzip if they have at least the
+  /// given size. The upstream server must accept the 'Content-Encoding' gzip.
+  /// @param minBodySize is the minimum size in bytes, or 0 to switch compression off.
+  void compressRequestBodies(const std::size_t minBodySize) noexcept;
+
   virtual ~HttpToolClient() = default;
 
 protected:
   json performHttpRequest(const std::string& method, const std::string& url,
     const std::string& body, const Headers& headers);
 
+  /// @brief Defines whether JSON response bodies are parsed into the member 'json' of the
+  /// returned response (the default). Subclasses that read the raw 'body' on demand switch
+  /// this off, so that no DOM is built for it.
+  void setParseJsonBodies(const bool parseJsonBodies) noexcept;
+
+  std::string extractBaseUrl(const std::string& fullUrl) const;
+  std::string extractPathFromUrl(const std::string& fullUrl) const;
+
   static const char* const JSON_MIME_TYPE;
   
 private:
-  std::string extractBaseUrl(const std::string& fullUrl) const;
-  std::string extractPathFromUrl(const std::string& fullUrl) const;
-  httplib::Client* retrieveClient(const std::string& baseUrl);
-  void tryToParseResultAsJson(const httplib::Result& result, json& response) const;
+  struct HedgedRead;
+  // The idle clients of each server. A client is checked out for one request at a time, as
+  // httplib serializes the requests on a client.
+  using IdleClients = std::map<std::string, std::vector<std::unique_ptr<httplib::Client>>>;
+
+  std::unique_ptr<httplib::Client> createClient(const std::string& baseUrl) const;
+  AdaptiveConcurrencyLimiter& retrieveConcurrencyLimiter(const std::string& baseUrl);
+  std::unique_ptr<httplib::Client> checkOutClient(IdleClients& idleClients,
+    const std::string& baseUrl);
+  void checkInClient(IdleClients& idleClients, const std::string& baseUrl,
+    std::unique_ptr<httplib::Client> client, const std::size_t maxIdleClients);
+  std::size_t determineClientPoolSize(const std::string& baseUrl);
+  httplib::Result sendRequest(httplib::Client& client, const std::string& method,
+    const std::string& path, const httplib::Headers& headers, const std::string& body) const;
+  std::string determineEndpointLabel(const std::string& path) const;
+  UpstreamResponse exchange(const std::string& method, const std::string& url,
+    const std::string& path, const std::string& body, const Headers& headers,
+    std::chrono::microseconds& latency);
+  UpstreamResponse exchangeHedged(const std::string& baseUrl, const std::string& path,
+    const httplib::Headers& headers, const std::chrono::microseconds delay);
+  void startHedge(const std::shared_ptr<HedgedRead>& read, const std::string& baseUrl,
+    const std::string& path, const httplib::Headers& headers);
+  void sendHedge(HedgedRead& read, const std::string& baseUrl, const std::string& path,
+    const httplib::Headers& headers);
+  void tryToParseResultAsJson(const std::string& body, json& response) const;
 
-  std::map<std::string, std::unique_ptr<httplib::Client>> httpClients_;
+  IdleClients idleClients_;
+  std::mutex httpClientsMutex_;
   int timeoutInSeconds_ { 30 };
+  bool parseJsonBodies_ { true };
+  std::size_t requestCompressionThreshold_ { 0 };
+  std::shared_ptr<UpstreamTrafficRecorder> upstreamTrafficRecorder_;
+  std::shared_ptr<UpstreamTrafficReplayer> upstreamTrafficReplayer_;
+  std::shared_ptr<UpstreamBalancer> upstreamBalancer_;
+  IdleClients idleHedgingClients_;
+  std::unique_ptr<HedgingController> hedgingController_;
+  std::optional<ConcurrencyLimits> concurrencyLimits_;
+  std::map<std::string, std::unique_ptr<AdaptiveConcurrencyLimiter>> concurrencyLimiters_;
+  // Declared last, so that outstanding hedges are done before the clients are destroyed, and
+  // the timer, which submits hedges to the pool, is stopped before the pool.
+  std::unique_ptr<WorkerPool> hedgingPool_;
+  std::unique_ptr<HedgeTimer> hedgeTimer_;
 };
\ No newline at end of file
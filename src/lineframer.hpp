@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/// @brief Splits received data into newline-delimited frames, as JSON-RPC messages are framed
+/// on stdio and on Unix domain sockets.
+///
+/// Data is appended as it arrives. The buffer is scanned for line breaks only once, and all
+/// frames found are erased from it at once, so a frame that arrives in many small pieces is
+/// still split in linear time.
+class LineFramer {
+public:
+  /// @brief Appends received data.
+  void append(const char* data, const std::size_t length) {
+    buffer_.append(data, length);
+  }
+
+  /// @brief Terminates the last frame at the end of the input, if it lacks a line break.
+  void finish() {
+    if (! buffer_.empty() && buffer_.back() != '\n') {
+      buffer_ += '\n';
+    }
+  }
+
+  /// @brief Removes all complete frames from the buffer and passes them to a callback, in the
+  /// order in which they have been received. Empty frames are skipped, and a carriage return
+  /// before the line break is removed.
+  /// @param onFrame is called with a std::string_view of every frame, which is only valid
+  /// during the call.
+  template<typename OnFrame>
+  void extractFrames(OnFrame&& onFrame) {
+    std::size_t startOfFrame { 0 };
+    std::size_t endOfFrame = buffer_.find('\n', scanOffset_);
+    while (endOfFrame != std::string::npos) {
+      std::string_view frame(buffer_.data() + startOfFrame, endOfFrame - startOfFrame);
+      if (! frame.empty() && frame.back() == '\r') {
+        frame.remove_suffix(1);
+      }
+      if (! frame.empty()) {
+        onFrame(frame);
+      }
+      startOfFrame = endOfFrame + 1;
+      endOfFrame = buffer_.find('\n', startOfFrame);
+    }
+    buffer_.erase(0, startOfFrame);
+    scanOffset_ = buffer_.size();
+  }
+
+  /// @return the size in bytes of the incomplete frame at the end of the buffer.
+  std::size_t bufferedSize() const noexcept {
+    return buffer_.size();
+  }
+
+private:
+  std::string buffer_;
+  std::size_t scanOffset_ { 0 };
+};
@@ -0,0 +1,98 @@
+#include "logpayload.hpp"
+#include "globals.hpp"
+
+#include <ostream>
+#include <streambuf>
+
+using namespace std;
+
+namespace {
+  const char* const TRUNCATION_MARK { "...(truncated)" };
+  const char* const NOT_SAMPLED_PLACEHOLDER { "(payload not sampled)" };
+
+  // Signals that the maximum payload size has been reached, so that serialization stops early.
+  struct PayloadSizeReached { };
+
+  // Appends what is streamed into a string, up to a maximum size.
+  class BoundedStringBuffer : public streambuf {
+  public:
+    BoundedStringBuffer(string& output, const size_t maxSizeInBytes) :
+      output_(output), maxSizeInBytes_(maxSizeInBytes) { }
+
+  protected:
+    int_type overflow(const int_type character) override {
+      if (! traits_type::eq_int_type(character, traits_type::eof())) {
+        const char_type converted = traits_type::to_char_type(character);
+        xsputn(&converted, 1);
+      }
+      return traits_type::not_eof(character);
+    }
+
+    streamsize xsputn(const char_type* characters, const streamsize count) override {
+      const size_t length = static_cast<size_t>(count);
+      const size_t remaining = maxSizeInBytes_ - output_.size();
+      if (length > remaining) {
+        output_.append(characters, remaining);
+        throw PayloadSizeReached();
+      }
+      output_.append(characters, length);
+      return count;
+    }
+
+  private:
+    string& output_;
+    const size_t maxSizeInBytes_;
+  };
+}
+
+atomic<size_t> LogPayload::maxSizeInBytes_ { globals::DEFAULT_MAX_LOGGED_PAYLOAD_SIZE };
+atomic<unsigned int> LogPayload::samplingRate_ { 1 };
+atomic<unsigned int> LogPayload::samplingCounter_ { 0 };
+
+LogPayload::LogPayload(const json& value) noexcept : value_(&value) { }
+
+LogPayload::LogPayload(const string_view text) noexcept : text_(text) { }
+
+void LogPayload::configure(const size_t maxSizeInBytes, const unsigned int samplingRate) noexcept {
+  maxSizeInBytes_.store(maxSizeInBytes, memory_order_relaxed);
+  samplingRate_.store(samplingRate, memory_order_relaxed);
+}
+
+string LogPayload::render() const {
+  if (! isSampled()) {
+    return NOT_SAMPLED_PLACEHOLDER;
+  }
+
+  const size_t maxSizeInBytes = maxSizeInBytes_.load(memory_order_relaxed);
+  string rendered;
+  if (value_ == nullptr) {
+    if (text_.size() <= maxSizeInBytes) {
+      return string(text_);
+    }
+    rendered.assign(text_.substr(0, maxSizeInBytes));
+    return rendered + TRUNCATION_MARK;
+  }
+
+  // The stream rethrows what its buffer throws, so serialization stops at the maximum size.
+  BoundedStringBuffer buffer(rendered, maxSizeInBytes);
+  ostream stream(&buffer);
+  stream.exceptions(ios_base::badbit);
+  try {
+    stream << *value_;
+  } catch (const PayloadSizeReached&) {
+    rendered += TRUNCATION_MARK;
+  } catch (const json::type_error&) {
+    // Strings with invalid UTF-8 cannot be streamed, they are dumped with replacements instead.
+    rendered = value_->dump(-1, ' ', false, json::error_handler_t::replace);
+    if (rendered.size() > maxSizeInBytes) {
+      rendered.resize(maxSizeInBytes);
+      rendered += TRUNCATION_MARK;
+    }
+  }
+  return rendered;
+}
+
+bool LogPayload::isSampled() const noexcept {
+  const unsigned int samplingRate = samplingRate_.load(memory_order_relaxed);
+  return samplingRate <= 1 || samplingCounter_.fetch_add(1, memory_order_relaxed) % samplingRate == 0;
+}
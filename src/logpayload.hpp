@@ -0,0 +1,58 @@
+#pragma once
+
+#include "arenajson.hpp"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/// @brief A JSON value or text that is passed as an argument of a log message.
+///
+/// The payload is only referenced, not copied. It is serialized when the message is formatted,
+/// i.e. only if the level of the message is enabled, and serialization stops as soon as the
+/// maximum payload size has been reached. If sampling is configured, only every n-th payload
+/// is written at all; the others are replaced by a short placeholder.
+///
+/// Usage: spdlog::trace("Request: {}", LogPayload(request));
+class LogPayload {
+public:
+  explicit LogPayload(const json& value) noexcept;
+  explicit LogPayload(std::string_view text) noexcept;
+  explicit LogPayload(const std::string& text) noexcept : LogPayload(std::string_view(text)) { }
+
+  /// @brief Configures how payloads are written, for all threads.
+  /// @param maxSizeInBytes is the maximum number of characters written per payload.
+  /// @param samplingRate causes only every samplingRate-th payload to be written (0 and 1 mean
+  /// that all payloads are written).
+  static void configure(const std::size_t maxSizeInBytes, const unsigned int samplingRate) noexcept;
+
+  /// @brief Renders the payload as it is written into the log.
+  std::string render() const;
+
+private:
+  bool isSampled() const noexcept;
+
+  const json* value_ { nullptr };
+  std::string_view text_;
+
+  static std::atomic<std::size_t> maxSizeInBytes_;
+  static std::atomic<unsigned int> samplingRate_;
+  static std::atomic<unsigned int> samplingCounter_;
+};
+
+template<>
+struct fmt::formatter<LogPayload> {
+  constexpr auto parse(fmt::format_parse_context& context) {
+    return context.begin();
+  }
+
+  template<typename FormatContext>
+  auto format(const LogPayload& payload, FormatContext& context) const {
+    const std::string rendered = payload.render();
+    return std::copy(rendered.begin(), rendered.end(), context.out());
+  }
+};
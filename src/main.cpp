@@ -1,21 +1,41 @@
 #include "globals.hpp"
 #include "commandlineargumentparser.hpp"
 #include "httpmcptransport.hpp"
+#include "logpayload.hpp"
 #include "mcpserver.hpp"
 #include "stdinstdoutmcptransport.hpp"
 #include "sysmlv2/sysmlv2apiclient.hpp"
+#include "tracing.hpp"
+
+#ifdef __linux__
+#include "epollhttpmcptransport.hpp"
+#include "unixsocketmcptransport.hpp"
+#endif
 
 #include <spdlog/spdlog.h>
+#include <spdlog/async.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
+#include <iostream>
+
 // Forward declarations
-void initializeLogging(const spdlog::filename_t& logFileName);
+void initializeLogging(const ProgramOptions& programOptions);
+spdlog::level::level_enum determineSpdlogLevel(const LogLevel logLevel);
 
 int main(int argc, const char** argv) {
   CommandLineArgumentParser parser{ globals::APPLICATION_NAME,
     globals::APPLICATION_VERSION };
   ProgramOptions programOptions = parser.parse(argc, argv);
-  initializeLogging(programOptions.logFileName_);
+  initializeLogging(programOptions);
+  if (! programOptions.traceFileName_.empty()) {
+    try {
+      Tracer::start(programOptions.traceFileName_, programOptions.traceSampling_);
+    } catch (const std::runtime_error& ex) {
+      spdlog::critical("FATAL ERROR - Tracing could not be started. Reason: {}", ex.what());
+      spdlog::shutdown();
+      return EXIT_FAILURE;
+    }
+  }
 
   // Step 1: Configure the server
   MCPServer server { globals::APPLICATION_NAME, globals::APPLICATION_VERSION,
@@ -23,9 +43,38 @@ int main(int argc, const char** argv) {
   if (programOptions.mcpTransportKind_ == McpTransportKind::stdinout) {
     server.setMcpTransport(std::make_unique<StdinStdoutMcpTransport>());
     spdlog::info("MCP transport configured to stdin/stdout.");
-  } else {
-    server.setMcpTransport(std::make_unique<HttpMcpTransport>(globals::APPLICATION_NAME,
+  } else if (programOptions.mcpTransportKind_ == McpTransportKind::epoll) {
+#ifdef __linux__
+    server.setMcpTransport(std::make_unique<EpollHttpMcpTransport>(globals::APPLICATION_NAME,
       globals::APPLICATION_VERSION));
+    spdlog::info("MCP transport configured to HTTP (epoll).");
+#else
+    spdlog::critical("FATAL ERROR - The 'epoll' MCP transport is only available on Linux.");
+    return EXIT_FAILURE;
+#endif
+  } else if (programOptions.mcpTransportKind_ == McpTransportKind::unixsocket) {
+#ifdef __linux__
+    UnixSocketMcpTransport::AccessPolicy accessPolicy;
+    if (! programOptions.allowedPeerUids_.empty()) {
+      accessPolicy = UnixSocketMcpTransport::allowUids({ programOptions.allowedPeerUids_.begin(),
+        programOptions.allowedPeerUids_.end() });
+    }
+    server.setMcpTransport(std::make_unique<UnixSocketMcpTransport>(
+      programOptions.unixSocketPath_, accessPolicy));
+    spdlog::info("MCP transport configured to Unix domain socket '{}'.",
+      programOptions.unixSocketPath_);
+#else
+    spdlog::critical("FATAL ERROR - The 'unix' MCP transport is only available on Linux.");
+    return EXIT_FAILURE;
+#endif
+  } else {
+    auto httpMcpTransport = std::make_unique<HttpMcpTransport>(globals::APPLICATION_NAME,
+      globals::APPLICATION_VERSION);
+    httpMcpTransport->setAdmissionLimits({ programOptions.maxRequestsInFlight_,
+      programOptions.maxQueuedRequests_,
+      std::chrono::milliseconds(programOptions.maxQueueTimeInMilliseconds_) });
+    httpMcpTransport->setMinCompressedResponseSize(programOptions.minCompressedResponseSize_);
+    server.setMcpTransport(std::move(httpMcpTransport));
     spdlog::info("MCP transport configured to HTTP.");
   }
 
@@ -34,6 +83,8 @@ int main(int argc, const char** argv) {
     server.run();
   } catch (const std::runtime_error& ex) {
     spdlog::critical("FATAL ERROR - Server start failed. Reason: {}", ex.what());
+    Tracer::stop();
+    spdlog::shutdown();
     return EXIT_FAILURE;
   }
 
@@ -43,18 +94,36 @@ int main(int argc, const char** argv) {
   }
 
   server.stop();
+  Tracer::stop();
   spdlog::info("Server successfully stopped. Good bye!");
+  spdlog::shutdown();
   return EXIT_SUCCESS;
 }
 
-void initializeLogging([[maybe_unused]]const spdlog::filename_t& logFileName) {
+void initializeLogging(const ProgramOptions& programOptions) {
   try {
-    auto logger = spdlog::basic_logger_mt(globals::APPLICATION_NAME, logFileName);
+    // Messages are formatted by the logging thread and written to the file by a single
+    // background thread, so the file sink needs no lock of its own.
+    spdlog::init_thread_pool(globals::LOG_QUEUE_CAPACITY, 1);
+    auto logger = spdlog::create_async_nb<spdlog::sinks::basic_file_sink_st>(
+      globals::APPLICATION_NAME, programOptions.logFileName_);
     spdlog::set_default_logger(logger);
-    spdlog::default_logger()->set_level(spdlog::level::trace);
+    spdlog::set_level(determineSpdlogLevel(programOptions.logLevel_));
+    spdlog::flush_on(spdlog::level::err);
     spdlog::flush_every(std::chrono::seconds(2));
+    LogPayload::configure(programOptions.maxLoggedPayloadSize_, programOptions.payloadLogSampling_);
     spdlog::trace("Initialization of logging successful.");
   } catch (const spdlog::spdlog_ex &ex) {
     std::cerr << "Initialization of logging failed: " << ex.what() << std::endl;
   }
-}
\ No newline at end of file
+}
+
+spdlog::level::level_enum determineSpdlogLevel(const LogLevel logLevel) {
+  switch (logLevel) {
+    case LogLevel::trace: return spdlog::level::trace;
+    case LogLevel::debug: return spdlog::level::debug;
+    case LogLevel::info: return spdlog::level::info;
+    case LogLevel::warn: return spdlog::level::warn;
+    default: return spdlog::level::err;
+  }
+}
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <nlohmann/json.hpp>
+#include "arenajson.hpp"
 
 #include <functional>
 #include <string>
@@ -14,6 +14,6 @@ public:
   virtual void registerPrompt(const std::string& promptName,
     const std::string& title,
     const std::string& description,
-    const nlohmann::json& arguments) = 0;
+    const json& arguments) = 0;
   virtual ~MCPPromptRegistry() = default;
 };
\ No newline at end of file
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <nlohmann/json.hpp>
+#include "arenajson.hpp"
 
 #include <functional>
 #include <string>
@@ -15,6 +15,6 @@ public:
     const std::string& uri,
     const std::string& description,
     const std::string& mimeType,
-    std::function<nlohmann::json()> handler) = 0;
+    std::function<json()> handler) = 0;
   virtual ~MCPResourceRegistry() = default;
 };
\ No newline at end of file
@@ -2,11 +2,184 @@
 #include "globals.hpp"
 #include "sysmlv2/sysmlv2apiclient.hpp"
 #include "httptoolclient.hpp"
+#include "logpayload.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
 
+#include <simdjson.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
 using namespace std;
 
+namespace {
+  constexpr uint32_t hashMethodName(const string_view name) noexcept {
+    uint32_t hash { 2166136261u };
+    for (const char character : name) {
+      hash ^= static_cast<unsigned char>(character);
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+  constexpr size_t MAX_DISPATCH_TABLE_SIZE { 64 };
+
+  template<typename Entries>
+  constexpr bool isCollisionFree(const Entries& entries, const size_t tableSize) noexcept {
+    array<bool, MAX_DISPATCH_TABLE_SIZE> occupied {};
+    for (const auto& entry : entries) {
+      const size_t slot = hashMethodName(entry.method_) % tableSize;
+      if (occupied[slot]) {
+        return false;
+      }
+      occupied[slot] = true;
+    }
+    return true;
+  }
+
+  template<typename Entries>
+  constexpr size_t determineDispatchTableSize(const Entries& entries) noexcept {
+    for (size_t tableSize = entries.size(); tableSize <= MAX_DISPATCH_TABLE_SIZE; ++tableSize) {
+      if (isCollisionFree(entries, tableSize)) {
+        return tableSize;
+      }
+    }
+    return 0;
+  }
+
+  template<size_t TableSize, typename Entries>
+  constexpr array<int8_t, TableSize> buildDispatchSlots(const Entries& entries) noexcept {
+    array<int8_t, TableSize> slots {};
+    slots.fill(-1);
+    for (size_t index = 0; index < entries.size(); ++index) {
+      slots[hashMethodName(entries[index].method_) % TableSize] = static_cast<int8_t>(index);
+    }
+    return slots;
+  }
+
+  /// The methods that are answered without calling out to a tool, so they are scheduled in the
+  /// fast lane, as are all notifications. All other methods are slow unless they call a fast tool.
+  constexpr array<string_view, 5> FAST_LANE_METHODS {
+    "initialize", "ping", "tools/list", "prompts/list", "resources/list" };
+  constexpr string_view NOTIFICATION_METHOD_PREFIX { "notifications/" };
+  /// Only this prefix of a request is parsed to classify it, so that a large request is not copied
+  /// on the I/O thread.
+  constexpr size_t MAX_CLASSIFIED_PREFIX_SIZE { 4096 };
+
+  /// @brief Closes the strings, arrays and objects that are still open at the end of a prefix of
+  /// a JSON document, so that the fields before the cut can be read.
+  void closeJsonPrefix(string& prefix) {
+    string closers;
+    bool isInString { false };
+    bool isEscaped { false };
+    for (const char character : prefix) {
+      if (isEscaped) {
+        isEscaped = false;
+      } else if (isInString) {
+        isEscaped = character == '\\';
+        isInString = character != '"';
+      } else if (character == '"') {
+        isInString = true;
+      } else if (character == '{' || character == '[') {
+        closers.push_back(character == '{' ? '}' : ']');
+      } else if ((character == '}' || character == ']') && ! closers.empty()) {
+        closers.pop_back();
+      }
+    }
+    if (isEscaped) {
+      prefix.pop_back();
+    }
+    if (isInString) {
+      prefix.push_back('"');
+    }
+    prefix.append(closers.rbegin(), closers.rend());
+  }
+}
+
+/// @brief An entry of the table that maps the names of the supported MCP methods to their
+/// handlers. Methods whose result may already be available in serialized form additionally
+/// name a function that retrieves it (or returns nullptr if it is not available).
+struct MCPServer::MethodDispatchEntry {
+  string_view method_;
+  json (*handler_)(MCPServer& server, const json& parameters);
+  bool isNotification_;
+  shared_ptr<const string> (*retrieveSerializedResult_)(MCPServer& server,
+    const json& parameters);
+};
+
+/// @brief The method dispatch table, a perfect hash table that is built at compile time.
+///
+/// The size of the table is chosen such that the FNV-1a hashes of all method names fall into
+/// distinct slots, so a lookup costs one hash computation and a single string comparison.
+class MCPServer::MethodDispatcher {
+public:
+  static constexpr const MethodDispatchEntry* find(const string_view method) noexcept {
+    const int8_t index = SLOTS[hashMethodName(method) % SLOTS.size()];
+    if (index < 0 || ENTRIES[static_cast<size_t>(index)].method_ != method) {
+      return nullptr;
+    }
+    return &ENTRIES[static_cast<size_t>(index)];
+  }
+
+  /// @brief Retrieves the latency histogram of a method, or of unknown methods if the entry
+  /// is nullptr. The histograms are looked up once, so recording needs no label lookup.
+  static Histogram& durationOf(const MethodDispatchEntry* entry) {
+    static const array<Histogram*, ENTRIES.size() + 1> histograms = [] {
+      auto& family = ServerMetrics::instance().mcpRequestDuration_;
+      array<Histogram*, ENTRIES.size() + 1> result {};
+      for (size_t index = 0; index < ENTRIES.size(); ++index) {
+        result[index] = &family.withLabels({ string(ENTRIES[index].method_) });
+      }
+      result.back() = &family.withLabels({ "unknown" });
+      return result;
+    }();
+    return *histograms[entry != nullptr ? static_cast<size_t>(entry - ENTRIES.data()) :
+      ENTRIES.size()];
+  }
+
+private:
+  static constexpr array<MethodDispatchEntry, 8> ENTRIES {{
+    { "initialize", [](MCPServer& server, const json& parameters) {
+        return server.performInitialization(parameters); }, false, nullptr },
+    { "notifications/initialized", [](MCPServer&, const json&) {
+        spdlog::info("Capability negotiation handshake successful. Client is ready to "
+          "begin normal operations.");
+        return json(); }, true, nullptr },
+    { "ping", [](MCPServer&, const json&) {
+        return json::object(); }, false, nullptr },
+    { "tools/list", [](MCPServer& server, const json&) {
+        return server.determineListOfAvailableTools(); }, false,
+      [](MCPServer& server, const json&) {
+        return server.retrieveSerializedList(server.serializedToolList_,
+          &MCPServer::determineListOfAvailableTools); } },
+    { "tools/call", [](MCPServer& server, const json& parameters) {
+        return server.callTool(parameters); }, false,
+      [](MCPServer& server, const json& parameters) {
+        return server.retrieveMemoizedToolResult(parameters); } },
+    { "resources/list", [](MCPServer& server, const json&) {
+        return server.determineListOfAvailableResources(); }, false,
+      [](MCPServer& server, const json&) {
+        return server.retrieveSerializedList(server.serializedResourceList_,
+          &MCPServer::determineListOfAvailableResources); } },
+    { "resources/read", [](MCPServer& server, const json& parameters) {
+        return server.readResource(parameters); }, false, nullptr },
+    { "prompts/list", [](MCPServer& server, const json&) {
+        return server.determineListOfAvailablePrompts(); }, false,
+      [](MCPServer& server, const json&) {
+        return server.retrieveSerializedList(server.serializedPromptList_,
+          &MCPServer::determineListOfAvailablePrompts); } }
+  }};
+
+  static constexpr size_t TABLE_SIZE { determineDispatchTableSize(ENTRIES) };
+  static_assert(TABLE_SIZE != 0, "No collision-free table size found for the MCP method names.");
+
+  static constexpr array<int8_t, TABLE_SIZE> SLOTS { buildDispatchSlots<TABLE_SIZE>(ENTRIES) };
+};
+
 MCPServer::MCPServer(const string_view name, const string_view version) noexcept :
   MCPServer { name, version, ProgramOptions() } {
 }
@@ -34,12 +207,52 @@ void MCPServer::run() {
   if (! mcpTransport_) {
     throw runtime_error("No transport for MCP request/response configured!");
   }
-  
+  setupUpstreamTraffic();
+
+  mcpTransport_->setRequestClassifier([this](const string_view request) {
+    return this->determineLane(request);
+  });
   mcpTransport_->start([this](const json& request) {
-    return this->handleRequest(request);
+    return this->handleRequestSerialized(request);
   });
 }
 
+void MCPServer::setupUpstreamTraffic() {
+  if (! httpToolClient_) {
+    return;
+  }
+  if (! programOptions_.upstreamReplayFileName_.empty()) {
+    const UpstreamTrafficReplayer::Latency latency { programOptions_.replayRecordedLatency_,
+      chrono::milliseconds(programOptions_.replayLatencyInMilliseconds_) };
+    httpToolClient_->replayUpstreamTraffic(make_shared<UpstreamTrafficReplayer>(
+      programOptions_.upstreamReplayFileName_, latency));
+    spdlog::info("Upstream requests are answered from the recording file '{}'.",
+      programOptions_.upstreamReplayFileName_);
+  }
+  if (! programOptions_.upstreamRecordFileName_.empty()) {
+    httpToolClient_->recordUpstreamTraffic(make_shared<UpstreamTrafficRecorder>(
+      programOptions_.upstreamRecordFileName_));
+    spdlog::info("Upstream traffic is recorded to the file '{}'.",
+      programOptions_.upstreamRecordFileName_);
+  }
+  if (programOptions_.maxUpstreamConcurrency_ > 0) {
+    ConcurrencyLimits limits;
+    limits.maxLimit_ = programOptions_.maxUpstreamConcurrency_;
+    httpToolClient_->limitUpstreamConcurrency(limits);
+  }
+  if (programOptions_.minCompressedRequestSize_ > 0) {
+    httpToolClient_->compressRequestBodies(programOptions_.minCompressedRequestSize_);
+  }
+  if (programOptions_.hedgingPercentile_ > 0.0) {
+    HedgingPolicy policy;
+    policy.percentile_ = programOptions_.hedgingPercentile_;
+    policy.budget_ = programOptions_.hedgingBudgetInPercent_ / 100.0;
+    httpToolClient_->hedgeUpstreamReads(policy);
+    spdlog::info("Upstream reads slower than the {}th percentile are hedged.",
+      programOptions_.hedgingPercentile_);
+  }
+}
+
 void MCPServer::stop() noexcept {
   if (mcpTransport_) {
     mcpTransport_->stop();
@@ -51,34 +264,19 @@ bool MCPServer::isRunning() const noexcept {
 }
 
 json MCPServer::handleRequest(const json& request) noexcept {
-  spdlog::trace("<MCPServer::handleRequest> - request: {}", request.dump());
+  spdlog::trace("<MCPServer::handleRequest> - request: {}", LogPayload(request));
   try {
     checkJsonRpcVersion(request);
     checkIfParameterExists(JSONPARAM_METHOD, request);
 
-    const string method = request[JSONPARAM_METHOD];
-    const json parameters = request.value("params", json::object());
-    const uint64_t id = request.value("id", 0);
+    const string& method = request[JSONPARAM_METHOD].get_ref<const string&>();
+    const auto params = request.find("params");
+    const json& parameters = params != request.end() ? *params : EMPTY_JSON_OBJECT;
+    const auto idIter = request.find("id");
+    const json& id = idIter != request.end() ? *idIter : DEFAULT_REQUEST_ID;
 
-    json result;
-
-    if (method == "initialize") {
-      result = performInitialization(parameters);
-    } else if (method == "notifications/initialized") {
-      spdlog::info("Capability negotiation handshake successful. Client is ready to "
-        "begin normal operations.");
-      return result;
-    } else if (method == "tools/list") {
-      result = determineListOfAvailableTools();
-    } else if (method == "tools/call") {
-      result = callTool(parameters);
-    } else if (method == "resources/list") {
-      result = determineListOfAvailableResources();
-    } else if (method == "resources/read") {
-      result = readResource(parameters);
-    } else if (method == "prompts/list") {
-      result = determineListOfAvailablePrompts();
-    } else {
+    const MethodDispatchEntry* entry = MethodDispatcher::find(method);
+    if (entry == nullptr) {
       std::string message("The requested method '");
       message += method;
       message += "' does not exist.";
@@ -91,19 +289,28 @@ json MCPServer::handleRequest(const json& request) noexcept {
         }}
       };
     }
-    spdlog::trace("<MCPServer::handleRequest> - result: {}", result.dump());
+
+    const TraceSpan span("dispatch", entry->method_);
+    json result = entry->handler_(*this, parameters);
+    if (entry->isNotification_) {
+      return result;
+    }
+    spdlog::trace("<MCPServer::handleRequest> - result: {}", LogPayload(result));
 
     return {
       {PARAM_JSONRPC_VERSION, globals::REQUIRED_JSONRPC_VERSION},
       {"id", id},
-      {"result", result}
+      {"result", move(result)}
     };
 
   } catch (const exception& ex) {
     spdlog::error("while handling request: {}", ex.what());
+    // The error carries the id of the failed request, so that a client with several requests
+    // in flight can tell which one failed.
+    const auto idIter = request.find("id");
     return {
       {PARAM_JSONRPC_VERSION, globals::REQUIRED_JSONRPC_VERSION},
-      {"id", 0},
+      {"id", idIter != request.end() ? *idIter : DEFAULT_REQUEST_ID},
       {"error", {
         {"code", globals::JSONRPC_ERROR_GENERAL},
         {"message", ex.what()}
@@ -112,11 +319,103 @@ json MCPServer::handleRequest(const json& request) noexcept {
   }
 }
 
+string MCPServer::handleRequestSerialized(const json& request) noexcept {
+  const auto start = chrono::steady_clock::now();
+  ServerMetrics& metrics = ServerMetrics::instance();
+  GaugeIncrement requestInFlight(metrics.mcpRequestsInFlight_);
+
+  const auto method = request.find(JSONPARAM_METHOD);
+  const MethodDispatchEntry* entry = method != request.end() && method->is_string() ?
+    MethodDispatcher::find(method->get_ref<const string&>()) : nullptr;
+  string response;
+  {
+    const TraceSpan span("handle request", entry != nullptr ? entry->method_ : "unknown");
+    response = respondSerialized(request, entry);
+  }
+
+  MethodDispatcher::durationOf(entry).observeDurationSince(start);
+  metrics.mcpResponseSize_.observe(response.size());
+  return response;
+}
+
+string MCPServer::respondSerialized(const json& request,
+  const MethodDispatchEntry* entry) noexcept {
+  try {
+    checkJsonRpcVersion(request);
+    if (initialized_ && entry != nullptr && entry->retrieveSerializedResult_ != nullptr) {
+      const auto params = request.find("params");
+      const auto result = entry->retrieveSerializedResult_(*this,
+        params != request.end() ? *params : EMPTY_JSON_OBJECT);
+      if (result) {
+        const TraceSpan span("splice serialized result");
+        return spliceResponse(request, *result);
+      }
+    }
+  } catch (const exception&) {
+    // Fall through: handleRequest() generates the appropriate error response.
+  }
+
+  const json response = handleRequest(request);
+  const TraceSpan span("serialize response");
+  return response.is_null() ? string() :
+    response.dump(-1, ' ', false, json::error_handler_t::replace);
+}
+
+RequestLane MCPServer::determineLane(const string_view request) const noexcept {
+  try {
+    thread_local simdjson::ondemand::parser parser;
+    // The prefix is copied into a buffer that is reserved once per thread, for the prefix, the
+    // characters that close it and the padding. A method or tool name that is cut off by the
+    // prefix cannot be read, so the request is slow.
+    thread_local string prefix;
+    prefix.reserve(2 * MAX_CLASSIFIED_PREFIX_SIZE + 1 + simdjson::SIMDJSON_PADDING);
+    prefix.assign(request.substr(0, MAX_CLASSIFIED_PREFIX_SIZE));
+    if (request.size() > MAX_CLASSIFIED_PREFIX_SIZE) {
+      closeJsonPrefix(prefix);
+    }
+    simdjson::ondemand::document document;
+    if (parser.iterate(simdjson::padded_string_view(prefix.data(), prefix.size(),
+      prefix.capacity())).get(document) != simdjson::SUCCESS) {
+      return RequestLane::slow;
+    }
+    string_view method;
+    if (document["method"].get_string().get(method) != simdjson::SUCCESS) {
+      return RequestLane::slow;
+    }
+    if (method == "tools/call") {
+      string_view toolName;
+      if (document["params"]["name"].get_string().get(toolName) != simdjson::SUCCESS) {
+        return RequestLane::slow;
+      }
+      const auto tool = findTool(string(toolName));
+      return tool->annotations_.lane_;
+    }
+    const bool isFast = method.starts_with(NOTIFICATION_METHOD_PREFIX) ||
+      find(FAST_LANE_METHODS.begin(), FAST_LANE_METHODS.end(), method) != FAST_LANE_METHODS.end();
+    return isFast ? RequestLane::fast : RequestLane::slow;
+  } catch (const exception&) {
+    return RequestLane::slow;
+  }
+}
+
 void MCPServer::registerTool(const string& toolName,
   const string& description,
   const json& inputSchema,
-  function<json(const json&)> handler) {
-  tools_[toolName] = {toolName, description, inputSchema, handler};
+  function<json(const json&)> handler,
+  const ToolAnnotations& annotations) {
+  ArenaSuspension arenaSuspension; // Registrations outlive the request that may cause them.
+  auto& callDurations = ServerMetrics::instance().toolCallDuration_;
+  auto tool = make_shared<const ToolDefinition>(ToolDefinition {
+    toolName, description, inputSchema, move(handler), annotations,
+    ToolInputValidator(inputSchema), &callDurations.withLabels({ toolName, "success" }),
+    &callDurations.withLabels({ toolName, "error" }),
+    annotations.maxConcurrentCalls_ > 0 ?
+      make_unique<Bulkhead>(annotations.maxConcurrentCalls_) : nullptr });
+  unique_lock lock(registryMutex_);
+  tools_[toolName] = move(tool);
+  ++registryGeneration_;
+  // Memoized results of a replaced tool must not survive its replacement.
+  toolResultCache_.clear();
 }
 
 void MCPServer::registerResource(const string& resourceName,
@@ -124,14 +423,20 @@ void MCPServer::registerResource(const string& resourceName,
   const string& description,
   const string& mimeType,
   function<json()> handler) {
+  ArenaSuspension arenaSuspension;
+  unique_lock lock(registryMutex_);
   resources_[uri] = {uri, resourceName, description, mimeType, handler};
+  ++registryGeneration_;
 }
 
 void MCPServer::registerPrompt(const std::string& promptName,
   const std::string& title,
   const std::string& description,
-  const nlohmann::json& arguments) {
+  const json& arguments) {
+    ArenaSuspension arenaSuspension;
+    unique_lock lock(registryMutex_);
     prompts_[promptName] = {promptName, title, description, arguments};
+    ++registryGeneration_;
 }
 
 void MCPServer::setupCapabilities() noexcept {
@@ -162,7 +467,7 @@ void MCPServer::registerEchoTool() {
             {"text", "Echo: " + parameters["message"].get<std::string>()}
         }}}
       };
-  });
+  }, ToolAnnotations { false, false, {}, RequestLane::fast });
 }
 
 json MCPServer::performInitialization(const json& parameters) {
@@ -170,7 +475,7 @@ json MCPServer::performInitialization(const json& parameters) {
     checkMcpProtocolVersion(parameters);
     registerEchoTool();
     initialized_ = true;
-    spdlog::info("MCP Host (client) is: {}.", parameters["clientInfo"].dump());
+    spdlog::info("MCP Host (client) is: {}.", LogPayload(parameters["clientInfo"]));
   }
   
   return {
@@ -188,12 +493,20 @@ json MCPServer::determineListOfAvailableTools() const {
   checkIfServerIsInitialized();
   
   json availableTools = json::array();
+  shared_lock lock(registryMutex_);
   for (const auto& [name, tool] : tools_) {
     json toolInfo = {
-      {"name", tool.name_},
-      {"description", tool.description_},
-      {"inputSchema", tool.inputSchema_}
+      {"name", tool->name_},
+      {"description", tool->description_},
+      {"inputSchema", tool->inputSchema_}
     };
+    const auto& annotations = tool->annotations_;
+    if (annotations.readOnlyHint_ || annotations.idempotentHint_) {
+      toolInfo["annotations"] = {
+        {"readOnlyHint", annotations.readOnlyHint_},
+        {"idempotentHint", annotations.idempotentHint_}
+      };
+    }
     availableTools.push_back(toolInfo);
   }
   
@@ -206,12 +519,31 @@ json MCPServer::callTool(const json& parameters) {
   checkIfServerIsInitialized();
   checkIfParameterExists("name", parameters);
   
-  const std::string toolName = parameters["name"];
-  checkIfToolExists(toolName);
-  json arguments = parameters.value("arguments", json::object());
-  spdlog::trace("Calling tool named '{0}' with arguments: {1}.", toolName, arguments.dump());
+  const std::string& toolName = parameters["name"].get_ref<const string&>();
+  const auto tool = findTool(toolName);
+  const auto argumentsIter = parameters.find("arguments");
+  const json& arguments = argumentsIter != parameters.end() ? *argumentsIter : EMPTY_JSON_OBJECT;
+  spdlog::trace("Calling tool named '{0}' with arguments: {1}.", toolName, LogPayload(arguments));
+
+  json argumentsWithDefaults;
+  const json* validatedArguments { nullptr };
   try {
-    return invokeToolHandler(toolName, arguments);
+    const TraceSpan span("validate arguments", toolName);
+    validatedArguments = &tool->inputValidator_.validate(arguments, argumentsWithDefaults);
+  } catch (const exception& ex) {
+    spdlog::warn("Rejected call of tool '{0}' with invalid arguments: {1}", toolName, ex.what());
+    return {
+      {"content", {{
+          {"type", "text"},
+          {"text", "Invalid arguments for tool '" + toolName + "'. Reason: " +
+            string(ex.what())}
+        }}},
+        {"isError", true}
+    };
+  }
+
+  try {
+    return invokeToolHandler(*tool, *validatedArguments);
   } catch (const exception& ex) {
     spdlog::error("Something went wrong while invoking tool '{0}': {1}.", toolName, ex.what());
     return {
@@ -225,20 +557,104 @@ json MCPServer::callTool(const json& parameters) {
   }
 }
 
-json MCPServer::invokeToolHandler(const std::string& toolName, const json& arguments) {
-  json result = tools_[toolName].handler_(arguments);
-  spdlog::trace("Tool '{0}' successfully called. Result is: {1}", toolName, result.dump());
-  return {
-    {"content", result.value("content", json::array())},
-    {"isError", false}
+json MCPServer::invokeToolHandler(const ToolDefinition& tool, const json& arguments) {
+  string cacheKey;
+  if (isMemoizable(tool, arguments)) {
+    cacheKey = ToolResultCache::determineKey(tool.name_, arguments);
+    if (const auto cached = toolResultCache_.find(cacheKey)) {
+      ServerMetrics::instance().toolResultCacheHits_.increment();
+      spdlog::trace("Tool '{0}' not called, its result has been memoized.", tool.name_);
+      return cached->result_;
+    }
+    ServerMetrics::instance().toolResultCacheMisses_.increment();
+  }
+
+  const Bulkhead::Entry bulkheadEntry(tool.bulkhead_.get());
+  if (! bulkheadEntry.isAdmitted()) {
+    ServerMetrics::instance().bulkheadRejections_.increment();
+    spdlog::warn("Call of tool '{0}' rejected, {1} calls are already in progress.", tool.name_,
+      tool.bulkhead_->maxConcurrentCalls());
+    return {
+      {"content", {{
+          {"type", "text"},
+          {"text", "Tool '" + tool.name_ + "' is busy with " +
+            to_string(tool.bulkhead_->maxConcurrentCalls()) +
+            " calls in progress. Please retry later."}
+        }}},
+        {"isError", true}
+    };
+  }
+
+  const auto start = chrono::steady_clock::now();
+  json result;
+  try {
+    const TraceSpan span("tool handler", tool.name_);
+    result = tool.handler_(arguments);
+  } catch (...) {
+    tool.failedCallDuration_->observeDurationSince(start);
+    throw;
+  }
+  spdlog::trace("Tool '{0}' successfully called. Result is: {1}", tool.name_, LogPayload(result));
+  const auto content = result.find("content");
+  const bool isError = result.value("isError", false);
+  (isError ? tool.failedCallDuration_ : tool.succeededCallDuration_)->observeDurationSince(start);
+  json toolResult = {
+    {"content", content != result.end() ? move(*content) : json::array()},
+    {"isError", isError}
   };
+
+  // Errors are not memoized, the cause may be transient.
+  if (! cacheKey.empty() && ! isError) {
+    toolResultCache_.insert(cacheKey, toolResult, tool.annotations_.cachePolicy_.timeToLive_);
+  }
+  return toolResult;
+}
+
+bool MCPServer::isMemoizable(const ToolDefinition& tool, const json& arguments) const noexcept {
+  const auto& annotations = tool.annotations_;
+  const auto& cachePolicy = annotations.cachePolicy_;
+  if (! annotations.readOnlyHint_ || cachePolicy.scope_ == ToolCachePolicy::Scope::none ||
+      cachePolicy.timeToLive_.count() <= 0 || ! arguments.is_object()) {
+    return false;
+  }
+  for (const auto& requiredArgument : cachePolicy.requiredArguments_) {
+    const auto argument = arguments.find(requiredArgument);
+    if (argument == arguments.end() || argument->is_null() ||
+        (argument->is_string() && argument->get_ref<const string&>().empty())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+shared_ptr<const string> MCPServer::retrieveMemoizedToolResult(const json& parameters) {
+  const auto name = parameters.find("name");
+  if (name == parameters.end() || ! name->is_string()) {
+    return nullptr;
+  }
+  const auto tool = findTool(name->get_ref<const string&>());
+  const auto argumentsIter = parameters.find("arguments");
+  const json& passedArguments =
+    argumentsIter != parameters.end() ? *argumentsIter : EMPTY_JSON_OBJECT;
+  if (! isMemoizable(*tool, passedArguments)) {
+    return nullptr;
+  }
+  // Results are memoized under the validated arguments, including filled-in defaults.
+  json argumentsWithDefaults;
+  const json& arguments = tool->inputValidator_.validate(passedArguments, argumentsWithDefaults);
+  const auto cached = toolResultCache_.find(ToolResultCache::determineKey(tool->name_, arguments));
+  if (! cached) {
+    return nullptr;
+  }
+  ServerMetrics::instance().toolResultCacheHits_.increment();
+  return shared_ptr<const string>(cached, &cached->serializedResult_);
 }
 
 json MCPServer::determineListOfAvailableResources() const {
   checkIfServerIsInitialized();
   
   json resourcesList = json::array();
-  
+  shared_lock lock(registryMutex_);
   for (const auto& [uri, resource] : resources_) {
     json resourceInfo = {
       {"uri", resource.uri_},
@@ -263,11 +679,19 @@ json MCPServer::readResource(const json& parameters) {
   checkIfResourceExists(uri);
   
   try {
-    json content = resources_[uri].handler_();
+    function<json()> handler;
+    string mimeType;
+    {
+      shared_lock lock(registryMutex_);
+      const auto& resource = resources_.at(uri);
+      handler = resource.handler_;
+      mimeType = resource.mimeType_;
+    }
+    json content = handler();
     return {
       {"contents", {{
         {"uri", uri},
-        {"mimeType", resources_[uri].mimeType_},
+        {"mimeType", mimeType},
         {"text", content}
       }}}
     };
@@ -280,7 +704,7 @@ json MCPServer::determineListOfAvailablePrompts() const {
   checkIfServerIsInitialized();
   
   json promptList = json::array();
-  
+  shared_lock lock(registryMutex_);
   for (const auto& [name, prompt] : prompts_) {
     json promptInfo = {
       {"name", prompt.name_},
@@ -296,6 +720,41 @@ json MCPServer::determineListOfAvailablePrompts() const {
   };
 }
 
+shared_ptr<const string> MCPServer::retrieveSerializedList(
+  SerializedListCache& cache, json (MCPServer::*determineList)() const) const {
+  // The generation is read before the list is built, so a registration that happens in the
+  // meantime makes the new cache entry stale at once instead of hiding the new registration.
+  const uint64_t generation = registryGeneration_.load(memory_order_acquire);
+  auto cached = cache.load(memory_order_acquire);
+  if (cached && cached->registryGeneration_ == generation) {
+    ServerMetrics::instance().serializedListCacheHits_.increment();
+    return shared_ptr<const string>(cached, &cached->bytes_);
+  }
+  ServerMetrics::instance().serializedListCacheMisses_.increment();
+
+  auto list = make_shared<const SerializedList>(SerializedList { generation,
+    (this->*determineList)().dump(-1, ' ', false, json::error_handler_t::replace) });
+  cache.store(list, memory_order_release);
+  return shared_ptr<const string>(list, &list->bytes_);
+}
+
+string MCPServer::spliceResponse(const json& request, const string_view serializedResult) const {
+  const auto id = request.find("id");
+  const string serializedId = id != request.end() ? id->dump() : "0";
+
+  // Same member order as json::dump() produces for the response object of handleRequest().
+  string response;
+  response.reserve(serializedResult.size() + serializedId.size() + 40);
+  response += R"({"id":)";
+  response += serializedId;
+  response += R"(,"jsonrpc":")";
+  response += globals::REQUIRED_JSONRPC_VERSION;
+  response += R"(","result":)";
+  response += serializedResult;
+  response += '}';
+  return response;
+}
+
 void MCPServer::checkIfServerIsInitialized() const {
   if (! initialized_) {
     throw runtime_error("MCP Server not initialized! Call method 'initialize' first.");
@@ -328,13 +787,17 @@ void MCPServer::checkIfParameterExists(const string_view paramName,
   }
 }
 
-void MCPServer::checkIfToolExists(const string& toolName) const {
-  if (! tools_.contains(toolName)) {
+shared_ptr<const MCPServer::ToolDefinition> MCPServer::findTool(const string& toolName) const {
+  shared_lock lock(registryMutex_);
+  const auto tool = tools_.find(toolName);
+  if (tool == tools_.end()) {
     throw runtime_error("Tool not found: " + toolName);
   }
+  return tool->second;
 }
 
 void MCPServer::checkIfResourceExists(const std::string& uri) const {
+  shared_lock lock(registryMutex_);
   if (! resources_.contains(uri)) {
     throw runtime_error("Resource not found: " + uri);
   }
@@ -342,4 +805,6 @@ void MCPServer::checkIfResourceExists(const std::string& uri) const {
 
 const char* const MCPServer::PARAM_JSONRPC_VERSION = "jsonrpc";
 const char* const MCPServer::JSONPARAM_PROTOCOL_VERSION = "protocolVersion";
-const char* const MCPServer::JSONPARAM_METHOD = "method";
\ No newline at end of file
+const char* const MCPServer::JSONPARAM_METHOD = "method";
+const json MCPServer::EMPTY_JSON_OBJECT = json::object();
+const json MCPServer::DEFAULT_REQUEST_ID = 0;
\ No newline at end of file
@@ -1,18 +1,24 @@
 #pragma once
 
+#include "admissioncontroller.hpp"
+#include "arenajson.hpp"
 #include "httptoolclient.hpp"
 #include "mcppromptregistry.hpp"
 #include "mcpresourceregistry.hpp"
 #include "mcptoolregistry.hpp"
 #include "mcptransport.hpp"
+#include "metrics.hpp"
 #include "programoptions.hpp"
+#include "toolinputvalidator.hpp"
+#include "toolresultcache.hpp"
 
-#include <nlohmann/json.hpp>
+#include <atomic>
 #include <functional>
 #include <map>
+#include <memory>
+#include <shared_mutex>
 #include <string>
-
-using json = nlohmann::json;
+#include <string_view>
 
 /// A Model Context Protocol (MCP) server is a software application that expose
 /// specific capabilities to AI applications (MCP clients) through standardized
@@ -43,6 +49,8 @@ public:
   void setHttpToolClient(std::unique_ptr<HttpToolClient> httpToolClient);
 
   /// @brief Starts the server.
+  /// @throw std::runtime_error if no transport has been configured or the recording file of
+  /// upstream traffic cannot be created or read.
   void run();
   
   /// @brief Stops the server.
@@ -52,22 +60,50 @@ public:
   bool isRunning() const noexcept;
 
   /// @brief The handler that interprets and processes a request from the MCP client.
+  ///
+  /// The handler may be called concurrently from several transport threads.
   /// @param request is the request as a JSON-RPC object.
   /// @return the response to the request as a JSON object.
   json handleRequest(const json &request) noexcept;
 
+  /// @brief Processes a request from the MCP client like handleRequest(), but returns the
+  /// serialized response.
+  ///
+  /// The responses to 'tools/list', 'resources/list' and 'prompts/list' are not built as JSON
+  /// objects. Instead, the id of the request is spliced into an already serialized list that is
+  /// cached until the next registration of a tool, resource or prompt. The same applies to
+  /// 'tools/call' if the result of the call has been memoized.
+  /// @param request is the request as a JSON-RPC object.
+  /// @return the serialized response, or an empty string if the request is a notification.
+  std::string handleRequestSerialized(const json& request) noexcept;
+
+  /// @brief Determines the lane in which a request is scheduled by the transport.
+  ///
+  /// Only the method and the name of a called tool are read from a bounded prefix of the
+  /// serialized request, it is not parsed into a JSON object. Calls of tools are scheduled in the
+  /// lane of the tool. Only initialize, ping, the list methods and notifications are fast, all
+  /// other methods, and requests that cannot be classified, are slow.
+  /// @param request is the serialized JSON-RPC request.
+  RequestLane determineLane(const std::string_view request) const noexcept;
+
   /// @brief Registers a MCP tool.
   ///
   /// Registering of MCP tools that allows this server to expose executable
   /// functions that can be invoked by MCP clients.
   /// @param toolName is the name of the tool.
   /// @param description is a descriptions to guide the usage of the tool.
-  /// @param inputSchema is a JSON object that describes the parameters of the tool.
+  /// @param inputSchema is a JSON object that describes the parameters of the tool. It is
+  /// compiled into a validator that checks the arguments of every call before the handler runs.
   /// @param handler is the function to be invoked if the MCP client calls the tool.
+  /// @param annotations describe the behaviour of the tool. The results of read-only tools
+  /// with a shared cache policy are memoized.
   void registerTool(const std::string& toolName,
     const std::string& description,
     const json& inputSchema,
-    std::function<json(const json&)> handler) override;
+    std::function<json(const json&)> handler,
+    const ToolAnnotations& annotations) override;
+
+  using MCPToolRegistry::registerTool;
 
   // Currently not used.
   void registerResource(const std::string& resourceName,
@@ -79,26 +115,42 @@ public:
   void registerPrompt(const std::string& promptName,
     const std::string& title,
     const std::string& description,
-    const nlohmann::json& arguments) override;
+    const json& arguments) override;
 
   MCPServer() = delete;
 
 private:
     void setupCapabilities() noexcept;
+    void setupUpstreamTraffic();
     void registerEchoTool();
     json performInitialization(const json& parameters);
     json determineListOfAvailableTools() const;
     json callTool(const json &parameters);
-    json invokeToolHandler(const std::string &toolName, const json &arguments);
     json determineListOfAvailableResources() const;
     json readResource(const json& parameters);
     json determineListOfAvailablePrompts() const;
 
+    struct MethodDispatchEntry;
+    class MethodDispatcher;
+
+    struct SerializedList {
+      uint64_t registryGeneration_;
+      std::string bytes_;
+    };
+
+    using SerializedListCache = std::atomic<std::shared_ptr<const SerializedList>>;
+
+    std::shared_ptr<const std::string> retrieveSerializedList(SerializedListCache& cache,
+      json (MCPServer::*determineList)() const) const;
+    std::shared_ptr<const std::string> retrieveMemoizedToolResult(const json& parameters);
+    std::string respondSerialized(const json& request,
+      const MethodDispatchEntry* entry) noexcept;
+    std::string spliceResponse(const json& request, const std::string_view serializedResult) const;
+
     void checkIfServerIsInitialized() const;
     void checkMcpProtocolVersion(const json& parameters) const;
     void checkJsonRpcVersion(const json& request) const;
     void checkIfParameterExists(const std::string_view paramName, const json& jsonToCheck) const;
-    void checkIfToolExists(const std::string& toolName) const;
     void checkIfResourceExists(const std::string& uri) const;
 
     struct ToolDefinition {
@@ -106,9 +158,21 @@ private:
         std::string description_;
         json inputSchema_;
         std::function<json(const json&)> handler_;
+        ToolAnnotations annotations_;
+        ToolInputValidator inputValidator_;
+        /// The latency histograms of the tool, looked up once at registration.
+        Histogram* succeededCallDuration_;
+        Histogram* failedCallDuration_;
+        /// nullptr if the number of concurrent calls is not limited.
+        std::unique_ptr<Bulkhead> bulkhead_;
     };
 
-    std::map<std::string, ToolDefinition> tools_;
+    json invokeToolHandler(const ToolDefinition& tool, const json& arguments);
+    std::shared_ptr<const ToolDefinition> findTool(const std::string& toolName) const;
+    bool isMemoizable(const ToolDefinition& tool, const json& arguments) const noexcept;
+
+    std::map<std::string, std::shared_ptr<const ToolDefinition>> tools_;
+    ToolResultCache toolResultCache_;
 
     struct ResourceDefinition {
       std::string uri_;
@@ -129,6 +193,15 @@ private:
 
     std::map<std::string, PromptDefinition> prompts_;
 
+    /// Guards tools_, resources_ and prompts_ against registrations while requests are served.
+    mutable std::shared_mutex registryMutex_;
+
+    /// Incremented by every registration; serialized lists of an older generation are stale.
+    std::atomic<uint64_t> registryGeneration_ { 0 };
+    mutable SerializedListCache serializedToolList_;
+    mutable SerializedListCache serializedResourceList_;
+    mutable SerializedListCache serializedPromptList_;
+
     std::unique_ptr<MCPTransport> mcpTransport_;
     std::unique_ptr<HttpToolClient> httpToolClient_;
 
@@ -136,9 +209,11 @@ private:
     std::string version_;
     ProgramOptions programOptions_;
     json capabilities_;
-    bool initialized_ { false };
+    std::atomic<bool> initialized_ { false };
 
     static const char* const PARAM_JSONRPC_VERSION;
     static const char* const JSONPARAM_PROTOCOL_VERSION;
     static const char* const JSONPARAM_METHOD;
+    static const json EMPTY_JSON_OBJECT;
+    static const json DEFAULT_REQUEST_ID;
 };
\ No newline at end of file
@@ -1,9 +1,46 @@
 #pragma once
 
-#include <nlohmann/json.hpp>
+#include "arenajson.hpp"
+#include "requestlane.hpp"
 
+#include <chrono>
+#include <cstddef>
 #include <functional>
 #include <string>
+#include <vector>
+
+/// @brief The policy for memoizing the results of a MCP tool.
+struct ToolCachePolicy {
+  enum class Scope {
+    none,   ///< results are never memoized
+    shared  ///< results are memoized and shared between all clients
+  };
+
+  Scope scope_ { Scope::none };
+  /// How long a memoized result may be used.
+  std::chrono::seconds timeToLive_ { 0 };
+  /// Results are only memoized if the arguments of a call contain all of these, e.g. a
+  /// 'commitId' that pins the answer to an immutable snapshot of the model.
+  std::vector<std::string> requiredArguments_;
+};
+
+/// @brief Additional properties of a MCP tool.
+///
+/// The hints correspond to the tool annotations of the MCP specification and are passed on to
+/// clients in the response to 'tools/list'.
+struct ToolAnnotations {
+  /// The tool does not modify its environment.
+  bool readOnlyHint_ { false };
+  /// Repeated calls with the same arguments have no additional effect.
+  bool idempotentHint_ { false };
+  ToolCachePolicy cachePolicy_;
+  /// The lane in which calls of the tool are scheduled. Only tools that answer from memory
+  /// belong into the fast lane.
+  RequestLane lane_ { RequestLane::slow };
+  /// The maximum number of calls of the tool in progress at the same time, 0 for no limit.
+  /// Further calls are rejected, so that a slow tool cannot occupy all threads of the server.
+  std::size_t maxConcurrentCalls_ { 0 };
+};
 
 /// @brief The MCP Tool Registry Interface
 ///
@@ -13,7 +50,16 @@ class MCPToolRegistry {
 public:
   virtual void registerTool(const std::string& toolName,
     const std::string& description,
-    const nlohmann::json& inputSchema,
-    std::function<nlohmann::json(const nlohmann::json&)> handler) = 0;
+    const json& inputSchema,
+    std::function<json(const json&)> handler,
+    const ToolAnnotations& annotations) = 0;
+
+  void registerTool(const std::string& toolName,
+    const std::string& description,
+    const json& inputSchema,
+    std::function<json(const json&)> handler) {
+    registerTool(toolName, description, inputSchema, std::move(handler), ToolAnnotations {});
+  }
+
   virtual ~MCPToolRegistry() = default;
-};
\ No newline at end of file
+};
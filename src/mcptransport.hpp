@@ -1,9 +1,18 @@
 #pragma once
 
-#include <nlohmann/json.hpp>
+#include "arenajson.hpp"
+#include "requestlane.hpp"
 #include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
 
-using json = nlohmann::json;
+/// @brief Processes a parsed MCP request and returns the serialized JSON-RPC response, or an
+/// empty string if the request is a notification that is not answered.
+using McpRequestHandler = std::function<std::string(const json&)>;
+
+/// @brief Determines the lane of a MCP request from its serialized form, before it is parsed.
+using McpRequestClassifier = std::function<RequestLane(std::string_view)>;
 
 /// @brief The MCP Transport Interface
 ///
@@ -11,8 +20,22 @@ using json = nlohmann::json;
 /// in the Model Context Protocol (MCP) format.
 class MCPTransport {
 public:
-  virtual void start(std::function<json(const json&)> requestHandler) = 0;
+  virtual void start(McpRequestHandler requestHandler) = 0;
   virtual void stop() = 0;
   virtual bool isRunning() const noexcept = 0;
   virtual ~MCPTransport() = default;
-};
\ No newline at end of file
+
+  /// @brief Defines how requests are assigned to the lanes of the transport. Without a
+  /// classifier, all requests are scheduled in the slow lane. Must be called before start().
+  void setRequestClassifier(McpRequestClassifier requestClassifier) {
+    requestClassifier_ = std::move(requestClassifier);
+  }
+
+protected:
+  RequestLane classifyRequest(const std::string_view request) const {
+    return requestClassifier_ ? requestClassifier_(request) : RequestLane::slow;
+  }
+
+private:
+  McpRequestClassifier requestClassifier_;
+};
@@ -0,0 +1,311 @@
+#include "metrics.hpp"
+
+#include <bit>
+#include <charconv>
+
+using namespace std;
+
+namespace {
+  void appendNumber(string& output, const double value) {
+    array<char, 32> buffer;
+    const auto [end, ec] = to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    output.append(buffer.data(), ec == errc() ? end : buffer.data());
+  }
+
+  void appendNumber(string& output, const uint64_t value) {
+    array<char, 24> buffer;
+    const auto [end, ec] = to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    output.append(buffer.data(), ec == errc() ? end : buffer.data());
+  }
+
+  void appendSampleName(string& output, const string& name, const char* const suffix,
+    const string& labels, const string& extraLabel = string()) {
+    output += name;
+    output += suffix;
+    if (! labels.empty() || ! extraLabel.empty()) {
+      output += '{';
+      output += labels;
+      if (! labels.empty() && ! extraLabel.empty()) {
+        output += ',';
+      }
+      output += extraLabel;
+      output += '}';
+    }
+    output += ' ';
+  }
+
+  void appendEscapedLabelValue(string& output, const string& value) {
+    for (const char character : value) {
+      switch (character) {
+        case '\\': output += "\\\\"; break;
+        case '"': output += "\\\""; break;
+        case '\n': output += "\\n"; break;
+        default: output += character;
+      }
+    }
+  }
+
+  atomic<size_t> nextShard { 0 };
+}
+
+size_t MetricShards::shardOfCurrentThread() noexcept {
+  thread_local const size_t shard = nextShard.fetch_add(1, memory_order_relaxed) % SHARD_COUNT;
+  return shard;
+}
+
+void Counter::increment(const uint64_t amount) noexcept {
+  shards_[MetricShards::shardOfCurrentThread()].value_.fetch_add(amount, memory_order_relaxed);
+}
+
+uint64_t Counter::value() const noexcept {
+  uint64_t sum { 0 };
+  for (const auto& shard : shards_) {
+    sum += shard.value_.load(memory_order_relaxed);
+  }
+  return sum;
+}
+
+void Counter::writeSamples(string& output, const string& name, const string& labels) const {
+  appendSampleName(output, name, "", labels);
+  appendNumber(output, value());
+  output += '\n';
+}
+
+void Gauge::add(const int64_t amount) noexcept {
+  shards_[MetricShards::shardOfCurrentThread()].value_.fetch_add(amount, memory_order_relaxed);
+}
+
+int64_t Gauge::value() const noexcept {
+  int64_t sum { 0 };
+  for (const auto& shard : shards_) {
+    sum += shard.value_.load(memory_order_relaxed);
+  }
+  return sum;
+}
+
+void Gauge::writeSamples(string& output, const string& name, const string& labels) const {
+  appendSampleName(output, name, "", labels);
+  output += to_string(value());
+  output += '\n';
+}
+
+size_t HistogramLayout::bucketCount() const noexcept {
+  // One bucket below 2^minExponent_, the log-linear buckets, and one above 2^maxExponent_.
+  return 2 + (maxExponent_ - minExponent_) * SUB_BUCKET_COUNT;
+}
+
+size_t HistogramLayout::determineBucket(const uint64_t value) const noexcept {
+  if (value < (uint64_t { 1 } << minExponent_)) {
+    return 0;
+  }
+  const unsigned int exponent = static_cast<unsigned int>(bit_width(value)) - 1;
+  if (exponent >= maxExponent_) {
+    return bucketCount() - 1;
+  }
+  const uint64_t subBucket = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+  return 1 + (exponent - minExponent_) * SUB_BUCKET_COUNT + subBucket;
+}
+
+uint64_t HistogramLayout::upperBoundOf(const size_t bucket) const noexcept {
+  if (bucket == 0) {
+    return uint64_t { 1 } << minExponent_;
+  }
+  if (bucket >= bucketCount() - 1) {
+    return 0;
+  }
+  const size_t exponent = minExponent_ + (bucket - 1) / SUB_BUCKET_COUNT;
+  const size_t subBucket = (bucket - 1) % SUB_BUCKET_COUNT;
+  return (SUB_BUCKET_COUNT + subBucket + 1) << (exponent - SUB_BUCKET_BITS);
+}
+
+Histogram::Histogram(const HistogramLayout& layout) :
+  layout_(layout),
+  cellsPerShard_((layout.bucketCount() + 1 + 7) / 8 * 8),
+  cacheLines_(MetricShards::SHARD_COUNT * cellsPerShard_ / 8) {
+}
+
+void Histogram::observe(const uint64_t value) noexcept {
+  const size_t shard = MetricShards::shardOfCurrentThread();
+  cell(shard, layout_.determineBucket(value)).fetch_add(1, memory_order_relaxed);
+  cell(shard, layout_.bucketCount()).fetch_add(value, memory_order_relaxed);
+}
+
+void Histogram::observeDurationSince(const chrono::steady_clock::time_point start) noexcept {
+  const auto elapsed = chrono::duration_cast<chrono::microseconds>(
+    chrono::steady_clock::now() - start).count();
+  observe(elapsed > 0 ? static_cast<uint64_t>(elapsed) : 0);
+}
+
+atomic<uint64_t>& Histogram::cell(const size_t shard, const size_t index) noexcept {
+  const size_t position = shard * cellsPerShard_ + index;
+  return cacheLines_[position / 8].cells_[position % 8];
+}
+
+void Histogram::writeSamples(string& output, const string& name, const string& labels) const {
+  const size_t bucketCount = layout_.bucketCount();
+  vector<uint64_t> counts(bucketCount + 1, 0);
+  for (size_t shard = 0; shard < MetricShards::SHARD_COUNT; ++shard) {
+    for (size_t index = 0; index <= bucketCount; ++index) {
+      const size_t position = shard * cellsPerShard_ + index;
+      counts[index] += cacheLines_[position / 8].cells_[position % 8].load(memory_order_relaxed);
+    }
+  }
+
+  uint64_t cumulativeCount { 0 };
+  string bound;
+  for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+    cumulativeCount += counts[bucket];
+    const uint64_t upperBound = layout_.upperBoundOf(bucket);
+    bound = "le=\"";
+    if (upperBound == 0) {
+      bound += "+Inf";
+    } else {
+      appendNumber(bound, static_cast<double>(upperBound) * layout_.unit_);
+    }
+    bound += '"';
+    appendSampleName(output, name, "_bucket", labels, bound);
+    appendNumber(output, cumulativeCount);
+    output += '\n';
+  }
+  appendSampleName(output, name, "_sum", labels);
+  appendNumber(output, static_cast<double>(counts[bucketCount]) * layout_.unit_);
+  output += '\n';
+  appendSampleName(output, name, "_count", labels);
+  appendNumber(output, cumulativeCount);
+  output += '\n';
+}
+
+MetricFamilyBase::MetricFamilyBase(string name, string help, string type,
+  vector<string> labelNames) :
+  name_(move(name)), help_(move(help)), type_(move(type)), labelNames_(move(labelNames)) {
+}
+
+void MetricFamilyBase::writeTo(string& output) const {
+  output += "# HELP ";
+  output += name_;
+  output += ' ';
+  output += help_;
+  output += "\n# TYPE ";
+  output += name_;
+  output += ' ';
+  output += type_;
+  output += '\n';
+  writeSamples(output);
+}
+
+string MetricFamilyBase::formatLabels(const vector<string>& labelValues) const {
+  string labels;
+  for (size_t index = 0; index < labelNames_.size() && index < labelValues.size(); ++index) {
+    if (index > 0) {
+      labels += ',';
+    }
+    labels += labelNames_[index];
+    labels += "=\"";
+    appendEscapedLabelValue(labels, labelValues[index]);
+    labels += '"';
+  }
+  return labels;
+}
+
+MetricsRegistry& MetricsRegistry::global() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+MetricFamily<Counter>& MetricsRegistry::addCounter(const string& name, const string& help,
+  const vector<string>& labelNames) {
+  auto family = make_unique<MetricFamily<Counter>>(name, help, "counter", labelNames,
+    [] { return make_unique<Counter>(); });
+  auto& result = *family;
+  lock_guard lock(familiesMutex_);
+  families_.push_back(move(family));
+  return result;
+}
+
+MetricFamily<Gauge>& MetricsRegistry::addGauge(const string& name, const string& help,
+  const vector<string>& labelNames) {
+  auto family = make_unique<MetricFamily<Gauge>>(name, help, "gauge", labelNames,
+    [] { return make_unique<Gauge>(); });
+  auto& result = *family;
+  lock_guard lock(familiesMutex_);
+  families_.push_back(move(family));
+  return result;
+}
+
+MetricFamily<Histogram>& MetricsRegistry::addHistogram(const string& name, const string& help,
+  const HistogramLayout& layout, const vector<string>& labelNames) {
+  auto family = make_unique<MetricFamily<Histogram>>(name, help, "histogram", labelNames,
+    [layout] { return make_unique<Histogram>(layout); });
+  auto& result = *family;
+  lock_guard lock(familiesMutex_);
+  families_.push_back(move(family));
+  return result;
+}
+
+string MetricsRegistry::exportAsText() const {
+  string output;
+  lock_guard lock(familiesMutex_);
+  for (const auto& family : families_) {
+    family->writeTo(output);
+  }
+  return output;
+}
+
+const char* const MetricsRegistry::CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+ServerMetrics& ServerMetrics::instance() {
+  static ServerMetrics metrics(MetricsRegistry::global());
+  return metrics;
+}
+
+ServerMetrics::ServerMetrics(MetricsRegistry& registry) :
+  mcpRequestDuration_(registry.addHistogram("mcp_request_duration_seconds",
+    "Time to process a MCP request, by JSON-RPC method.", HistogramLayout::latency(),
+    { "method" })),
+  toolCallDuration_(registry.addHistogram("mcp_tool_call_duration_seconds",
+    "Time to run the handler of a MCP tool, by tool and outcome.", HistogramLayout::latency(),
+    { "tool", "outcome" })),
+  mcpRequestsInFlight_(registry.addGauge("mcp_requests_in_flight",
+    "MCP requests currently being processed.").withLabels({})),
+  mcpRequestSize_(registry.addHistogram("mcp_request_size_bytes",
+    "Size of the bodies of MCP requests.", HistogramLayout::size()).withLabels({})),
+  mcpResponseSize_(registry.addHistogram("mcp_response_size_bytes",
+    "Size of the bodies of MCP responses.", HistogramLayout::size()).withLabels({})),
+  admissionQueueDepth_(registry.addGauge("mcp_admission_queue_depth",
+    "MCP requests currently waiting to be admitted for processing.").withLabels({})),
+  rejectedRequests_(registry.addCounter("mcp_requests_rejected_total",
+    "MCP requests rejected by the admission control, by reason.", { "reason" })),
+  queueFullRejections_(rejectedRequests_.withLabels({ "queue_full" })),
+  queueTimeoutRejections_(rejectedRequests_.withLabels({ "queue_timeout" })),
+  bulkheadRejections_(rejectedRequests_.withLabels({ "tool_bulkhead" })),
+  connectionOverflowRejections_(rejectedRequests_.withLabels({ "connection_overflow" })),
+  upstreamRequestDuration_(registry.addHistogram("upstream_request_duration_seconds",
+    "Time to perform a request to an upstream API, by HTTP method, endpoint and status.",
+    HistogramLayout::latency(), { "method", "endpoint", "status" })),
+  upstreamResponseSize_(registry.addHistogram("upstream_response_size_bytes",
+    "Size of the bodies of upstream API responses, by endpoint.", HistogramLayout::size(),
+    { "endpoint" })),
+  upstreamRequestsInFlight_(registry.addGauge("upstream_requests_in_flight",
+    "Requests to upstream APIs currently awaiting their response.").withLabels({})),
+  upstreamReplicaEjections_(registry.addCounter("upstream_replica_ejections_total",
+    "Ejections of upstream API replicas after consecutive failures, by replica.",
+    { "replica" })),
+  upstreamHedges_(registry.addCounter("upstream_hedged_requests_total",
+    "Hedges sent for slow upstream reads, by whether they answered before the first attempt.",
+    { "result" })),
+  upstreamHedgesWon_(upstreamHedges_.withLabels({ "won" })),
+  upstreamHedgesLost_(upstreamHedges_.withLabels({ "lost" })),
+  upstreamConcurrencyLimit_(registry.addGauge("upstream_concurrency_limit",
+    "The adaptive limit of concurrent requests to an upstream API, by server.", { "server" })),
+  upstreamQueuedRequests_(registry.addGauge("upstream_requests_queued",
+    "Requests to upstream APIs currently waiting for the concurrency limit.").withLabels({})),
+  upstreamDeadlineRejections_(registry.addCounter("upstream_requests_rejected_total",
+    "Upstream requests dropped as no slot below the concurrency limit freed up in time.")
+    .withLabels({})),
+  cacheRequests_(registry.addCounter("cache_requests_total",
+    "Lookups in the caches of the server, by cache and result.", { "cache", "result" })),
+  toolResultCacheHits_(cacheRequests_.withLabels({ "tool_result", "hit" })),
+  toolResultCacheMisses_(cacheRequests_.withLabels({ "tool_result", "miss" })),
+  serializedListCacheHits_(cacheRequests_.withLabels({ "serialized_list", "hit" })),
+  serializedListCacheMisses_(cacheRequests_.withLabels({ "serialized_list", "miss" })) {
+}
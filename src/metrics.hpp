@@ -0,0 +1,248 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// @brief The striping shared by all metrics.
+///
+/// Every metric keeps one slot per shard, and each thread updates only the slot of its own
+/// shard, so updates are plain relaxed atomic additions that threads rarely contend for. The
+/// shards are summed up when the metrics are exported.
+class MetricShards {
+public:
+  static constexpr std::size_t SHARD_COUNT { 16 };
+
+  /// @brief Determines the shard of the calling thread.
+  static std::size_t shardOfCurrentThread() noexcept;
+};
+
+/// @brief A monotonically increasing count, e.g. of cache hits.
+class Counter {
+public:
+  void increment(const std::uint64_t amount = 1) noexcept;
+  std::uint64_t value() const noexcept;
+
+  void writeSamples(std::string& output, const std::string& name,
+    const std::string& labels) const;
+
+private:
+  struct alignas(64) Shard {
+    std::atomic<std::uint64_t> value_ { 0 };
+  };
+
+  std::array<Shard, MetricShards::SHARD_COUNT> shards_;
+};
+
+/// @brief A value that goes up and down, e.g. the number of requests in flight.
+class Gauge {
+public:
+  void add(const std::int64_t amount) noexcept;
+  std::int64_t value() const noexcept;
+
+  void writeSamples(std::string& output, const std::string& name,
+    const std::string& labels) const;
+
+private:
+  struct alignas(64) Shard {
+    std::atomic<std::int64_t> value_ { 0 };
+  };
+
+  std::array<Shard, MetricShards::SHARD_COUNT> shards_;
+};
+
+/// @brief Increments a gauge for the lifetime of the object.
+class GaugeIncrement {
+public:
+  explicit GaugeIncrement(Gauge& gauge) noexcept : gauge_(gauge) { gauge_.add(1); }
+  ~GaugeIncrement() { gauge_.add(-1); }
+
+  GaugeIncrement(const GaugeIncrement&) = delete;
+  GaugeIncrement& operator=(const GaugeIncrement&) = delete;
+
+private:
+  Gauge& gauge_;
+};
+
+/// @brief The buckets of a histogram, which are log-linear: the range from 2^minExponent_ to
+/// 2^maxExponent_ is split into powers of two, and each power of two into SUB_BUCKET_COUNT
+/// buckets of equal width. The relative width of a bucket therefore never exceeds
+/// 1/SUB_BUCKET_COUNT, whatever the magnitude of the observed values.
+struct HistogramLayout {
+  static constexpr unsigned int SUB_BUCKET_BITS { 1 };
+  static constexpr unsigned int SUB_BUCKET_COUNT { 1u << SUB_BUCKET_BITS };
+
+  unsigned int minExponent_;
+  unsigned int maxExponent_;
+  /// The factor that converts observed values into the unit of the exported values, e.g.
+  /// 1e-6 if microseconds are observed and seconds are exported.
+  double unit_;
+
+  /// Latencies observed in microseconds, from 16 microseconds to about one minute.
+  static HistogramLayout latency() noexcept { return { 4, 26, 1e-6 }; }
+  /// Sizes observed in bytes, from 64 bytes to 64 megabytes.
+  static HistogramLayout size() noexcept { return { 6, 26, 1.0 }; }
+
+  std::size_t bucketCount() const noexcept;
+  std::size_t determineBucket(const std::uint64_t value) const noexcept;
+  /// @brief The exclusive upper bound of the observed values that fall into a bucket, or 0 for
+  /// the last bucket, which is unbounded.
+  std::uint64_t upperBoundOf(const std::size_t bucket) const noexcept;
+};
+
+/// @brief A distribution of observed values, e.g. of latencies or payload sizes.
+class Histogram {
+public:
+  explicit Histogram(const HistogramLayout& layout);
+
+  void observe(const std::uint64_t value) noexcept;
+
+  /// @brief Observes the time elapsed since start in microseconds.
+  void observeDurationSince(const std::chrono::steady_clock::time_point start) noexcept;
+
+  void writeSamples(std::string& output, const std::string& name,
+    const std::string& labels) const;
+
+private:
+  struct alignas(64) CacheLine {
+    std::array<std::atomic<std::uint64_t>, 8> cells_;
+  };
+
+  std::atomic<std::uint64_t>& cell(const std::size_t shard, const std::size_t index) noexcept;
+
+  const HistogramLayout layout_;
+  /// Per shard: the bucket counts followed by the sum of the observed values.
+  const std::size_t cellsPerShard_;
+  std::vector<CacheLine> cacheLines_;
+};
+
+/// @brief All metrics of the same name that differ in the values of their labels.
+class MetricFamilyBase {
+public:
+  MetricFamilyBase(std::string name, std::string help, std::string type,
+    std::vector<std::string> labelNames);
+  virtual ~MetricFamilyBase() = default;
+
+  /// @brief Appends the family in the Prometheus text exposition format.
+  void writeTo(std::string& output) const;
+
+protected:
+  std::string formatLabels(const std::vector<std::string>& labelValues) const;
+  virtual void writeSamples(std::string& output) const = 0;
+
+  const std::string name_;
+  const std::string help_;
+  const std::string type_;
+  const std::vector<std::string> labelNames_;
+};
+
+template<typename Metric>
+class MetricFamily : public MetricFamilyBase {
+public:
+  MetricFamily(std::string name, std::string help, std::string type,
+    std::vector<std::string> labelNames, std::function<std::unique_ptr<Metric>()> create) :
+    MetricFamilyBase(std::move(name), std::move(help), std::move(type), std::move(labelNames)),
+    create_(std::move(create)) { }
+
+  /// @brief Retrieves the metric with the given label values, which is created on first use.
+  ///
+  /// The returned reference stays valid as long as the family exists; callers on hot paths
+  /// should look up their metric once and keep the reference.
+  Metric& withLabels(const std::vector<std::string>& labelValues) {
+    {
+      std::shared_lock lock(mutex_);
+      const auto metric = metrics_.find(labelValues);
+      if (metric != metrics_.end()) {
+        return *metric->second;
+      }
+    }
+    std::unique_lock lock(mutex_);
+    auto& metric = metrics_[labelValues];
+    if (! metric) {
+      metric = create_();
+    }
+    return *metric;
+  }
+
+private:
+  void writeSamples(std::string& output) const override {
+    std::shared_lock lock(mutex_);
+    for (const auto& [labelValues, metric] : metrics_) {
+      metric->writeSamples(output, name_, formatLabels(labelValues));
+    }
+  }
+
+  const std::function<std::unique_ptr<Metric>()> create_;
+  std::map<std::vector<std::string>, std::unique_ptr<Metric>> metrics_;
+  mutable std::shared_mutex mutex_;
+};
+
+/// @brief The registry of all metric families of the process, which exports them in the
+/// Prometheus text exposition format.
+class MetricsRegistry {
+public:
+  static MetricsRegistry& global();
+
+  MetricFamily<Counter>& addCounter(const std::string& name, const std::string& help,
+    const std::vector<std::string>& labelNames = {});
+  MetricFamily<Gauge>& addGauge(const std::string& name, const std::string& help,
+    const std::vector<std::string>& labelNames = {});
+  MetricFamily<Histogram>& addHistogram(const std::string& name, const std::string& help,
+    const HistogramLayout& layout, const std::vector<std::string>& labelNames = {});
+
+  /// @brief Exports all metrics in the Prometheus text exposition format (version 0.0.4).
+  std::string exportAsText() const;
+
+  static const char* const CONTENT_TYPE;
+
+private:
+  std::vector<std::unique_ptr<MetricFamilyBase>> families_;
+  mutable std::mutex familiesMutex_;
+};
+
+/// @brief The metrics recorded by the server.
+struct ServerMetrics {
+  static ServerMetrics& instance();
+
+  MetricFamily<Histogram>& mcpRequestDuration_;
+  MetricFamily<Histogram>& toolCallDuration_;
+  Gauge& mcpRequestsInFlight_;
+  Histogram& mcpRequestSize_;
+  Histogram& mcpResponseSize_;
+  Gauge& admissionQueueDepth_;
+  MetricFamily<Counter>& rejectedRequests_;
+  Counter& queueFullRejections_;
+  Counter& queueTimeoutRejections_;
+  Counter& bulkheadRejections_;
+  Counter& connectionOverflowRejections_;
+
+  MetricFamily<Histogram>& upstreamRequestDuration_;
+  MetricFamily<Histogram>& upstreamResponseSize_;
+  Gauge& upstreamRequestsInFlight_;
+  MetricFamily<Counter>& upstreamReplicaEjections_;
+  MetricFamily<Counter>& upstreamHedges_;
+  Counter& upstreamHedgesWon_;
+  Counter& upstreamHedgesLost_;
+  MetricFamily<Gauge>& upstreamConcurrencyLimit_;
+  Gauge& upstreamQueuedRequests_;
+  Counter& upstreamDeadlineRejections_;
+
+  MetricFamily<Counter>& cacheRequests_;
+  Counter& toolResultCacheHits_;
+  Counter& toolResultCacheMisses_;
+  Counter& serializedListCacheHits_;
+  Counter& serializedListCacheMisses_;
+
+private:
+  explicit ServerMetrics(MetricsRegistry& registry);
+};
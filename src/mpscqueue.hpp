@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+/// @brief An unbounded, lock-free multi-producer/single-consumer queue.
+///
+/// Producers never block each other: pushing an element is a single atomic exchange on the
+/// head of an intrusive linked list (Dmitry Vyukov's MPSC queue). Only one thread may consume
+/// elements. The consumer can block until an element arrives or until the queue is closed.
+template<typename T>
+class MpscQueue {
+public:
+  MpscQueue() {
+    Node* stub = new Node;
+    head_.store(stub, std::memory_order_relaxed);
+    tail_ = stub;
+  }
+
+  /// @brief Appends an element to the queue. May be called concurrently by any thread.
+  void push(T value) {
+    Node* node = new Node;
+    node->value_.emplace(std::move(value));
+    Node* previous = head_.exchange(node, std::memory_order_acq_rel);
+    previous->next_.store(node, std::memory_order_release);
+    signal_.fetch_add(1, std::memory_order_release);
+    signal_.notify_one();
+  }
+
+  /// @brief Removes the oldest element without blocking. Consumer thread only.
+  /// @return the element, or an empty optional if there is none (yet).
+  std::optional<T> tryPop() {
+    Node* tail = tail_;
+    Node* next = tail->next_.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      return std::nullopt;
+    }
+    tail_ = next;
+    std::optional<T> value = std::move(next->value_);
+    next->value_.reset();
+    delete tail;
+    return value;
+  }
+
+  /// @brief Removes the oldest element, waiting for one if the queue is empty. Consumer
+  /// thread only.
+  /// @return the element, or an empty optional if the queue has been closed and drained.
+  std::optional<T> waitAndPop() {
+    while (true) {
+      const uint32_t observed = signal_.load(std::memory_order_acquire);
+      if (auto value = tryPop()) {
+        return value;
+      }
+      if (closed_.load(std::memory_order_acquire)) {
+        return tryPop();
+      }
+      signal_.wait(observed, std::memory_order_acquire);
+    }
+  }
+
+  /// @brief Wakes up the consumer and makes waitAndPop() return once the queue is drained.
+  void close() {
+    closed_.store(true, std::memory_order_release);
+    signal_.fetch_add(1, std::memory_order_release);
+    signal_.notify_all();
+  }
+
+  ~MpscQueue() {
+    while (tryPop()) { }
+    delete tail_;
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+private:
+  struct Node {
+    std::atomic<Node*> next_ { nullptr };
+    std::optional<T> value_;
+  };
+
+  std::atomic<Node*> head_;
+  Node* tail_;
+  std::atomic<uint32_t> signal_ { 0 };
+  std::atomic<bool> closed_ { false };
+};
@@ -1,21 +1,42 @@
 # pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 /// @brief The possible kinds of transport for MCP protocol messages
 enum class McpTransportKind {
-  stdinout, http
+  stdinout, http, epoll, unixsocket
 };
 
 enum class LogLevel {
-  trace, info, warn, error
+  trace, debug, info, warn, error
 };
 
 /// @brief A data structure that contains the program options selected by the user.
 struct ProgramOptions {
   McpTransportKind mcpTransportKind_;
   std::string mcpTransportUrl_;
+  std::string unixSocketPath_;
+  std::vector<uint32_t> allowedPeerUids_;
   std::string sysmlv2ApiUrl_;
   LogLevel logLevel_;
   std::string logFileName_;
+  std::size_t maxLoggedPayloadSize_;
+  unsigned int payloadLogSampling_;
+  std::string traceFileName_;
+  unsigned int traceSampling_;
+  std::string upstreamRecordFileName_;
+  std::string upstreamReplayFileName_;
+  bool replayRecordedLatency_;
+  unsigned int replayLatencyInMilliseconds_;
+  double hedgingPercentile_;
+  double hedgingBudgetInPercent_;
+  std::size_t maxUpstreamConcurrency_;
+  std::size_t minCompressedRequestSize_;
+  std::size_t maxRequestsInFlight_;
+  std::size_t maxQueuedRequests_;
+  unsigned int maxQueueTimeInMilliseconds_;
+  std::size_t minCompressedResponseSize_;
 };
@@ -0,0 +1,166 @@
+#include "requestarena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+
+using namespace std;
+
+namespace {
+  // JSON with static storage duration may be destroyed after the thread-local state of the
+  // main thread; this trivially destructible flag tells that the state is gone.
+  thread_local bool threadArenaStateDestroyed { false };
+
+  struct ThreadArenaState {
+    RequestArena arena_;
+    unsigned int scopeDepth_ { 0 };
+    bool suspended_ { false };
+
+    ~ThreadArenaState() {
+      threadArenaStateDestroyed = true;
+    }
+  };
+
+  ThreadArenaState& threadArenaState() noexcept {
+    thread_local ThreadArenaState state;
+    return state;
+  }
+
+#ifndef NDEBUG
+  // The chunks of the arenas of all threads, by their base address, so that debug builds can
+  // detect memory that is freed on another thread than the one that allocated it. The registry
+  // is never destroyed, since arenas and arena allocators are used during static destruction.
+  mutex chunkRegistryMutex;
+  map<uintptr_t, size_t>& chunkRegistry() {
+    static auto* registry = new map<uintptr_t, size_t>;
+    return *registry;
+  }
+#endif
+
+  void registerChunk([[maybe_unused]] const void* memory, [[maybe_unused]] const size_t size) {
+#ifndef NDEBUG
+    lock_guard lock(chunkRegistryMutex);
+    chunkRegistry().emplace(reinterpret_cast<uintptr_t>(memory), size);
+#endif
+  }
+
+  void unregisterChunk([[maybe_unused]] const void* memory) noexcept {
+#ifndef NDEBUG
+    lock_guard lock(chunkRegistryMutex);
+    chunkRegistry().erase(reinterpret_cast<uintptr_t>(memory));
+#endif
+  }
+}
+
+RequestArena::~RequestArena() {
+  for (const Chunk& chunk : chunks_) {
+    unregisterChunk(chunk.memory_.get());
+  }
+}
+
+RequestArena* RequestArena::current() noexcept {
+  if (threadArenaStateDestroyed) {
+    return nullptr;
+  }
+  ThreadArenaState& state = threadArenaState();
+  return state.scopeDepth_ > 0 && ! state.suspended_ ? &state.arena_ : nullptr;
+}
+
+bool RequestArena::ownsMemory(const void* memory) noexcept {
+  if (threadArenaStateDestroyed) {
+    return false;
+  }
+  return threadArenaState().arena_.owns(memory);
+}
+
+bool RequestArena::isArenaMemory([[maybe_unused]] const void* memory) noexcept {
+#ifndef NDEBUG
+  const auto address = reinterpret_cast<uintptr_t>(memory);
+  lock_guard lock(chunkRegistryMutex);
+  const auto& registry = chunkRegistry();
+  auto chunk = registry.upper_bound(address);
+  if (chunk == registry.begin()) {
+    return false;
+  }
+  --chunk;
+  return address < chunk->first + chunk->second;
+#else
+  return false;
+#endif
+}
+
+void* RequestArena::allocate(const size_t sizeInBytes, const size_t alignment) {
+  if (! chunks_.empty()) {
+    Chunk& chunk = chunks_.back();
+    const auto base = reinterpret_cast<uintptr_t>(chunk.memory_.get());
+    const uintptr_t aligned = (base + usedInLastChunk_ + alignment - 1) & ~(alignment - 1);
+    if (aligned + sizeInBytes <= base + chunk.size_) {
+      usedInLastChunk_ = aligned + sizeInBytes - base;
+      return reinterpret_cast<void*>(aligned);
+    }
+  }
+
+  addChunk(sizeInBytes + alignment);
+  const auto base = reinterpret_cast<uintptr_t>(chunks_.back().memory_.get());
+  const uintptr_t aligned = (base + alignment - 1) & ~(alignment - 1);
+  usedInLastChunk_ = aligned + sizeInBytes - base;
+  return reinterpret_cast<void*>(aligned);
+}
+
+bool RequestArena::owns(const void* memory) const noexcept {
+  const auto address = reinterpret_cast<uintptr_t>(memory);
+  return any_of(chunks_.begin(), chunks_.end(), [address](const Chunk& chunk) {
+    const auto base = reinterpret_cast<uintptr_t>(chunk.memory_.get());
+    return address >= base && address < base + chunk.size_;
+  });
+}
+
+void RequestArena::addChunk(const size_t minimumSize) {
+  const size_t grownSize = chunks_.empty() ? INITIAL_CHUNK_SIZE :
+    min(chunks_.back().size_ * 2, MAX_CHUNK_SIZE);
+  const size_t size = max(grownSize, minimumSize);
+  chunks_.push_back({ make_unique_for_overwrite<byte[]>(size), size });
+  registerChunk(chunks_.back().memory_.get(), size);
+  usedInLastChunk_ = 0;
+}
+
+void RequestArena::release() noexcept {
+  // Chunks that have been made for a single huge allocation exceed the maximum size, they are
+  // never kept.
+  auto kept = chunks_.end();
+  for (auto chunk = chunks_.begin(); chunk != chunks_.end(); ++chunk) {
+    if (chunk->size_ <= MAX_CHUNK_SIZE && (kept == chunks_.end() || chunk->size_ > kept->size_)) {
+      kept = chunk;
+    }
+  }
+  if (kept != chunks_.end() && kept != chunks_.begin()) {
+    swap(*kept, chunks_.front());
+  }
+  const auto firstReleased = chunks_.begin() + (kept != chunks_.end() ? 1 : 0);
+  for (auto chunk = firstReleased; chunk != chunks_.end(); ++chunk) {
+    unregisterChunk(chunk->memory_.get());
+  }
+  chunks_.erase(firstReleased, chunks_.end());
+  usedInLastChunk_ = 0;
+}
+
+ArenaScope::ArenaScope() noexcept {
+  ++threadArenaState().scopeDepth_;
+}
+
+ArenaScope::~ArenaScope() {
+  ThreadArenaState& state = threadArenaState();
+  if (--state.scopeDepth_ == 0) {
+    state.arena_.release();
+  }
+}
+
+ArenaSuspension::ArenaSuspension() noexcept :
+  wasSuspended_(exchange(threadArenaState().suspended_, true)) {
+}
+
+ArenaSuspension::~ArenaSuspension() {
+  threadArenaState().suspended_ = wasSuspended_;
+}
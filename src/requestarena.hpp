@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+/// @brief A per-thread monotonic memory arena for the transient data of one MCP request.
+///
+/// Allocations are served by bumping a pointer through large chunks; deallocations are no-ops.
+/// All memory is given back at once when the outermost ArenaScope of the thread ends. The
+/// largest chunk of at most MAX_CHUNK_SIZE is kept for the next request, so a thread that
+/// serves requests of a steady size does not hit the global allocator at all, while a single
+/// huge request does not pin its memory to the thread.
+///
+/// Memory allocated from the arena must be freed on the thread that allocated it, before the
+/// scope ends, which debug builds assert. Data that outlives a request must be allocated within
+/// an ArenaSuspension.
+class RequestArena {
+public:
+  /// @brief Determines the arena that serves allocations of the calling thread.
+  /// @return the arena, or nullptr if no ArenaScope is active or allocations are suspended.
+  static RequestArena* current() noexcept;
+
+  /// @brief Checks whether memory belongs to the arena of the calling thread.
+  static bool ownsMemory(const void* memory) noexcept;
+
+  /// @brief Checks whether memory belongs to the arena of any thread. Only debug builds keep
+  /// track of the arenas of all threads, release builds always return false.
+  static bool isArenaMemory(const void* memory) noexcept;
+
+  void* allocate(const std::size_t sizeInBytes, const std::size_t alignment);
+
+  RequestArena() = default;
+  ~RequestArena();
+  RequestArena(const RequestArena&) = delete;
+  RequestArena& operator=(const RequestArena&) = delete;
+
+private:
+  friend class ArenaScope;
+
+  struct Chunk {
+    std::unique_ptr<std::byte[]> memory_;
+    std::size_t size_;
+  };
+
+  bool owns(const void* memory) const noexcept;
+  void addChunk(const std::size_t minimumSize);
+  void release() noexcept;
+
+  std::vector<Chunk> chunks_;
+  std::size_t usedInLastChunk_ { 0 };
+
+  static constexpr std::size_t INITIAL_CHUNK_SIZE { 64 * 1024 };
+  static constexpr std::size_t MAX_CHUNK_SIZE { 4 * 1024 * 1024 };
+};
+
+/// @brief Routes the allocations of the calling thread to its RequestArena while it exists.
+///
+/// Scopes may be nested; the arena is released when the outermost scope ends.
+class ArenaScope {
+public:
+  ArenaScope() noexcept;
+  ~ArenaScope();
+
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+};
+
+/// @brief Temporarily routes the allocations of the calling thread to the global allocator,
+/// e.g. while data is stored that outlives the current request.
+class ArenaSuspension {
+public:
+  ArenaSuspension() noexcept;
+  ~ArenaSuspension();
+
+  ArenaSuspension(const ArenaSuspension&) = delete;
+  ArenaSuspension& operator=(const ArenaSuspension&) = delete;
+
+private:
+  bool wasSuspended_;
+};
+
+/// @brief A stateless allocator that allocates from the RequestArena of the calling thread if
+/// an ArenaScope is active, and from the global allocator otherwise.
+template<typename T>
+class ArenaAllocator {
+public:
+  using value_type = T;
+
+  ArenaAllocator() noexcept = default;
+
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+  T* allocate(const std::size_t numberOfObjects) {
+    if (RequestArena* arena = RequestArena::current()) {
+      return static_cast<T*>(arena->allocate(numberOfObjects * sizeof(T), alignof(T)));
+    }
+    return std::allocator<T>().allocate(numberOfObjects);
+  }
+
+  void deallocate(T* memory, const std::size_t numberOfObjects) noexcept {
+    if (! RequestArena::ownsMemory(memory)) {
+      assert(! RequestArena::isArenaMemory(memory) &&
+        "Memory of a request arena must be freed on the thread that allocated it.");
+      std::allocator<T>().deallocate(memory, numberOfObjects);
+    }
+  }
+
+  template<typename U>
+  bool operator==(const ArenaAllocator<U>&) const noexcept { return true; }
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+/// @brief The lane in which a MCP request is scheduled.
+///
+/// Each lane is served by threads of its own, so that cheap requests never wait behind
+/// requests that may take seconds.
+enum class RequestLane {
+  /// Control-plane methods, e.g. 'initialize' or 'tools/list', and tools answered from memory.
+  fast,
+  /// Tools that wait for upstream APIs.
+  slow
+};
@@ -1,47 +1,39 @@
 #include "stdinstdoutmcptransport.hpp"
+#include "globals.hpp"
+#include "logpayload.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
 #include <spdlog/spdlog.h>
 #include <iostream>
 
 using namespace std;
 
-void StdinStdoutMcpTransport::start(function<json(const json&)> requestHandler) {
+StdinStdoutMcpTransport::StdinStdoutMcpTransport(const size_t numberOfWorkers) noexcept :
+  numberOfWorkers_(numberOfWorkers) { }
+
+void StdinStdoutMcpTransport::start(McpRequestHandler requestHandler) {
   if (running_)
     return;
 
+  requestHandler_ = move(requestHandler);
+  workerPool_ = make_unique<WorkerPool>(numberOfWorkers_, globals::FAST_LANE_WORKERS);
   running_ = true;
-  spdlog::info("Starting worker thread waiting for requests via stdin...");
-  thread_ = thread([this, requestHandler]() {
-    string line;
-    while (running_ && std::getline(std::cin, line)) {
-      try {
-        if (line.empty())
-          continue;
-          
-        json request = json::parse(line);
-        spdlog::debug("Request is: {}", request.dump());
-        json response = requestHandler(request);
-        spdlog::debug("Received response from request handler: {}", response.dump());
-        std::cout << response << std::flush;
-      } catch (const exception& ex) {
-        const json errorResponse = {
-          {"jsonrpc", "2.0"},
-          {"id", nullptr},
-          {"error", {
-            {"code", -32700},
-            {"message", std::string(ex.what())}
-          }}
-        };
-        spdlog::error("while parsing received data from stdin: {}", ex.what());
-        std::cout << errorResponse << std::flush;
-      }
-    }
-  });
+  spdlog::info("Starting reader and writer threads waiting for requests via stdin...");
+  writerThread_ = thread([this]() { writeResponses(); });
+  readerThread_ = thread([this]() { readRequests(); });
 }
 
 void StdinStdoutMcpTransport::stop() {
   running_ = false;
-  if (thread_.joinable()) {
-    thread_.join();
+  if (readerThread_.joinable()) {
+    readerThread_.join();
+  }
+  if (workerPool_) {
+    workerPool_->shutdown();
+  }
+  responseQueue_.close();
+  if (writerThread_.joinable()) {
+    writerThread_.join();
   }
 }
 
@@ -51,4 +43,65 @@ bool StdinStdoutMcpTransport::isRunning() const noexcept {
 
 StdinStdoutMcpTransport::~StdinStdoutMcpTransport() {
   stop();
-}
\ No newline at end of file
+}
+
+void StdinStdoutMcpTransport::readRequests() {
+  string line;
+  while (running_ && std::getline(std::cin, line)) {
+    if (line.empty())
+      continue;
+    const RequestLane lane = classifyRequest(line);
+    workerPool_->submit([this, line = move(line)]() { processRequest(line); }, lane);
+  }
+
+  // stdin has been closed by the client: finish all pending requests, flush their
+  // responses and shut down.
+  spdlog::info("End of input on stdin reached.");
+  workerPool_->shutdown();
+  responseQueue_.close();
+  running_ = false;
+}
+
+void StdinStdoutMcpTransport::processRequest(const string& line) {
+  ArenaScope arenaScope; // All JSON of the request is released at once on return.
+  const TracedRequest tracedRequest;
+  const TraceSpan requestSpan("stdio MCP request");
+  ServerMetrics::instance().mcpRequestSize_.observe(line.size());
+  try {
+    json request;
+    {
+      const TraceSpan parseSpan("parse request");
+      request = json::parse(line);
+    }
+    spdlog::debug("Request is: {}", LogPayload(line));
+    string serializedResponse = requestHandler_(request);
+    if (serializedResponse.empty())
+      return; // Notifications are not answered.
+
+    spdlog::debug("Received response from request handler: {}", LogPayload(serializedResponse));
+    serializedResponse += '\n';
+    responseQueue_.push(move(serializedResponse));
+  } catch (const exception& ex) {
+    const json errorResponse = {
+      {"jsonrpc", "2.0"},
+      {"id", nullptr},
+      {"error", {
+        {"code", -32700},
+        {"message", std::string(ex.what())}
+      }}
+    };
+    spdlog::error("while parsing received data from stdin: {}", ex.what());
+    responseQueue_.push(errorResponse.dump() + '\n');
+  }
+}
+
+void StdinStdoutMcpTransport::writeResponses() {
+  while (auto response = responseQueue_.waitAndPop()) {
+    std::cout.write(response->data(), static_cast<streamsize>(response->size()));
+    // Write everything that has been completed in the meantime before flushing.
+    while (auto nextResponse = responseQueue_.tryPop()) {
+      std::cout.write(nextResponse->data(), static_cast<streamsize>(nextResponse->size()));
+    }
+    std::cout.flush();
+  }
+}
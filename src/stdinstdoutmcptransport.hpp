@@ -1,19 +1,41 @@
 #pragma once
 
 #include "mcptransport.hpp"
+#include "mpscqueue.hpp"
+#include "workerpool.hpp"
 
+#include <atomic>
+#include <memory>
+#include <string>
 #include <thread>
 
 /// @brief Implements MCP transport via stdin and stdout.
+///
+/// Messages are newline-delimited JSON-RPC frames. The transport is pipelined: a reader thread
+/// splits stdin into frames, a pool of workers processes the requests concurrently, and a single
+/// writer thread writes the newline-terminated responses to stdout in completion order. Clients
+/// correlate the (possibly out-of-order) responses with their requests by the JSON-RPC id.
 class StdinStdoutMcpTransport final : public MCPTransport {
 public:
-  StdinStdoutMcpTransport() noexcept = default;
-  void start(std::function<json(const json&)> requestHandler) override;
+  /// @brief An initialization constructor.
+  /// @param numberOfWorkers is the number of threads processing requests concurrently (0 means
+  /// one per hardware thread). Additional threads only process requests of the fast lane.
+  explicit StdinStdoutMcpTransport(const std::size_t numberOfWorkers = 0) noexcept;
+  void start(McpRequestHandler requestHandler) override;
   void stop() override;
   bool isRunning() const noexcept override;
   ~StdinStdoutMcpTransport() override;
 
 private:
-    bool running_ { false };
-    std::thread thread_;
-};
\ No newline at end of file
+    void readRequests();
+    void processRequest(const std::string& line);
+    void writeResponses();
+
+    std::size_t numberOfWorkers_;
+    McpRequestHandler requestHandler_;
+    std::unique_ptr<WorkerPool> workerPool_;
+    MpscQueue<std::string> responseQueue_;
+    std::atomic<bool> running_ { false };
+    std::thread readerThread_;
+    std::thread writerThread_;
+};
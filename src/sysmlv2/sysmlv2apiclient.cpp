@@ -1,14 +1,99 @@
 #include "sysmlv2apiclient.hpp"
+#include "../tooloutputwriter.hpp"
+#include "../tracing.hpp"
+
 #include <spdlog/spdlog.h>
 
 using namespace std;
 
+namespace {
+  constexpr chrono::seconds COMMIT_PINNED_RESULT_TIME_TO_LIVE { 3600 };
+  /// Queries and diffs may keep the SysML v2 API busy for seconds, so only a few of them may
+  /// run at the same time, whatever the number of threads of the server.
+  constexpr size_t HEAVY_TOOL_MAX_CONCURRENT_CALLS { 4 };
+  constexpr chrono::seconds REPLICA_HEALTH_CHECK_INTERVAL { 5 };
+  constexpr chrono::seconds REPLICA_HEALTH_CHECK_TIMEOUT { 2 };
+
+  /// Failed requests are reported with 'isError' set, so that their results are not memoized.
+  json renderToolResult(const string& heading, json& response,
+    const ToolOutputOptions& outputOptions = {}) {
+    const int status = response.value("status", 0);
+    if (response.value("error", false) || status >= 400) {
+      const string reason = response.value("error", false) ?
+        response.value("message", string("unknown")) :
+        "the SysML v2 API responded with HTTP status " + to_string(status);
+      return {
+        {"content", {{{"type", "text"}, {"text", "Error: " + reason}}}},
+        {"isError", true}
+      };
+    }
+
+    string text(heading);
+    text += ":\n";
+    string cursor;
+    const auto body = response.find("body");
+    if (body != response.end() && body->is_string()) {
+      string& bodyText = body->get_ref<string&>();
+      const TraceSpan span("render upstream response");
+      try {
+        cursor = ToolOutputWriter(outputOptions).writeText(bodyText, text);
+      } catch (const exception&) {
+        text += bodyText; // not JSON
+      }
+    }
+    if (! cursor.empty()) {
+      text += "\n\nThe result has been cut off. Call the tool again with cursor \"" + cursor +
+        "\" to get the next items.";
+    }
+    return {
+      {"content", {{{"type", "text"}, {"text", move(text)}}}}
+    };
+  }
+}
+
 SysMLv2APIClient::SysMLv2APIClient(MCPToolRegistry& mcpToolRegistry,
   MCPPromptRegistry& mcpPromptRegistry, const string_view sysmlv2ApiUrl) :
-  sysmlv2ApiBaseUrl_(sysmlv2ApiUrl) {
+  sysmlv2ApiBaseUrl_(sysmlv2ApiUrl.substr(0, sysmlv2ApiUrl.find(','))) {
+  // Response bodies are read on demand while the tool results are rendered.
+  setParseJsonBodies(false);
   setupSysMLv2APITools(mcpToolRegistry);
   setupSysMLv2APIPrompts(mcpPromptRegistry);
   setDefaultHeaders();
+  setupReplicas(sysmlv2ApiUrl);
+}
+
+void SysMLv2APIClient::setupReplicas(const string_view sysmlv2ApiUrls) {
+  vector<string> baseUrls;
+  string_view remainder = sysmlv2ApiUrls;
+  while (! remainder.empty()) {
+    const size_t comma = remainder.find(',');
+    const string baseUrl = extractBaseUrl(string(remainder.substr(0, comma)));
+    if (! baseUrl.empty()) {
+      baseUrls.push_back(baseUrl);
+    }
+    remainder = comma == string_view::npos ? string_view() : remainder.substr(comma + 1);
+  }
+  if (baseUrls.size() < 2) {
+    return;
+  }
+
+  // The health checks run until the balancer is destroyed, which may happen after the
+  // members of this client have been destroyed, so they get a copy of the headers.
+  httplib::Headers headers;
+  for (const auto& [key, value] : defaultHeaders_) {
+    headers.emplace(key, value);
+  }
+  auto balancer = make_shared<UpstreamBalancer>(move(baseUrls));
+  balancer->startHealthChecks([headers](const string& baseUrl) {
+    httplib::Client client(baseUrl);
+    client.set_connection_timeout(REPLICA_HEALTH_CHECK_TIMEOUT.count());
+    client.set_read_timeout(REPLICA_HEALTH_CHECK_TIMEOUT.count());
+    const auto result = client.Get("/projects?page[size]=1", headers);
+    return result && result->status < 500;
+  }, REPLICA_HEALTH_CHECK_INTERVAL);
+  spdlog::info("Reads from the SysML v2 API are balanced across {} replicas, writes are sent "
+    "to {}.", balancer->numberOfReplicas(), balancer->primaryUrl());
+  balanceUpstreamRequests(move(balancer));
 }
 
 json SysMLv2APIClient::getProjects(const int pageSize) {
@@ -236,6 +321,17 @@ json SysMLv2APIClient::executeQuery(const Identifier &projectId, const json &que
 
 void SysMLv2APIClient::setupSysMLv2APITools(MCPToolRegistry &mcpToolRegistry)
 {
+  // Reads of a specific commit always yield the same answer, so their results can be memoized.
+  const ToolAnnotations readOnlyTool { true, true, {} };
+  const ToolAnnotations commitPinnedTool { true, true, { ToolCachePolicy::Scope::shared,
+    COMMIT_PINNED_RESULT_TIME_TO_LIVE, { "commitId" } } };
+  const ToolAnnotations queryTool { true, true, { ToolCachePolicy::Scope::shared,
+    COMMIT_PINNED_RESULT_TIME_TO_LIVE, { "commitId" } }, RequestLane::slow,
+    HEAVY_TOOL_MAX_CONCURRENT_CALLS };
+  const ToolAnnotations commitDiffTool { true, true, { ToolCachePolicy::Scope::shared,
+    COMMIT_PINNED_RESULT_TIME_TO_LIVE, { "baseCommitId", "compareCommitId" } },
+    RequestLane::slow, HEAVY_TOOL_MAX_CONCURRENT_CALLS };
+
   mcpToolRegistry.registerTool(
       "sysml_list_projects",
       "List all available SysML v2 projects.",
@@ -248,15 +344,15 @@ void SysMLv2APIClient::setupSysMLv2APITools(MCPToolRegistry &mcpToolRegistry)
           int pageSize = params.value("pageSize", 50);
           json result = getProjects(pageSize);
 
-          return {
-              {"content", {{{"type", "text"}, {"text", "Projects:\n" + result["data"].dump(2)}}}}};
+          return renderToolResult("Projects", result);
         }
         catch (const std::exception &e)
         {
           return {
-              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}}};
+              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}},
+              {"isError", true}};
         }
-      });
+      }, readOnlyTool);
 
   mcpToolRegistry.registerTool(
       "sysml_get_project",
@@ -271,15 +367,15 @@ void SysMLv2APIClient::setupSysMLv2APITools(MCPToolRegistry &mcpToolRegistry)
           std::string projectId = params["projectId"];
           json result = getProjectById(projectId);
 
-          return {
-              {"content", {{{"type", "text"}, {"text", "Project Details:\n" + result["data"].dump(2)}}}}};
+          return renderToolResult("Project Details", result);
         }
         catch (const std::exception &e)
         {
           return {
-              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}}};
+              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}},
+              {"isError", true}};
         }
-      });
+      }, readOnlyTool);
 
   mcpToolRegistry.registerTool(
       "sysml_create_project",
@@ -295,92 +391,95 @@ void SysMLv2APIClient::setupSysMLv2APITools(MCPToolRegistry &mcpToolRegistry)
           std::string description = params.value("description", "");
           json result = createProject(name, description);
 
-          return {
-              {"content", {{{"type", "text"}, {"text", "Created Project:\n" + result["data"].dump(2)}}}}};
+          return renderToolResult("Created Project", result);
         }
         catch (const std::exception &e)
         {
           return {
-              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}}};
+              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}},
+              {"isError", true}};
         }
       });
 
   mcpToolRegistry.registerTool(
       "sysml_get_elements",
       "Get all elements in a project at specific commit.",
-      {{"type", "object"},
+      ToolOutputOptions::addToInputSchema({{"type", "object"},
        {"properties", {{"projectId", {{"type", "string"}, {"description", "UUID of the project"}}}, {"commitId", {{"type", "string"}, {"description", "UUID of the commit"}}}, {"pageSize", {{"type", "integer"}, {"description", "Maximum number of elements per page"}, {"default", 50}}}}},
-       {"required", {"projectId", "commitId"}}},
+       {"required", {"projectId", "commitId"}}}),
       [this](const json &params) -> json
       {
         try
         {
+          const auto outputOptions = ToolOutputOptions::fromArguments(params);
           std::string projectId = params["projectId"];
           std::string commitId = params["commitId"];
           int pageSize = params.value("pageSize", 50);
 
           json result = getElements(projectId, commitId, pageSize);
 
-          return {
-              {"content", {{{"type", "text"}, {"text", "Elements:\n" + result["data"].dump(2)}}}}};
+          return renderToolResult("Elements", result, outputOptions);
         }
         catch (const std::exception &e)
         {
           return {
-              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}}};
+              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}},
+              {"isError", true}};
         }
-      });
+      }, commitPinnedTool);
 
   mcpToolRegistry.registerTool(
       "sysml_get_element",
       "Get a specific element by ID.",
-      {{"type", "object"},
+      ToolOutputOptions::addToInputSchema({{"type", "object"},
        {"properties", {{"projectId", {{"type", "string"}, {"description", "UUID of the project"}}}, {"commitId", {{"type", "string"}, {"description", "UUID of the commit"}}}, {"elementId", {{"type", "string"}, {"description", "UUID of the element"}}}}},
-       {"required", {"projectId", "commitId", "elementId"}}},
+       {"required", {"projectId", "commitId", "elementId"}}}),
       [this](const json &params) -> json
       {
         try
         {
+          const auto outputOptions = ToolOutputOptions::fromArguments(params);
           std::string projectId = params["projectId"];
           std::string commitId = params["commitId"];
           std::string elementId = params["elementId"];
 
           json result = getElementById(projectId, commitId, elementId);
 
-          return {
-              {"content", {{{"type", "text"}, {"text", "Element Details:\n" + result["data"].dump(2)}}}}};
+          return renderToolResult("Element Details", result, outputOptions);
         }
         catch (const std::exception &e)
         {
           return {
-              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}}};
+              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}},
+              {"isError", true}};
         }
-      });
+      }, commitPinnedTool);
 
   mcpToolRegistry.registerTool(
       "sysml_get_root_elements",
       "Get root elements in a SysML project.",
-      {{"type", "object"},
+      ToolOutputOptions::addToInputSchema({{"type", "object"},
        {"properties", {{"projectId", {{"type", "string"}, {"description", "UUID of the project"}}}, {"commitId", {{"type", "string"}, {"description", "UUID of the commit"}}}}},
-       {"required", {"projectId", "commitId"}}},
+       {"required", {"projectId", "commitId"}}}),
       [this](const json &params) -> json
       {
         try
         {
+          const auto outputOptions = ToolOutputOptions::fromArguments(params);
           std::string projectId = params["projectId"];
           std::string commitId = params["commitId"];
 
           json result = getRootElements(projectId, commitId);
 
-          return {
-              {"content", {{{"type", "text"}, {"text", "Root Elements:\n" + result["data"].dump(2)}}}}};
+          return renderToolResult("Root Elements", result, outputOptions);
         }
         catch (const std::exception &e)
         {
           return {
-              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}}};
+              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}},
+              {"isError", true}};
         }
-      });
+      }, commitPinnedTool);
 
   mcpToolRegistry.registerTool(
       "sysml_get_branches",
@@ -395,77 +494,80 @@ void SysMLv2APIClient::setupSysMLv2APITools(MCPToolRegistry &mcpToolRegistry)
           std::string projectId = params["projectId"];
           json result = getBranches(projectId);
 
-          return {
-              {"content", {{{"type", "text"}, {"text", "Branches:\n" + result["data"].dump(2)}}}}};
+          return renderToolResult("Branches", result);
         }
         catch (const std::exception &e)
         {
           return {
-              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}}};
+              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}},
+              {"isError", true}};
         }
-      });
+      }, readOnlyTool);
 
   mcpToolRegistry.registerTool(
       "sysml_get_commits",
       "Get commit history for a specific SysML project with a given ID.",
-      {{"type", "object"},
+      ToolOutputOptions::addToInputSchema({{"type", "object"},
        {"properties", {{"projectId", {{"type", "string"}, {"description", "UUID of the project"}}}, {"pageSize", {{"type", "integer"}, {"description", "Maximum number of commits per page"}, {"default", 50}}}}},
-       {"required", {"projectId"}}},
+       {"required", {"projectId"}}}),
       [this](const json &params) -> json
       {
         try
         {
+          const auto outputOptions = ToolOutputOptions::fromArguments(params);
           std::string projectId = params["projectId"];
           int pageSize = params.value("pageSize", 50);
           json result = getCommits(projectId, pageSize);
 
-          return {
-              {"content", {{{"type", "text"}, {"text", "Commits:\n" + result["data"].dump(2)}}}}};
+          return renderToolResult("Commits", result, outputOptions);
         }
         catch (const std::exception &e)
         {
           return {
-              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}}};
+              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}},
+              {"isError", true}};
         }
-      });
+      }, readOnlyTool);
 
 
   mcpToolRegistry.registerTool(
       "sysml_execute_query",
       "Execute SysML v2 query on project data.",
-      {{"type", "object"},
+      ToolOutputOptions::addToInputSchema({{"type", "object"},
        {"properties", {{"projectId", {{"type", "string"}, {"description", "UUID of the project"}}}, {"query", {{"type", "object"}, {"description", "Query definition with select, where, orderBy clauses"}}}, {"commitId", {{"type", "string"}, {"description", "Optional commit ID to query against"}}}}},
-       {"required", {"projectId", "query"}}},
+       {"required", {"projectId", "query"}}}),
       [this](const json &params) -> json
       {
         try
         {
+          const auto outputOptions = ToolOutputOptions::fromArguments(params);
           std::string projectId = params["projectId"];
           json query = params["query"];
           std::string commitId = params.value("commitId", "");
 
           json result = executeQuery(projectId, query, commitId);
 
-          return {
-              {"content", {{{"type", "text"}, {"text", "Query Results:\n" + result["data"].dump(2)}}}}};
+          return renderToolResult("Query Results", result, outputOptions);
         }
         catch (const std::exception &e)
         {
           return {
-              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}}};
+              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}},
+              {"isError", true}};
         }
-      });
+      }, queryTool);
 
   mcpToolRegistry.registerTool(
       "sysml_diff_commits",
       "Compare differences between two commits.",
-      {{"type", "object"},
-       {"properties", {{"projectId", {{"type", "string"}, {"description", "UUID of the project"}}}, {"baseCommitId", {{"type", "string"}, {"description", "UUID of the base commit"}}}, {"compareCommitId", {{"type", "string"}, {"description", "UUID of the compare commit"}}}, {"changeTypes", {{"type", "array"}, {"items", {"type", "string", "enum", {"CREATED", "UPDATED", "DELETED"}}}, {"description", "Filter by change types"}}}}},
-       {"required", {"projectId", "baseCommitId", "compareCommitId"}}},
+      ToolOutputOptions::addToInputSchema({{"type", "object"},
+       {"properties", {{"projectId", {{"type", "string"}, {"description", "UUID of the project"}}}, {"baseCommitId", {{"type", "string"}, {"description", "UUID of the base commit"}}}, {"compareCommitId", {{"type", "string"}, {"description", "UUID of the compare commit"}}}, {"changeTypes", {{"type", "array"}, {"items", {{"type", "string"}, {"enum", {"CREATED", "UPDATED", "DELETED"}}}}, {"description", "Filter by change types"}}}}},
+       {"required", {"projectId", "baseCommitId", "compareCommitId"}}}),
       [this](const json &params) -> json
       {
         try
         {
+          const auto outputOptions = ToolOutputOptions::fromArguments(params);
           std::string projectId = params["projectId"];
           std::string baseCommitId = params["baseCommitId"];
           std::string compareCommitId = params["compareCommitId"];
@@ -481,15 +583,15 @@ void SysMLv2APIClient::setupSysMLv2APITools(MCPToolRegistry &mcpToolRegistry)
 
           json result = diffCommits(projectId, baseCommitId, compareCommitId, changeTypes);
 
-          return {
-              {"content", {{{"type", "text"}, {"text", "Commit Differences:\n" + result["data"].dump(2)}}}}};
+          return renderToolResult("Commit Differences", result, outputOptions);
         }
         catch (const std::exception &e)
         {
           return {
-              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}}};
+              {"content", {{{"type", "text"}, {"text", "Error: " + std::string(e.what())}}}},
+              {"isError", true}};
         }
-      });
+      }, commitDiffTool);
 }
 
 void SysMLv2APIClient::setupSysMLv2APIPrompts(MCPPromptRegistry& mcpPromptRegistry) {
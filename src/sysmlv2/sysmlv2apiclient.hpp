@@ -12,8 +12,14 @@ using Identifier = std::string;
 /// Systems Modeling Application Programming Interface (API) and Services</a> 1.0 specification.
 /// This class is a specialization of HttpToolClient and extends it with HTTP/REST calls for the
 /// SysML v2 API for accessing SysML v2 model repositories.
+///
+/// The operations return the raw response body as member 'body' only; it is not parsed into a
+/// DOM, because the tools read the parts of it they need on demand (see ToolOutputWriter).
 class SysMLv2APIClient : public HttpToolClient {
 public:
+  /// @param sysmlv2ApiUrl is the URL of the SysML v2 API, or a comma-separated list of the URLs
+  /// of its primary and its read replicas. Reads are balanced across all of them, writes are
+  /// sent to the primary. The replicas must serve the same paths as the primary.
   SysMLv2APIClient(MCPToolRegistry& mcpToolRegistry,
     MCPPromptRegistry& mcpPromptRegistry,
     const std::string_view sysmlv2ApiUrl);
@@ -136,6 +142,7 @@ private:
   void setupSysMLv2APITools(MCPToolRegistry& mcpToolRegistry);
   void setupSysMLv2APIPrompts(MCPPromptRegistry& mcpPromptRegistry);
   void setDefaultHeaders() noexcept;
+  void setupReplicas(const std::string_view sysmlv2ApiUrls);
 
   const std::string sysmlv2ApiBaseUrl_;
   std::string apiToken_;
@@ -0,0 +1,181 @@
+#include "toolinputvalidator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+ToolInputValidator::ToolInputValidator(const json& inputSchema) :
+  root_(compile(inputSchema)) {
+}
+
+const json& ToolInputValidator::validate(const json& arguments,
+  json& argumentsWithDefaults) const {
+  validateNode(root_, arguments, "");
+
+  // Only the defaults of top-level properties are filled in, and the arguments are copied
+  // only if at least one of them is actually missing.
+  const json* effectiveArguments = &arguments;
+  for (const auto& [name, defaultValue] : root_.defaults_) {
+    if (effectiveArguments->is_object() && ! effectiveArguments->contains(name)) {
+      if (effectiveArguments == &arguments) {
+        argumentsWithDefaults = arguments;
+        effectiveArguments = &argumentsWithDefaults;
+      }
+      argumentsWithDefaults[name] = defaultValue;
+    }
+  }
+  return *effectiveArguments;
+}
+
+ToolInputValidator::Node ToolInputValidator::compile(const json& schema) {
+  Node node;
+  if (! schema.is_object()) {
+    return node;
+  }
+
+  const auto type = schema.find("type");
+  if (type != schema.end()) {
+    if (type->is_string()) {
+      node.allowedTypes_ = determineTypeFlag(type->get_ref<const string&>());
+    } else if (type->is_array()) {
+      for (const auto& typeName : *type) {
+        if (typeName.is_string()) {
+          node.allowedTypes_ |= determineTypeFlag(typeName.get_ref<const string&>());
+        }
+      }
+    }
+  }
+
+  const auto enumValues = schema.find("enum");
+  if (enumValues != schema.end() && enumValues->is_array()) {
+    node.enumValues_.assign(enumValues->begin(), enumValues->end());
+  }
+
+  const auto properties = schema.find("properties");
+  if (properties != schema.end() && properties->is_object()) {
+    for (const auto& [name, propertySchema] : properties->items()) {
+      node.properties_.emplace_back(name, compile(propertySchema));
+      if (propertySchema.is_object() && propertySchema.contains("default")) {
+        node.defaults_.emplace_back(name, propertySchema["default"]);
+      }
+    }
+  }
+
+  const auto required = schema.find("required");
+  if (required != schema.end() && required->is_array()) {
+    for (const auto& name : *required) {
+      if (name.is_string()) {
+        node.required_.push_back(name.get<string>());
+      }
+    }
+  }
+
+  const auto items = schema.find("items");
+  if (items != schema.end()) {
+    node.items_ = make_unique<Node>(compile(*items));
+  }
+  return node;
+}
+
+uint8_t ToolInputValidator::determineTypeFlag(const string& typeName) {
+  if (typeName == "object") return objectType;
+  if (typeName == "array") return arrayType;
+  if (typeName == "string") return stringType;
+  if (typeName == "integer") return integerType;
+  if (typeName == "number") return numberType;
+  if (typeName == "boolean") return booleanType;
+  if (typeName == "null") return nullType;
+  throw runtime_error("Unknown type '" + typeName + "' in JSON schema.");
+}
+
+void ToolInputValidator::validateNode(const Node& node, const json& value, const string& path) {
+  const auto describePath = [&path]() {
+    return path.empty() ? string("The arguments") : "Argument '" + path + "'";
+  };
+
+  if (! hasAllowedType(node, value)) {
+    throw runtime_error(describePath() + " must be of type " +
+      describeAllowedTypes(node.allowedTypes_) + ", but is of type " + value.type_name() + ".");
+  }
+
+  if (! node.enumValues_.empty() &&
+      find(node.enumValues_.begin(), node.enumValues_.end(), value) == node.enumValues_.end()) {
+    string allowedValues;
+    for (const auto& enumValue : node.enumValues_) {
+      allowedValues += allowedValues.empty() ? "" : ", ";
+      allowedValues += enumValue.dump();
+    }
+    throw runtime_error(describePath() + " must be one of: " + allowedValues + ".");
+  }
+
+  if (value.is_object()) {
+    for (const auto& name : node.required_) {
+      if (! value.contains(name)) {
+        const bool hasDefault = any_of(node.defaults_.begin(), node.defaults_.end(),
+          [&name](const auto& defaultValue) { return defaultValue.first == name; });
+        if (! hasDefault) {
+          throw runtime_error("Missing required argument '" +
+            (path.empty() ? name : path + "." + name) + "'.");
+        }
+      }
+    }
+    for (const auto& [name, propertyNode] : node.properties_) {
+      const auto property = value.find(name);
+      if (property != value.end()) {
+        validateNode(propertyNode, *property, path.empty() ? name : path + "." + name);
+      }
+    }
+  } else if (value.is_array() && node.items_) {
+    for (size_t index = 0; index < value.size(); ++index) {
+      validateNode(*node.items_, value[index], path + "[" + to_string(index) + "]");
+    }
+  }
+}
+
+bool ToolInputValidator::hasAllowedType(const Node& node, const json& value) noexcept {
+  const uint8_t allowedTypes = node.allowedTypes_;
+  if (allowedTypes == anyType) {
+    return true;
+  }
+  switch (value.type()) {
+    case json::value_t::object:
+      return allowedTypes & objectType;
+    case json::value_t::array:
+      return allowedTypes & arrayType;
+    case json::value_t::string:
+      return allowedTypes & stringType;
+    case json::value_t::number_integer:
+    case json::value_t::number_unsigned:
+      return allowedTypes & (integerType | numberType);
+    case json::value_t::number_float: {
+      // JSON schema regards a number without fractional part, e.g. 50.0, as an integer.
+      const double number = value.get<double>();
+      return (allowedTypes & numberType) ||
+        ((allowedTypes & integerType) && std::isfinite(number) && std::trunc(number) == number);
+    }
+    case json::value_t::boolean:
+      return allowedTypes & booleanType;
+    case json::value_t::null:
+      return allowedTypes & nullType;
+    default:
+      return false;
+  }
+}
+
+string ToolInputValidator::describeAllowedTypes(const uint8_t allowedTypes) {
+  static const pair<uint8_t, const char*> typeNames[] {
+    { objectType, "object" }, { arrayType, "array" }, { stringType, "string" },
+    { integerType, "integer" }, { numberType, "number" }, { booleanType, "boolean" },
+    { nullType, "null" }
+  };
+  string description;
+  for (const auto& [flag, name] : typeNames) {
+    if (allowedTypes & flag) {
+      description += description.empty() ? "" : " or ";
+      description += name;
+    }
+  }
+  return description;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "arenajson.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// @brief Validates the arguments of a MCP tool call against the tool's input schema.
+///
+/// The JSON schema is compiled once, when the tool is registered, into a tree of nodes that
+/// hold everything needed for validation in a ready-to-use form. The supported subset of JSON
+/// schema is what tool input schemas use in practice: 'type' (a single type or a list of
+/// types), 'enum', 'properties', 'required', 'items', and 'default' values of the top-level
+/// properties. Unknown keywords are ignored, and a malformed subschema accepts any value.
+class ToolInputValidator {
+public:
+  /// @brief An initialization constructor.
+  /// @param inputSchema is the JSON schema describing the arguments of the tool.
+  explicit ToolInputValidator(const json& inputSchema);
+
+  /// @brief Validates the arguments of a call.
+  /// @param arguments are the arguments as passed by the MCP client.
+  /// @param argumentsWithDefaults receives a copy of the arguments completed by the defaults
+  /// of missing properties. It is left untouched if no default has to be filled in.
+  /// @return either arguments or argumentsWithDefaults, whichever must be passed to the tool.
+  /// @throw std::runtime_error if the arguments do not conform to the schema.
+  const json& validate(const json& arguments, json& argumentsWithDefaults) const;
+
+private:
+  enum TypeFlag : uint8_t {
+    anyType = 0,
+    objectType = 1 << 0,
+    arrayType = 1 << 1,
+    stringType = 1 << 2,
+    integerType = 1 << 3,
+    numberType = 1 << 4,
+    booleanType = 1 << 5,
+    nullType = 1 << 6
+  };
+
+  struct Node {
+    uint8_t allowedTypes_ { anyType };
+    std::vector<json> enumValues_;
+    std::vector<std::pair<std::string, Node>> properties_;
+    std::vector<std::string> required_;
+    std::vector<std::pair<std::string, json>> defaults_;
+    std::unique_ptr<Node> items_;
+  };
+
+  static Node compile(const json& schema);
+  static uint8_t determineTypeFlag(const std::string& typeName);
+  static void validateNode(const Node& node, const json& value, const std::string& path);
+  static bool hasAllowedType(const Node& node, const json& value) noexcept;
+  static std::string describeAllowedTypes(uint8_t allowedTypes);
+
+  Node root_;
+};
@@ -0,0 +1,469 @@
+#include "tooloutputwriter.hpp"
+
+#include <simdjson.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+using namespace std;
+namespace ondemand = simdjson::ondemand;
+
+namespace {
+  string_view trimTrailingWhitespace(string_view text) noexcept {
+    while (! text.empty() && (text.back() == ' ' || text.back() == '\t' ||
+           text.back() == '\n' || text.back() == '\r')) {
+      text.remove_suffix(1);
+    }
+    return text;
+  }
+
+  constexpr unsigned int INDENT_STEP { 2 };
+
+  /// Appends the serialization of a value to the output. If it is pretty-printed, its nested
+  /// lines are indented by the given number of spaces in addition, since the value continues a
+  /// line of the enclosing list or object.
+  void appendSerialized(string& output, const json& value, const bool isPretty,
+    const unsigned int indentation) {
+    const string serialized = value.dump(isPretty ? static_cast<int>(INDENT_STEP) : -1, ' ',
+      false, json::error_handler_t::replace);
+    if (! isPretty || indentation == 0) {
+      output += serialized;
+      return;
+    }
+    size_t startOfLine { 0 };
+    for (size_t endOfLine = serialized.find('\n'); endOfLine != string::npos;
+      endOfLine = serialized.find('\n', startOfLine)) {
+      output.append(serialized, startOfLine, endOfLine + 1 - startOfLine);
+      output.append(indentation, ' ');
+      startOfLine = endOfLine + 1;
+    }
+    output.append(serialized, startOfLine);
+  }
+
+  /// Adds a column for a member name, unless there is one already. Tables have few columns.
+  void addColumn(vector<string>& columns, const string_view name) {
+    if (find(columns.begin(), columns.end(), name) == columns.end()) {
+      columns.emplace_back(name);
+    }
+  }
+
+  void appendEscapedCell(string& output, const string_view text) {
+    for (const char character : text) {
+      switch (character) {
+        case '\t': output += "\\t"; break;
+        case '\n': output += "\\n"; break;
+        case '\r': output += "\\r"; break;
+        case '\\': output += "\\\\"; break;
+        default: output += character;
+      }
+    }
+  }
+
+  /// Writes projected lists and objects straight from the JSON text: values are located with
+  /// the simdjson On-Demand API, and their raw text is copied to the output (objects and arrays
+  /// minified), so no DOM is built and unrequested members are merely skipped over.
+  class OnDemandWriter {
+  public:
+    OnDemandWriter(const ToolOutputOptions& options, string& output) :
+      options_(options), output_(output) {
+      for (const auto& field : options_.fields_) {
+        quotedFields_.push_back(json(field).dump());
+      }
+    }
+
+    string writeList(ondemand::array items) {
+      const size_t startOfOutput = output_.size();
+      output_ += '[';
+      size_t index { 0 };
+      for (ondemand::value item : items) {
+        if (index < options_.offset_) {
+          ++index;
+          continue;
+        }
+        const size_t startOfItem = output_.size();
+        if (index > options_.offset_) {
+          output_ += ',';
+        }
+        if (item.type() == ondemand::json_type::object) {
+          writeProjectedObject(item.get_object());
+        } else {
+          appendRawValue(item);
+        }
+        if (isLimitExceeded(index, startOfOutput)) {
+          output_.resize(startOfItem);
+          output_ += ']';
+          return to_string(index);
+        }
+        ++index;
+      }
+      output_ += ']';
+      return string();
+    }
+
+    string writeTable(ondemand::array items) {
+      const size_t startOfOutput = output_.size();
+      vector<string> columns(options_.fields_);
+      if (columns.empty()) {
+        // A first pass over the items collects the names of their members.
+        size_t index { 0 };
+        for (ondemand::value item : items) {
+          if (index++ >= options_.offset_ && item.type() == ondemand::json_type::object) {
+            for (auto member : item.get_object()) {
+              addColumn(columns, member.unescaped_key().value());
+            }
+          }
+        }
+        items.reset();
+      }
+      writeHeader(columns);
+
+      size_t index { 0 };
+      for (ondemand::value item : items) {
+        if (index < options_.offset_) {
+          ++index;
+          continue;
+        }
+        const size_t startOfRow = output_.size();
+        if (item.type() == ondemand::json_type::object) {
+          ondemand::object object = item.get_object();
+          for (size_t column = 0; column < columns.size(); ++column) {
+            if (column > 0) {
+              output_ += '\t';
+            }
+            auto member = object.find_field_unordered(columns[column]);
+            if (member.error() == simdjson::SUCCESS) {
+              appendCell(member.value());
+            }
+          }
+        } else {
+          appendCell(item);
+        }
+        output_ += '\n';
+        if (isLimitExceeded(index, startOfOutput)) {
+          output_.resize(startOfRow);
+          return to_string(index);
+        }
+        ++index;
+      }
+      return string();
+    }
+
+    void writeProjectedObject(ondemand::object object) {
+      output_ += '{';
+      bool isFirstMember { true };
+      for (size_t field = 0; field < options_.fields_.size(); ++field) {
+        auto member = object.find_field_unordered(options_.fields_[field]);
+        if (member.error() != simdjson::SUCCESS) {
+          continue;
+        }
+        if (! isFirstMember) {
+          output_ += ',';
+        }
+        isFirstMember = false;
+        output_ += quotedFields_[field];
+        output_ += ':';
+        appendRawValue(member.value());
+      }
+      output_ += '}';
+    }
+
+    void appendRawValue(ondemand::value value) {
+      const ondemand::json_type type = value.type();
+      if (type == ondemand::json_type::object || type == ondemand::json_type::array) {
+        const string_view raw = value.raw_json();
+        const size_t startOfValue = output_.size();
+        output_.resize(startOfValue + raw.size());
+        size_t minifiedSize { 0 };
+        if (simdjson::minify(raw.data(), raw.size(), output_.data() + startOfValue,
+              minifiedSize) != simdjson::SUCCESS) {
+          throw runtime_error("Malformed JSON value.");
+        }
+        output_.resize(startOfValue + minifiedSize);
+      } else {
+        output_ += trimTrailingWhitespace(value.raw_json_token());
+      }
+    }
+
+  private:
+    void writeHeader(const vector<string>& columns) {
+      for (size_t column = 0; column < columns.size(); ++column) {
+        if (column > 0) {
+          output_ += '\t';
+        }
+        output_ += columns[column];
+      }
+      output_ += '\n';
+    }
+
+    void appendCell(ondemand::value value) {
+      switch (value.type()) {
+        case ondemand::json_type::null:
+          break;
+        case ondemand::json_type::string:
+          appendEscapedCell(output_, value.get_string());
+          break;
+        default:
+          appendRawValue(value);
+      }
+    }
+
+    bool isLimitExceeded(const size_t index, const size_t startOfOutput) const noexcept {
+      // At least one item is written even if it exceeds the limit on its own.
+      return options_.maxResultBytes_ > 0 && index > options_.offset_ &&
+        output_.size() - startOfOutput > options_.maxResultBytes_;
+    }
+
+    const ToolOutputOptions& options_;
+    string& output_;
+    vector<string> quotedFields_;
+  };
+}
+
+ToolOutputOptions ToolOutputOptions::fromArguments(const json& arguments) {
+  ToolOutputOptions options;
+  if (! arguments.is_object()) {
+    return options;
+  }
+
+  const string format = arguments.value("format", string("json"));
+  if (format == "table") {
+    options.format_ = Format::table;
+  } else if (format != "json") {
+    throw runtime_error("Unknown output format: '" + format + "'.");
+  }
+
+  const auto fields = arguments.find("fields");
+  if (fields != arguments.end() && fields->is_array()) {
+    for (const auto& field : *fields) {
+      if (field.is_string()) {
+        options.fields_.push_back(field.get<string>());
+      }
+    }
+  }
+  options.compact_ = arguments.value("compact", true);
+  options.maxResultBytes_ = static_cast<size_t>(
+    max<int64_t>(0, arguments.value("maxResultBytes", int64_t { 0 })));
+
+  const auto cursor = arguments.find("cursor");
+  if (cursor != arguments.end() && cursor->is_string()) {
+    const string& cursorText = cursor->get_ref<const string&>();
+    const auto [end, error] = from_chars(cursorText.data(), cursorText.data() + cursorText.size(),
+      options.offset_);
+    if (! cursorText.empty() &&
+        (error != errc() || end != cursorText.data() + cursorText.size())) {
+      throw runtime_error("Invalid cursor: '" + cursorText + "'.");
+    }
+  }
+  return options;
+}
+
+json ToolOutputOptions::addToInputSchema(json inputSchema) {
+  auto& properties = inputSchema["properties"];
+  properties["format"] = {
+    {"type", "string"},
+    {"enum", {"json", "table"}},
+    {"description", "'table' returns lists as a tab-separated header row of column names "
+      "followed by one row per item, which is much shorter than JSON. The columns are the "
+      "'fields' if given, otherwise the members of all items"},
+    {"default", "json"}
+  };
+  properties["fields"] = {
+    {"type", "array"},
+    {"items", {{"type", "string"}}},
+    {"description", "Only return these fields of each item, e.g. [\"@id\", \"name\", \"@type\"]"}
+  };
+  properties["compact"] = {
+    {"type", "boolean"},
+    {"description", "Return JSON without indentation"},
+    {"default", true}
+  };
+  properties["maxResultBytes"] = {
+    {"type", "integer"},
+    {"description", "Approximate maximum size of the result; longer lists are cut off and a "
+      "cursor for the continuation is returned"}
+  };
+  properties["cursor"] = {
+    {"type", "string"},
+    {"description", "Cursor returned by a previous call whose result has been cut off"}
+  };
+  return inputSchema;
+}
+
+ToolOutputWriter::ToolOutputWriter(const ToolOutputOptions& options) noexcept :
+  options_(options) {
+}
+
+string ToolOutputWriter::write(const json& data, string& output) const {
+  if (! data.is_array()) {
+    writeItem(output, data, 0);
+    return string();
+  }
+  if (options_.format_ == ToolOutputOptions::Format::table) {
+    return writeTable(output, data);
+  }
+
+  const size_t startOfOutput = output.size();
+  const unsigned int indentation = options_.compact_ ? 0 : INDENT_STEP;
+  output += '[';
+  for (size_t index = options_.offset_; index < data.size(); ++index) {
+    const size_t startOfItem = output.size();
+    if (index > options_.offset_) {
+      output += ',';
+    }
+    if (! options_.compact_) {
+      output += '\n';
+      output.append(indentation, ' ');
+    }
+    writeItem(output, data[index], indentation);
+
+    // At least one item is written even if it exceeds the limit on its own.
+    if (options_.maxResultBytes_ > 0 && index > options_.offset_ &&
+        output.size() - startOfOutput > options_.maxResultBytes_) {
+      output.resize(startOfItem);
+      output += options_.compact_ ? "]" : "\n]";
+      return to_string(index);
+    }
+  }
+  if (! options_.compact_ && data.size() > options_.offset_) {
+    output += '\n';
+  }
+  output += ']';
+  return string();
+}
+
+string ToolOutputWriter::writeText(string& text, string& output) const {
+  // Whatever goes wrong, the output is left as it was, so no partial result is returned.
+  const size_t startOfOutput = output.size();
+  try {
+    const bool isProjected = ! options_.fields_.empty() ||
+      options_.format_ == ToolOutputOptions::Format::table;
+    if (! isProjected || ! options_.compact_) {
+      return write(json::parse(text), output);
+    }
+
+    // simdjson reads up to SIMDJSON_PADDING bytes beyond the end of the text.
+    text.reserve(text.size() + simdjson::SIMDJSON_PADDING);
+    thread_local ondemand::parser parser;
+    ondemand::document document = parser.iterate(
+      simdjson::padded_string_view(text.data(), text.size(), text.capacity()));
+    OnDemandWriter writer(options_, output);
+    switch (document.type()) {
+      case ondemand::json_type::array:
+        return options_.format_ == ToolOutputOptions::Format::table ?
+          writer.writeTable(document.get_array()) : writer.writeList(document.get_array());
+      case ondemand::json_type::object:
+        writer.writeProjectedObject(document.get_object());
+        return string();
+      default:
+        output += trimTrailingWhitespace(document.raw_json_token());
+        return string();
+    }
+  } catch (const simdjson::simdjson_error& error) {
+    output.resize(startOfOutput);
+    throw runtime_error(string("Malformed JSON: ") + error.what());
+  } catch (...) {
+    output.resize(startOfOutput);
+    throw;
+  }
+}
+
+string ToolOutputWriter::writeTable(string& output, const json& data) const {
+  vector<string> memberNames;
+  const vector<string>* columns = &options_.fields_;
+  if (columns->empty()) {
+    for (size_t index = options_.offset_; index < data.size(); ++index) {
+      if (data[index].is_object()) {
+        for (const auto& [name, value] : data[index].items()) {
+          addColumn(memberNames, name);
+        }
+      }
+    }
+    columns = &memberNames;
+  }
+
+  const size_t startOfOutput = output.size();
+  for (size_t column = 0; column < columns->size(); ++column) {
+    if (column > 0) {
+      output += '\t';
+    }
+    output += (*columns)[column];
+  }
+  output += '\n';
+
+  for (size_t index = options_.offset_; index < data.size(); ++index) {
+    const size_t startOfRow = output.size();
+    const json& item = data[index];
+    if (item.is_object()) {
+      for (size_t column = 0; column < columns->size(); ++column) {
+        if (column > 0) {
+          output += '\t';
+        }
+        const auto member = item.find((*columns)[column]);
+        if (member != item.end()) {
+          writeCell(output, *member);
+        }
+      }
+    } else {
+      writeCell(output, item);
+    }
+    output += '\n';
+
+    if (options_.maxResultBytes_ > 0 && index > options_.offset_ &&
+        output.size() - startOfOutput > options_.maxResultBytes_) {
+      output.resize(startOfRow);
+      return to_string(index);
+    }
+  }
+  return string();
+}
+
+void ToolOutputWriter::writeCell(string& output, const json& value) const {
+  if (value.is_null()) {
+    return;
+  }
+  if (! value.is_string()) {
+    appendSerialized(output, value, false, 0);
+    return;
+  }
+  appendEscapedCell(output, value.get_ref<const string&>());
+}
+
+void ToolOutputWriter::writeItem(string& output, const json& item,
+  const unsigned int indentation) const {
+  if (item.is_object() && ! options_.fields_.empty()) {
+    writeProjectedObject(output, item, indentation);
+  } else {
+    appendSerialized(output, item, ! options_.compact_, indentation);
+  }
+}
+
+void ToolOutputWriter::writeProjectedObject(string& output, const json& object,
+  const unsigned int indentation) const {
+  output += '{';
+  bool isFirstMember { true };
+  for (const auto& field : options_.fields_) {
+    const auto member = object.find(field);
+    if (member == object.end()) {
+      continue;
+    }
+    if (! isFirstMember) {
+      output += ',';
+    }
+    isFirstMember = false;
+    if (! options_.compact_) {
+      output += '\n';
+      output.append(indentation + INDENT_STEP, ' ');
+    }
+    appendSerialized(output, json(field), false, 0);
+    output += options_.compact_ ? ":" : ": ";
+    appendSerialized(output, *member, ! options_.compact_, indentation + INDENT_STEP);
+  }
+  if (! options_.compact_ && ! isFirstMember) {
+    output += '\n';
+    output.append(indentation, ' ');
+  }
+  output += '}';
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "arenajson.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// @brief Options that shape how the result of a tool is rendered as text.
+struct ToolOutputOptions {
+  enum class Format {
+    json,  ///< the data as JSON
+    table  ///< lists of objects as a header row of column names followed by one row per item
+  };
+
+  Format format_ { Format::json };
+  /// Only these members of the (listed) objects are written; all members if empty.
+  std::vector<std::string> fields_;
+  /// Writes JSON without any whitespace instead of indenting it.
+  bool compact_ { true };
+  /// The approximate maximum size of the rendered result (0 means unlimited). Lists that would
+  /// exceed it are cut off after the last complete item, and a continuation cursor is returned.
+  std::size_t maxResultBytes_ { 0 };
+  /// The index of the first list item to be written, as decoded from a continuation cursor.
+  std::size_t offset_ { 0 };
+
+  /// @brief Extracts the options from the arguments of a tool call.
+  ///
+  /// The recognized arguments are 'format', 'fields', 'compact', 'maxResultBytes' and 'cursor'.
+  /// @throw std::runtime_error if the format or the cursor is malformed.
+  static ToolOutputOptions fromArguments(const json& arguments);
+
+  /// @brief Adds the schemas of the arguments recognized by fromArguments() to the input
+  /// schema of a tool.
+  static json addToInputSchema(json inputSchema);
+};
+
+/// @brief Renders JSON data as text according to ToolOutputOptions.
+///
+/// Projection and the size limit are applied while the data is serialized: the writer walks
+/// the parsed data and writes the selected members straight into the output, so no filtered
+/// copy of the data is ever built.
+///
+/// In the table format, the columns are the requested fields or, if none are requested, the
+/// members of all listed objects, in the order in which they first appear. Cells are separated by tabs; tabs, line breaks and
+/// backslashes within strings are escaped, nested values are written as compact JSON, and
+/// missing or null values leave their cell empty.
+class ToolOutputWriter {
+public:
+  explicit ToolOutputWriter(const ToolOutputOptions& options) noexcept;
+
+  /// @brief Appends the rendering of the data to the output.
+  /// @param data is the data to be rendered. If it is an array, its items are paged.
+  /// @param output is the string the rendering is appended to.
+  /// @return the continuation cursor if the list has been cut off, otherwise an empty string.
+  std::string write(const json& data, std::string& output) const;
+
+  /// @brief Appends the rendering of a JSON text to the output.
+  ///
+  /// If fields are projected or a table is requested, the text is not parsed into a DOM.
+  /// Instead, it is read on demand with simdjson: only the requested members are located, and
+  /// their raw text is copied to the output. Otherwise the text is parsed and passed to write().
+  /// @param text is the JSON text. Its capacity may be increased to provide the padding
+  /// that simdjson requires; its content is not modified.
+  /// @param output is the string the rendering is appended to.
+  /// @return the continuation cursor if the list has been cut off, otherwise an empty string.
+  /// @throw std::runtime_error or json::parse_error if the text is not valid JSON.
+  std::string writeText(std::string& text, std::string& output) const;
+
+private:
+  std::string writeTable(std::string& output, const json& data) const;
+  void writeCell(std::string& output, const json& value) const;
+  void writeItem(std::string& output, const json& item, const unsigned int indentation) const;
+  void writeProjectedObject(std::string& output, const json& object,
+    const unsigned int indentation) const;
+
+  const ToolOutputOptions& options_;
+};
@@ -0,0 +1,96 @@
+#include "toolresultcache.hpp"
+
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+ToolResultCache::ToolResultCache(const size_t capacity, const size_t maxSizeInBytes) :
+  capacityPerShard_(max<size_t>(1, capacity / NUMBER_OF_SHARDS)),
+  maxSizeInBytesPerShard_(max<size_t>(1, maxSizeInBytes / NUMBER_OF_SHARDS)) {
+}
+
+string ToolResultCache::determineKey(const string& toolName, const json& arguments) {
+  string key(toolName);
+  key += '\n';
+  key += arguments.dump(-1, ' ', false, json::error_handler_t::replace);
+  return key;
+}
+
+shared_ptr<const ToolResultCache::CachedToolResult> ToolResultCache::find(const string& key) {
+  Shard& shard = selectShard(key);
+  lock_guard lock(shard.mutex_);
+  const auto found = shard.index_.find(key);
+  if (found == shard.index_.end()) {
+    return nullptr;
+  }
+
+  const auto entry = found->second;
+  if (entry->value_->expiresAt_ <= Clock::now()) {
+    erase(shard, entry);
+    return nullptr;
+  }
+  shard.entries_.splice(shard.entries_.begin(), shard.entries_, entry);
+  return entry->value_;
+}
+
+void ToolResultCache::insert(const string& key, const json& result,
+  const chrono::seconds timeToLive) {
+  // Serialization happens outside of the lock; only the bookkeeping is done while holding it.
+  // The result may live in the arena of the current request, so it is copied, not moved.
+  ArenaSuspension arenaSuspension;
+  auto value = make_shared<CachedToolResult>();
+  value->serializedResult_ = result.dump(-1, ' ', false, json::error_handler_t::replace);
+  value->result_ = result;
+  value->expiresAt_ = Clock::now() + timeToLive;
+  const size_t sizeInBytes = key.size() + value->serializedResult_.size();
+  if (sizeInBytes > maxSizeInBytesPerShard_) {
+    return;
+  }
+
+  Shard& shard = selectShard(key);
+  lock_guard lock(shard.mutex_);
+  const auto found = shard.index_.find(key);
+  if (found != shard.index_.end()) {
+    erase(shard, found->second);
+  }
+  shard.entries_.push_front(Entry { key, move(value), sizeInBytes });
+  shard.index_.emplace(shard.entries_.front().key_, shard.entries_.begin());
+  shard.sizeInBytes_ += sizeInBytes;
+  evictIfNecessary(shard);
+}
+
+void ToolResultCache::clear() noexcept {
+  for (auto& shard : shards_) {
+    lock_guard lock(shard.mutex_);
+    shard.index_.clear();
+    shard.entries_.clear();
+    shard.sizeInBytes_ = 0;
+  }
+}
+
+size_t ToolResultCache::size() const noexcept {
+  size_t numberOfEntries { 0 };
+  for (const auto& shard : shards_) {
+    lock_guard lock(shard.mutex_);
+    numberOfEntries += shard.index_.size();
+  }
+  return numberOfEntries;
+}
+
+ToolResultCache::Shard& ToolResultCache::selectShard(const string& key) noexcept {
+  return shards_[hash<string> {}(key) % NUMBER_OF_SHARDS];
+}
+
+void ToolResultCache::erase(Shard& shard, const list<Entry>::iterator entry) noexcept {
+  shard.sizeInBytes_ -= entry->sizeInBytes_;
+  shard.index_.erase(entry->key_);
+  shard.entries_.erase(entry);
+}
+
+void ToolResultCache::evictIfNecessary(Shard& shard) noexcept {
+  while (shard.entries_.size() > capacityPerShard_ ||
+         shard.sizeInBytes_ > maxSizeInBytesPerShard_) {
+    erase(shard, prev(shard.entries_.end()));
+  }
+}
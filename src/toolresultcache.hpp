@@ -0,0 +1,90 @@
+#pragma once
+
+#include "arenajson.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/// @brief A bounded, concurrent cache for the results of MCP tool calls.
+///
+/// The cache is split into shards, each guarded by its own mutex, so that concurrent lookups of
+/// different keys rarely contend. Every shard evicts its least recently used entries as soon as
+/// it exceeds its share of the entry or byte budget. Entries expire after their time to live.
+///
+/// Besides the result object, an entry holds the result already serialized, so that a response
+/// can be built from a cache hit without touching the JSON object at all.
+class ToolResultCache {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct CachedToolResult {
+    json result_;
+    std::string serializedResult_;
+    Clock::time_point expiresAt_;
+  };
+
+  /// @brief An initialization constructor.
+  /// @param capacity is the maximum number of cached results.
+  /// @param maxSizeInBytes is the maximum total size of the serialized results and their keys.
+  explicit ToolResultCache(const std::size_t capacity = DEFAULT_CAPACITY,
+    const std::size_t maxSizeInBytes = DEFAULT_MAX_SIZE_IN_BYTES);
+
+  /// @brief Builds the cache key for a call of a tool.
+  ///
+  /// The members of JSON objects are always serialized in sorted order, so arguments that only
+  /// differ in the order of their members yield the same key.
+  /// @param toolName is the name of the called tool.
+  /// @param arguments are the arguments of the call.
+  static std::string determineKey(const std::string& toolName, const json& arguments);
+
+  /// @brief Looks up a result.
+  /// @param key is the key built by determineKey().
+  /// @return the cached result, or nullptr if there is none or it has expired.
+  std::shared_ptr<const CachedToolResult> find(const std::string& key);
+
+  /// @brief Adds or replaces a result.
+  /// @param key is the key built by determineKey().
+  /// @param result is the result of the tool call.
+  /// @param timeToLive is the time after which the result must no longer be used.
+  void insert(const std::string& key, const json& result, const std::chrono::seconds timeToLive);
+
+  /// @brief Removes all results.
+  void clear() noexcept;
+
+  /// @brief Determines the number of cached results.
+  std::size_t size() const noexcept;
+
+  static constexpr std::size_t DEFAULT_CAPACITY { 4096 };
+  static constexpr std::size_t DEFAULT_MAX_SIZE_IN_BYTES { 64 * 1024 * 1024 };
+
+private:
+  struct Entry {
+    std::string key_;
+    std::shared_ptr<const CachedToolResult> value_;
+    std::size_t sizeInBytes_;
+  };
+
+  struct Shard {
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_;  ///< the most recently used entry comes first
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+    std::size_t sizeInBytes_ { 0 };
+  };
+
+  Shard& selectShard(const std::string& key) noexcept;
+  void erase(Shard& shard, std::list<Entry>::iterator entry) noexcept;
+  void evictIfNecessary(Shard& shard) noexcept;
+
+  static constexpr std::size_t NUMBER_OF_SHARDS { 16 };
+
+  std::array<Shard, NUMBER_OF_SHARDS> shards_;
+  std::size_t capacityPerShard_;
+  std::size_t maxSizeInBytesPerShard_;
+};
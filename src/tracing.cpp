@@ -0,0 +1,262 @@
+#include "tracing.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+  constexpr size_t MAX_DETAIL_LENGTH { 40 };
+  constexpr auto FLUSH_INTERVAL { chrono::seconds(1) };
+
+  struct SpanRecord {
+    string_view name_;
+    array<char, MAX_DETAIL_LENGTH> detail_;
+    size_t detailLength_;
+    int64_t startInMicroseconds_;
+    int64_t durationInMicroseconds_;
+  };
+
+  // The mutex is only contended while the buffer is drained.
+  struct ThreadBuffer {
+    mutex mutex_;
+    vector<SpanRecord> records_ = vector<SpanRecord>(Tracer::RING_BUFFER_CAPACITY);
+    uint64_t written_ { 0 };
+    uint64_t drained_ { 0 };
+    uint32_t threadId_ { 0 };
+  };
+
+  struct TracerState {
+    /// Guards all members except the atomic ones.
+    mutex mutex_;
+    ofstream file_;
+    bool hasWrittenSpan_ { false };
+    uint64_t lostSpans_ { 0 };
+    vector<shared_ptr<ThreadBuffer>> buffers_;
+    thread flusher_;
+    condition_variable flusherWakeup_;
+    bool flusherRunning_ { false };
+
+    atomic<bool> started_ { false };
+    atomic<unsigned int> samplingRate_ { 1 };
+    atomic<uint64_t> requestCounter_ { 0 };
+    atomic<uint32_t> nextThreadId_ { 1 };
+    chrono::steady_clock::time_point epoch_;
+
+    ~TracerState() {
+      if (flusher_.joinable()) {
+        {
+          lock_guard lock(mutex_);
+          flusherRunning_ = false;
+        }
+        flusherWakeup_.notify_all();
+        flusher_.join();
+      }
+    }
+  };
+
+  TracerState& tracerState() {
+    static TracerState state;
+    return state;
+  }
+
+  thread_local bool requestIsRecorded { false };
+  thread_local unsigned int requestDepth { 0 };
+  thread_local shared_ptr<ThreadBuffer> threadBuffer;
+
+  ThreadBuffer& retrieveThreadBuffer() {
+    if (! threadBuffer) {
+      TracerState& state = tracerState();
+      threadBuffer = make_shared<ThreadBuffer>();
+      threadBuffer->threadId_ = state.nextThreadId_.fetch_add(1, memory_order_relaxed);
+      lock_guard lock(state.mutex_);
+      state.buffers_.push_back(threadBuffer);
+    }
+    return *threadBuffer;
+  }
+
+  int64_t microsecondsSinceEpoch() noexcept {
+    return chrono::duration_cast<chrono::microseconds>(
+      chrono::steady_clock::now() - tracerState().epoch_).count();
+  }
+
+  void appendJsonString(string& output, const string_view text) {
+    output += '"';
+    for (const char character : text) {
+      if (character == '"' || character == '\\') {
+        output += '\\';
+        output += character;
+      } else if (static_cast<unsigned char>(character) < 0x20) {
+        output += ' ';
+      } else {
+        output += character;
+      }
+    }
+    output += '"';
+  }
+
+  void appendTraceEvent(string& output, const SpanRecord& record, const uint32_t threadId) {
+    output += "{\"name\":";
+    appendJsonString(output, record.name_);
+    output += ",\"cat\":\"mcp\",\"ph\":\"X\",\"ts\":";
+    output += to_string(record.startInMicroseconds_);
+    output += ",\"dur\":";
+    output += to_string(record.durationInMicroseconds_);
+    output += ",\"pid\":1,\"tid\":";
+    output += to_string(threadId);
+    if (record.detailLength_ > 0) {
+      output += ",\"args\":{\"detail\":";
+      appendJsonString(output, string_view(record.detail_.data(), record.detailLength_));
+      output += '}';
+    }
+    output += '}';
+  }
+
+  void runFlusher() {
+    TracerState& state = tracerState();
+    unique_lock lock(state.mutex_);
+    while (state.flusherRunning_) {
+      state.flusherWakeup_.wait_for(lock, FLUSH_INTERVAL);
+      lock.unlock();
+      Tracer::flush();
+      lock.lock();
+    }
+  }
+}
+
+void Tracer::start(const string& traceFileName, const unsigned int samplingRate) {
+  stop();
+  TracerState& state = tracerState();
+  {
+    lock_guard lock(state.mutex_);
+    state.file_.open(traceFileName, ios::out | ios::trunc);
+    if (! state.file_) {
+      throw runtime_error("Cannot open the trace file '" + traceFileName + "'.");
+    }
+    // The JSON array format of the Chrome trace event format. A trace that lacks the closing
+    // bracket, e.g. because the server has been killed, can still be opened.
+    state.file_ << "[\n";
+    state.hasWrittenSpan_ = false;
+    state.lostSpans_ = 0;
+    state.epoch_ = chrono::steady_clock::now();
+    state.samplingRate_.store(samplingRate, memory_order_relaxed);
+    state.flusherRunning_ = true;
+    state.flusher_ = thread(runFlusher);
+  }
+  state.started_.store(true, memory_order_release);
+}
+
+void Tracer::stop() {
+  TracerState& state = tracerState();
+  if (! state.started_.exchange(false, memory_order_acq_rel)) {
+    return;
+  }
+  {
+    lock_guard lock(state.mutex_);
+    state.flusherRunning_ = false;
+  }
+  state.flusherWakeup_.notify_all();
+  state.flusher_.join();
+
+  flush();
+  lock_guard lock(state.mutex_);
+  state.file_ << "\n]\n";
+  state.file_.close();
+  if (state.lostSpans_ > 0) {
+    spdlog::warn("{} trace spans have been lost because ring buffers were full.",
+      state.lostSpans_);
+  }
+}
+
+void Tracer::flush() {
+  TracerState& state = tracerState();
+  lock_guard lock(state.mutex_);
+  if (! state.file_.is_open()) {
+    return;
+  }
+
+  string output;
+  vector<SpanRecord> records;
+  for (const auto& buffer : state.buffers_) {
+    records.clear();
+    {
+      lock_guard bufferLock(buffer->mutex_);
+      if (buffer->written_ - buffer->drained_ > RING_BUFFER_CAPACITY) {
+        state.lostSpans_ += buffer->written_ - buffer->drained_ - RING_BUFFER_CAPACITY;
+        buffer->drained_ = buffer->written_ - RING_BUFFER_CAPACITY;
+      }
+      for (; buffer->drained_ < buffer->written_; ++buffer->drained_) {
+        records.push_back(buffer->records_[buffer->drained_ % RING_BUFFER_CAPACITY]);
+      }
+    }
+    for (const auto& record : records) {
+      output += state.hasWrittenSpan_ ? ",\n" : "";
+      appendTraceEvent(output, record, buffer->threadId_);
+      state.hasWrittenSpan_ = true;
+    }
+  }
+  // The buffers of threads that have ended are no longer needed once they are drained.
+  erase_if(state.buffers_, [](const shared_ptr<ThreadBuffer>& buffer) {
+    return buffer.use_count() == 1;
+  });
+
+  state.file_ << output;
+  state.file_.flush();
+}
+
+bool Tracer::isRecording() noexcept {
+  return requestIsRecorded;
+}
+
+TracedRequest::TracedRequest() noexcept :
+  wasRecording_(requestIsRecorded), isOutermost_(requestDepth++ == 0) {
+  if (isOutermost_) {
+    TracerState& state = tracerState();
+    const unsigned int samplingRate = state.samplingRate_.load(memory_order_relaxed);
+    requestIsRecorded = state.started_.load(memory_order_acquire) && (samplingRate <= 1 ||
+      state.requestCounter_.fetch_add(1, memory_order_relaxed) % samplingRate == 0);
+  }
+}
+
+TracedRequest::~TracedRequest() {
+  --requestDepth;
+  requestIsRecorded = wasRecording_;
+}
+
+TraceSpan::TraceSpan(const string_view name, const string_view detail) noexcept :
+  name_(name), detail_(detail) {
+  if (requestIsRecorded) {
+    startInMicroseconds_ = microsecondsSinceEpoch();
+  }
+}
+
+TraceSpan::~TraceSpan() {
+  if (startInMicroseconds_ < 0) {
+    return;
+  }
+  const int64_t endInMicroseconds = microsecondsSinceEpoch();
+  try {
+    ThreadBuffer& buffer = retrieveThreadBuffer();
+    lock_guard lock(buffer.mutex_);
+    SpanRecord& record = buffer.records_[buffer.written_ % Tracer::RING_BUFFER_CAPACITY];
+    record.name_ = name_;
+    record.detailLength_ = min(detail_.size(), MAX_DETAIL_LENGTH);
+    copy_n(detail_.data(), record.detailLength_, record.detail_.data());
+    record.startInMicroseconds_ = startInMicroseconds_;
+    record.durationInMicroseconds_ = endInMicroseconds - startInMicroseconds_;
+    ++buffer.written_;
+  } catch (...) {
+    // A span that cannot be recorded is dropped; tracing must never fail a request.
+  }
+}
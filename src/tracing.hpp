@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// @brief Records the phases of MCP requests as spans and exports them as a Chrome trace.
+///
+/// Spans are recorded into a ring buffer of the thread that executes them, so recording takes
+/// no global lock. A background thread drains the buffers once per second and appends the spans
+/// to the trace file in the Chrome trace event format, which chrome://tracing and Perfetto
+/// can open. If a thread records faster than its buffer is drained, the oldest spans are lost.
+///
+/// Only sampled requests are traced: each TracedRequest decides whether its request is
+/// sampled, and TraceSpans outside a sampled request cost a single thread-local check.
+class Tracer {
+public:
+  /// @brief Starts tracing.
+  /// @param traceFileName is the file the trace is written to. It is overwritten.
+  /// @param samplingRate causes only every samplingRate-th request to be traced (0 and 1 mean
+  /// that all requests are traced).
+  /// @throw std::runtime_error if the trace file cannot be opened.
+  static void start(const std::string& traceFileName, const unsigned int samplingRate);
+
+  /// @brief Writes the remaining spans, completes the trace file and stops tracing.
+  static void stop();
+
+  /// @brief Appends all spans recorded so far to the trace file.
+  static void flush();
+
+  /// @brief Checks whether the calling thread is executing a sampled request.
+  static bool isRecording() noexcept;
+
+  static constexpr std::size_t RING_BUFFER_CAPACITY { 2048 };
+};
+
+/// @brief Marks the processing of one request on the calling thread and decides whether it is
+/// traced. Nested instances keep the decision of the outermost one.
+class TracedRequest {
+public:
+  TracedRequest() noexcept;
+  ~TracedRequest();
+
+  TracedRequest(const TracedRequest&) = delete;
+  TracedRequest& operator=(const TracedRequest&) = delete;
+
+private:
+  bool wasRecording_;
+  bool isOutermost_;
+};
+
+/// @brief A span that lasts for the lifetime of the object, recorded if the request is sampled.
+///
+/// Usage: const TraceSpan span("parse request");
+class TraceSpan {
+public:
+  /// @param name is the name of the phase. It must refer to a string with static storage
+  /// duration, e.g. a string literal.
+  /// @param detail is an optional annotation such as a tool name. It is copied (and possibly
+  /// truncated) when the span ends, so it must only outlive the span.
+  explicit TraceSpan(const std::string_view name, const std::string_view detail = {}) noexcept;
+  ~TraceSpan();
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+  std::string_view name_;
+  std::string_view detail_;
+  std::int64_t startInMicroseconds_ { -1 };
+};
@@ -0,0 +1,397 @@
+#include "unixsocketmcptransport.hpp"
+#include "globals.hpp"
+#include "logpayload.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+  string systemErrorMessage(const string_view what) {
+    string message(what);
+    message += ": ";
+    message += strerror(errno);
+    return message;
+  }
+}
+
+UnixSocketMcpTransport::UnixSocketMcpTransport(const string& socketPath,
+  AccessPolicy accessPolicy, const size_t numberOfWorkers) :
+  socketPath_(socketPath),
+  accessPolicy_(accessPolicy ? move(accessPolicy) : allowUids({ ::geteuid() })),
+  numberOfWorkers_(numberOfWorkers) { }
+
+void UnixSocketMcpTransport::start(McpRequestHandler requestHandler) {
+  if (running_)
+    return;
+
+  requestHandler_ = move(requestHandler);
+  openListeningSocket();
+  workerPool_ = make_unique<WorkerPool>(numberOfWorkers_, globals::FAST_LANE_WORKERS);
+
+  running_ = true;
+  eventLoopThread_ = thread([this]() { runEventLoop(); });
+  spdlog::info("Listening for MCP clients on Unix domain socket '{}'.", socketPath_);
+}
+
+void UnixSocketMcpTransport::stop() {
+  if (! running_.exchange(false))
+    return;
+
+  const uint64_t wakeup { 1 };
+  [[maybe_unused]] const auto written = ::write(wakeupFd_, &wakeup, sizeof(wakeup));
+  if (eventLoopThread_.joinable()) {
+    eventLoopThread_.join();
+  }
+  workerPool_->shutdown();
+  closeAllDescriptors();
+  ::unlink(socketPath_.c_str());
+}
+
+bool UnixSocketMcpTransport::isRunning() const noexcept {
+  return running_;
+}
+
+UnixSocketMcpTransport::~UnixSocketMcpTransport() {
+  stop();
+}
+
+UnixSocketMcpTransport::AccessPolicy UnixSocketMcpTransport::allowUids(vector<uid_t> allowedUids) {
+  return [allowedUids = move(allowedUids)](const PeerCredentials& peer) {
+    return find(allowedUids.begin(), allowedUids.end(), peer.uid_) != allowedUids.end();
+  };
+}
+
+void UnixSocketMcpTransport::openListeningSocket() {
+  sockaddr_un address {};
+  address.sun_family = AF_UNIX;
+  if (socketPath_.empty() || socketPath_.size() >= sizeof(address.sun_path)) {
+    throw runtime_error("Invalid Unix domain socket path: '" + socketPath_ + "'");
+  }
+  socketPath_.copy(address.sun_path, socketPath_.size());
+
+  listenFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd_ < 0) {
+    throw runtime_error(systemErrorMessage("Cannot create Unix domain socket"));
+  }
+
+  ::unlink(socketPath_.c_str());
+  if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+      ::listen(listenFd_, SOMAXCONN) < 0) {
+    const string message = systemErrorMessage("Cannot listen on '" + socketPath_ + "'");
+    closeAllDescriptors();
+    throw runtime_error(message);
+  }
+
+  epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+  wakeupFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epollFd_ < 0 || wakeupFd_ < 0) {
+    const string message = systemErrorMessage("Cannot create epoll instance");
+    closeAllDescriptors();
+    throw runtime_error(message);
+  }
+
+  epoll_event event {};
+  event.events = EPOLLIN | EPOLLET;
+  event.data.fd = listenFd_;
+  ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &event);
+  event.data.fd = wakeupFd_;
+  ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeupFd_, &event);
+}
+
+void UnixSocketMcpTransport::runEventLoop() {
+  epoll_event events[MAX_EVENTS_PER_WAIT];
+
+  while (running_) {
+    const int numberOfEvents = ::epoll_wait(epollFd_, events, MAX_EVENTS_PER_WAIT, -1);
+    if (numberOfEvents < 0) {
+      if (errno == EINTR)
+        continue;
+      spdlog::critical("FATAL ERROR -- epoll_wait failed: {}", strerror(errno));
+      running_ = false;
+      break;
+    }
+
+    for (int index = 0; index < numberOfEvents; ++index) {
+      const int fd = events[index].data.fd;
+      const uint32_t flags = events[index].events;
+
+      if (fd == listenFd_) {
+        acceptConnections();
+      } else if (fd == wakeupFd_) {
+        uint64_t counter;
+        while (::read(wakeupFd_, &counter, sizeof(counter)) > 0) { }
+        drainCompletedResponses();
+      } else {
+        auto iter = connections_.find(fd);
+        if (iter == connections_.end())
+          continue;
+
+        if (flags & (EPOLLERR | EPOLLHUP)) {
+          closeConnection(fd);
+          continue;
+        }
+        if (flags & EPOLLOUT) {
+          writeToConnection(iter->second);
+          iter = connections_.find(fd);
+          if (iter == connections_.end())
+            continue;
+        }
+        // With edge-triggered epoll, no further event arrives for data that has been left in
+        // the socket, so a paused connection is read again once its output has drained.
+        if ((flags & (EPOLLIN | EPOLLRDHUP)) || iter->second.readPaused_) {
+          readFromConnection(iter->second);
+        }
+      }
+    }
+  }
+}
+
+void UnixSocketMcpTransport::acceptConnections() {
+  while (true) {
+    const int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        spdlog::error("Accepting a connection failed: {}", strerror(errno));
+      }
+      return;
+    }
+
+    ucred credentials {};
+    socklen_t length = sizeof(credentials);
+    if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) < 0) {
+      spdlog::error("Cannot determine peer credentials: {}", strerror(errno));
+      ::close(fd);
+      continue;
+    }
+
+    const PeerCredentials peer { credentials.pid, credentials.uid, credentials.gid };
+    if (! accessPolicy_(peer)) {
+      spdlog::warn("Connection from pid {0} (uid {1}, gid {2}) rejected by access policy.",
+        peer.pid_, peer.uid_, peer.gid_);
+      ::close(fd);
+      continue;
+    }
+
+    epoll_event event {};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = fd;
+    if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+      ::close(fd);
+      continue;
+    }
+
+    Connection& connection = connections_[fd];
+    connection.fd_ = fd;
+    connection.generation_ = nextGeneration_++;
+    connection.peer_ = peer;
+    spdlog::info("MCP client connected: pid {0} (uid {1}, gid {2}).", peer.pid_, peer.uid_,
+      peer.gid_);
+  }
+}
+
+void UnixSocketMcpTransport::readFromConnection(Connection& connection) {
+  // Frames are dispatched after every chunk, so a frame beyond the maximum size is detected
+  // while it is received. Reading pauses while MAX_PENDING_RESPONSES frames await their
+  // response or MAX_BUFFERED_OUTPUT_SIZE of output has not been sent, so a client that sends
+  // faster than it reads cannot make the server queue work or output without bound.
+  connection.readPaused_ = false;
+  char chunk[READ_CHUNK_SIZE];
+  while (! connection.readClosed_) {
+    if (! canAcceptInput(connection)) {
+      connection.readPaused_ = true;
+      break;
+    }
+    const ssize_t received = ::recv(connection.fd_, chunk, sizeof(chunk), 0);
+    if (received > 0) {
+      connection.input_.append(chunk, static_cast<size_t>(received));
+      if (! dispatchFrames(connection))
+        return;
+      continue;
+    }
+    if (received == 0) {
+      // Orderly shutdown by the peer: Frames that have already been received are answered
+      // before the connection is closed, including a last frame without a trailing newline.
+      connection.readClosed_ = true;
+      connection.input_.finish();
+      if (! dispatchFrames(connection))
+        return;
+      break;
+    }
+    if (errno == EINTR)
+      continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      break;
+
+    closeConnection(connection.fd_);
+    return;
+  }
+
+  if (connection.readClosed_) {
+    writeToConnection(connection);
+  }
+}
+
+bool UnixSocketMcpTransport::canAcceptInput(const Connection& connection) const noexcept {
+  return connection.pendingResponses_ < MAX_PENDING_RESPONSES &&
+    connection.outputBuffer_.size() - connection.outputOffset_ < MAX_BUFFERED_OUTPUT_SIZE;
+}
+
+bool UnixSocketMcpTransport::dispatchFrames(Connection& connection) {
+  const int fd = connection.fd_;
+  const uint64_t generation = connection.generation_;
+  const PeerCredentials peer = connection.peer_;
+  connection.input_.extractFrames([&](const string_view frame) {
+    const RequestLane lane = classifyRequest(frame);
+    ++connection.pendingResponses_;
+    workerPool_->submit([this, fd, generation, peer, frame = string(frame)]() {
+      // Notifications are completed with an empty response, so that the event loop knows
+      // when all frames of a half-closed connection have been answered.
+      completeResponse(fd, generation, handleFrame(frame, peer));
+    }, lane);
+  });
+
+  if (connection.input_.bufferedSize() > MAX_FRAME_SIZE) {
+    spdlog::error("Frame from pid {} exceeds the maximum size; closing the connection.",
+      connection.peer_.pid_);
+    closeConnection(connection.fd_);
+    return false;
+  }
+  return true;
+}
+
+void UnixSocketMcpTransport::writeToConnection(Connection& connection) {
+  while (connection.outputOffset_ < connection.outputBuffer_.size()) {
+    const ssize_t sent = ::send(connection.fd_,
+      connection.outputBuffer_.data() + connection.outputOffset_,
+      connection.outputBuffer_.size() - connection.outputOffset_, MSG_NOSIGNAL);
+    if (sent > 0) {
+      connection.outputOffset_ += static_cast<size_t>(sent);
+      continue;
+    }
+    if (sent < 0 && errno == EINTR)
+      continue;
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return; // The remainder is written when epoll signals EPOLLOUT.
+
+    closeConnection(connection.fd_);
+    return;
+  }
+
+  connection.outputBuffer_.clear();
+  connection.outputOffset_ = 0;
+  if (connection.readClosed_ && connection.pendingResponses_ == 0) {
+    closeConnection(connection.fd_);
+  }
+}
+
+void UnixSocketMcpTransport::drainCompletedResponses() {
+  vector<CompletedResponse> completedResponses;
+  {
+    lock_guard lock(completionMutex_);
+    completedResponses.swap(completedResponses_);
+  }
+
+  // Append all responses first, so that several responses for the same client are written
+  // with as few system calls as possible.
+  vector<int> connectionsToFlush;
+  for (auto& completed : completedResponses) {
+    auto iter = connections_.find(completed.fd_);
+    if (iter == connections_.end() || iter->second.generation_ != completed.generation_)
+      continue; // The client has gone away in the meantime.
+    --iter->second.pendingResponses_;
+    iter->second.outputBuffer_ += completed.bytes_;
+    connectionsToFlush.push_back(completed.fd_);
+  }
+
+  sort(connectionsToFlush.begin(), connectionsToFlush.end());
+  connectionsToFlush.erase(unique(connectionsToFlush.begin(), connectionsToFlush.end()),
+    connectionsToFlush.end());
+  for (const int fd : connectionsToFlush) {
+    auto iter = connections_.find(fd);
+    if (iter == connections_.end())
+      continue;
+    writeToConnection(iter->second);
+    iter = connections_.find(fd);
+    if (iter != connections_.end() && iter->second.readPaused_) {
+      readFromConnection(iter->second);
+    }
+  }
+}
+
+void UnixSocketMcpTransport::completeResponse(const int fd, const uint64_t generation,
+  string bytes) {
+  {
+    lock_guard lock(completionMutex_);
+    completedResponses_.push_back({fd, generation, move(bytes)});
+  }
+  const uint64_t wakeup { 1 };
+  [[maybe_unused]] const auto written = ::write(wakeupFd_, &wakeup, sizeof(wakeup));
+}
+
+void UnixSocketMcpTransport::closeConnection(const int fd) {
+  ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+  ::close(fd);
+  connections_.erase(fd);
+}
+
+void UnixSocketMcpTransport::closeAllDescriptors() noexcept {
+  for (const auto& [fd, connection] : connections_) {
+    ::close(fd);
+  }
+  connections_.clear();
+
+  for (int* fd : { &listenFd_, &epollFd_, &wakeupFd_ }) {
+    if (*fd >= 0) {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+string UnixSocketMcpTransport::handleFrame(const string& frame, const PeerCredentials& peer) const {
+  ArenaScope arenaScope; // All JSON of the request is released at once on return.
+  const TracedRequest tracedRequest;
+  const TraceSpan requestSpan("Unix socket MCP request");
+  ServerMetrics::instance().mcpRequestSize_.observe(frame.size());
+  try {
+    json request;
+    {
+      const TraceSpan parseSpan("parse request");
+      request = json::parse(frame);
+    }
+    spdlog::debug("Request from uid {0} is: {1}", peer.uid_, LogPayload(frame));
+    string serializedResponse = requestHandler_(request);
+    if (serializedResponse.empty())
+      return {}; // Notifications are not answered.
+
+    spdlog::debug("Received response from request handler: {}", LogPayload(serializedResponse));
+    serializedResponse += '\n';
+    return serializedResponse;
+  } catch (const exception& ex) {
+    const json errorResponse = {
+      {"jsonrpc", "2.0"},
+      {"id", nullptr},
+      {"error", {
+        {"code", -32700},
+        {"message", std::string(ex.what())}
+      }}
+    };
+    spdlog::error("while parsing received data from uid {0}: {1}", peer.uid_, ex.what());
+    return errorResponse.dump() + '\n';
+  }
+}
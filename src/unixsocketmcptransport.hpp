@@ -0,0 +1,122 @@
+#pragma once
+
+#include "lineframer.hpp"
+#include "mcptransport.hpp"
+#include "workerpool.hpp"
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// @brief The credentials of the process at the other end of a Unix domain socket.
+struct PeerCredentials {
+  pid_t pid_;
+  uid_t uid_;
+  gid_t gid_;
+};
+
+/// @brief Implements MCP transport via a Unix domain (AF_UNIX) stream socket.
+///
+/// Intended for agents running on the same host as the server: there is no TCP and no HTTP
+/// framing. Messages are newline-delimited JSON-RPC frames, as with StdinStdoutMcpTransport.
+/// Any number of clients can be connected at the same time; they are served by one epoll event
+/// loop, and their requests are processed concurrently by a pool of workers. Responses are
+/// written in completion order and are correlated with their requests by the JSON-RPC id.
+///
+/// The credentials of every connecting peer are obtained from the kernel (SO_PEERCRED) and
+/// are passed to an access policy that decides whether the connection is accepted. By default,
+/// only peers running as the same user as the server are accepted.
+class UnixSocketMcpTransport final : public MCPTransport {
+public:
+  using AccessPolicy = std::function<bool(const PeerCredentials&)>;
+
+  /// @brief An initialization constructor.
+  /// @param socketPath is the file system path of the socket to listen on. An existing socket
+  /// file with this path is replaced.
+  /// @param accessPolicy decides whether a connecting peer is accepted. If empty, only peers
+  /// with the effective user id of the server are accepted.
+  /// @param numberOfWorkers is the number of threads processing MCP requests (0 means one per
+  /// hardware thread). Additional threads only process requests of the fast lane.
+  explicit UnixSocketMcpTransport(const std::string& socketPath,
+    AccessPolicy accessPolicy = {}, const std::size_t numberOfWorkers = 0);
+  UnixSocketMcpTransport() = delete;
+
+  void start(McpRequestHandler requestHandler) override;
+  void stop() override;
+  bool isRunning() const noexcept override;
+
+  ~UnixSocketMcpTransport() override;
+
+  /// @brief Creates an access policy that only accepts peers running as one of the given users.
+  /// @param allowedUids are the user ids that are allowed to connect.
+  static AccessPolicy allowUids(std::vector<uid_t> allowedUids);
+
+private:
+  struct Connection {
+    int fd_ { -1 };
+    uint64_t generation_ { 0 };
+    PeerCredentials peer_ {};
+    LineFramer input_;
+    std::string outputBuffer_;
+    std::size_t outputOffset_ { 0 };
+    // The number of dispatched frames whose response has not been queued for writing yet.
+    std::size_t pendingResponses_ { 0 };
+    // The peer has shut down its side; the connection is closed once all frames are answered.
+    bool readClosed_ { false };
+    // Reading has stopped because too many frames await their response or the peer has not
+    // read the buffered output yet.
+    bool readPaused_ { false };
+  };
+
+  struct CompletedResponse {
+    int fd_;
+    uint64_t generation_;
+    std::string bytes_;
+  };
+
+  void openListeningSocket();
+  void runEventLoop();
+  void acceptConnections();
+  void readFromConnection(Connection& connection);
+  bool dispatchFrames(Connection& connection);
+  bool canAcceptInput(const Connection& connection) const noexcept;
+  void writeToConnection(Connection& connection);
+  void drainCompletedResponses();
+  void completeResponse(int fd, uint64_t generation, std::string bytes);
+  void closeConnection(int fd);
+  void closeAllDescriptors() noexcept;
+
+  std::string handleFrame(const std::string& frame, const PeerCredentials& peer) const;
+
+  std::string socketPath_;
+  AccessPolicy accessPolicy_;
+  std::size_t numberOfWorkers_;
+
+  int listenFd_ { -1 };
+  int epollFd_ { -1 };
+  int wakeupFd_ { -1 };
+  uint64_t nextGeneration_ { 1 };
+  std::unordered_map<int, Connection> connections_;
+
+  std::mutex completionMutex_;
+  std::vector<CompletedResponse> completedResponses_;
+
+  McpRequestHandler requestHandler_;
+  std::unique_ptr<WorkerPool> workerPool_;
+  std::thread eventLoopThread_;
+  std::atomic<bool> running_ { false };
+
+  static constexpr int MAX_EVENTS_PER_WAIT { 256 };
+  static constexpr std::size_t READ_CHUNK_SIZE { 16 * 1024 };
+  static constexpr std::size_t MAX_FRAME_SIZE { 16 * 1024 * 1024 };
+  static constexpr std::size_t MAX_PENDING_RESPONSES { 64 };
+  static constexpr std::size_t MAX_BUFFERED_OUTPUT_SIZE { 1024 * 1024 };
+};
@@ -0,0 +1,163 @@
+#include "upstreambalancer.hpp"
+#include "metrics.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+  /// The weight of the latest latency in the moving average.
+  constexpr double EWMA_WEIGHT { 0.2 };
+}
+
+UpstreamBalancer::Lease::Lease(UpstreamBalancer* balancer, const size_t replica) noexcept :
+  balancer_(balancer), replica_(replica) { }
+
+UpstreamBalancer::Lease::Lease(Lease&& other) noexcept :
+  balancer_(other.balancer_), replica_(other.replica_) {
+  other.balancer_ = nullptr;
+}
+
+UpstreamBalancer::Lease::~Lease() {
+  if (balancer_ != nullptr) {
+    balancer_->release(replica_, chrono::microseconds(0), true);
+  }
+}
+
+const string& UpstreamBalancer::Lease::baseUrl() const noexcept {
+  return balancer_->replicas_[replica_].baseUrl_;
+}
+
+void UpstreamBalancer::Lease::complete(const chrono::microseconds latency,
+  const bool failed) noexcept {
+  if (balancer_ != nullptr) {
+    balancer_->release(replica_, latency, failed);
+    balancer_ = nullptr;
+  }
+}
+
+UpstreamBalancer::UpstreamBalancer(vector<string> baseUrls) {
+  if (baseUrls.empty()) {
+    throw invalid_argument("At least one upstream URL must be given.");
+  }
+  for (auto& baseUrl : baseUrls) {
+    replicas_.push_back({ move(baseUrl) });
+  }
+}
+
+UpstreamBalancer::~UpstreamBalancer() {
+  {
+    lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  stopCondition_.notify_all();
+  if (healthCheckThread_.joinable()) {
+    healthCheckThread_.join();
+  }
+}
+
+UpstreamBalancer::Lease UpstreamBalancer::acquireReplica() {
+  lock_guard lock(mutex_);
+  vector<size_t> candidates;
+  candidates.reserve(replicas_.size());
+  for (size_t replica = 0; replica < replicas_.size(); ++replica) {
+    if (! replicas_[replica].ejected_) {
+      candidates.push_back(replica);
+    }
+  }
+
+  size_t chosen { 0 };
+  if (candidates.size() == 1) {
+    chosen = candidates.front();
+  } else if (candidates.size() > 1) {
+    uniform_int_distribution<size_t> distribution(0, candidates.size() - 1);
+    const size_t first = candidates[distribution(randomNumberGenerator_)];
+    size_t second = candidates[distribution(randomNumberGenerator_)];
+    while (second == first) {
+      second = candidates[distribution(randomNumberGenerator_)];
+    }
+    chosen = costOf(replicas_[second]) < costOf(replicas_[first]) ? second : first;
+  }
+  ++replicas_[chosen].requestsInFlight_;
+  return Lease(this, chosen);
+}
+
+void UpstreamBalancer::startHealthChecks(HealthProbe probe, const chrono::milliseconds interval) {
+  if (healthCheckThread_.joinable()) {
+    return;
+  }
+  healthCheckThread_ = thread([this, probe = move(probe), interval] {
+    runHealthChecks(probe, interval);
+  });
+}
+
+bool UpstreamBalancer::isEjected(const size_t replica) const {
+  lock_guard lock(mutex_);
+  return replicas_.at(replica).ejected_;
+}
+
+void UpstreamBalancer::release(const size_t replica, const chrono::microseconds latency,
+  const bool failed) noexcept {
+  lock_guard lock(mutex_);
+  Replica& released = replicas_[replica];
+  --released.requestsInFlight_;
+  if (! failed) {
+    released.consecutiveFailures_ = 0;
+    const double sample = static_cast<double>(latency.count());
+    released.latencyEwma_ = released.latencyEwma_ == 0.0 ? sample :
+      EWMA_WEIGHT * sample + (1.0 - EWMA_WEIGHT) * released.latencyEwma_;
+    return;
+  }
+  if (++released.consecutiveFailures_ >= EJECTION_THRESHOLD && ! released.ejected_) {
+    released.ejected_ = true;
+    ServerMetrics::instance().upstreamReplicaEjections_.withLabels({ released.baseUrl_ })
+      .increment();
+    spdlog::warn("Upstream replica {} ejected after {} consecutive failures.",
+      released.baseUrl_, released.consecutiveFailures_);
+  }
+}
+
+double UpstreamBalancer::costOf(const Replica& replica) const noexcept {
+  return replica.latencyEwma_ * static_cast<double>(replica.requestsInFlight_ + 1);
+}
+
+void UpstreamBalancer::runHealthChecks(const HealthProbe probe,
+  const chrono::milliseconds interval) {
+  unique_lock lock(mutex_);
+  while (! stopCondition_.wait_for(lock, interval, [this] { return stopping_; })) {
+    for (size_t replica = 0; replica < replicas_.size(); ++replica) {
+      if (! replicas_[replica].ejected_) {
+        continue;
+      }
+      // The probe may take long, requests must not wait for it.
+      lock.unlock();
+      const bool isHealthy = probe(replicas_[replica].baseUrl_);
+      lock.lock();
+      if (isHealthy && ! stopping_) {
+        readmit(replica);
+      }
+    }
+  }
+}
+
+void UpstreamBalancer::readmit(const size_t replica) {
+  // A re-admitted replica starts with the average latency of the others, so that it is
+  // neither flooded nor starved.
+  double sumOfLatencies { 0.0 };
+  size_t numberOfHealthyReplicas { 0 };
+  for (const auto& other : replicas_) {
+    if (! other.ejected_) {
+      sumOfLatencies += other.latencyEwma_;
+      ++numberOfHealthyReplicas;
+    }
+  }
+  Replica& readmitted = replicas_[replica];
+  readmitted.latencyEwma_ = numberOfHealthyReplicas > 0 ?
+    sumOfLatencies / static_cast<double>(numberOfHealthyReplicas) : 0.0;
+  readmitted.consecutiveFailures_ = 0;
+  readmitted.ejected_ = false;
+  spdlog::info("Upstream replica {} re-admitted after a successful health check.",
+    readmitted.baseUrl_);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @brief Balances reads across the replicas of an upstream API.
+///
+/// The first URL is the primary, which also serves reads; writes are always sent to it. Each
+/// read is sent to the better of two randomly chosen replicas (power of two choices), where
+/// replicas are compared by the exponentially weighted moving average (EWMA) of their latency,
+/// scaled by the number of their requests in flight. This avoids both the herding of always
+/// choosing the fastest replica and the blindness of round robin.
+///
+/// A replica that fails several times in a row is ejected and no longer chosen. Ejected
+/// replicas are probed periodically by a health check and re-admitted once a probe succeeds.
+class UpstreamBalancer {
+public:
+  /// @brief Probes the replica with the given base URL.
+  /// @return true if the replica is healthy.
+  using HealthProbe = std::function<bool(const std::string& baseUrl)>;
+
+  /// @brief The use of a replica by one request, which must report its outcome.
+  class Lease {
+  public:
+    Lease(Lease&& other) noexcept;
+    Lease& operator=(Lease&&) = delete;
+    /// A lease whose outcome has not been reported counts as failure.
+    ~Lease();
+
+    const std::string& baseUrl() const noexcept;
+
+    /// @param failed is true if the replica could not be reached or answered with a server error.
+    void complete(const std::chrono::microseconds latency, const bool failed) noexcept;
+
+  private:
+    friend class UpstreamBalancer;
+    Lease(UpstreamBalancer* balancer, const std::size_t replica) noexcept;
+
+    UpstreamBalancer* balancer_;
+    const std::size_t replica_;
+  };
+
+  /// @param baseUrls are the base URLs of the primary, followed by those of the replicas.
+  /// @throw std::invalid_argument if no URL is given.
+  explicit UpstreamBalancer(std::vector<std::string> baseUrls);
+  ~UpstreamBalancer();
+
+  const std::string& primaryUrl() const noexcept { return replicas_.front().baseUrl_; }
+
+  /// @brief Chooses the replica for a read. If all replicas have been ejected, the primary is
+  /// chosen.
+  Lease acquireReplica();
+
+  /// @brief Starts a thread that probes the ejected replicas at the given interval.
+  void startHealthChecks(HealthProbe probe, const std::chrono::milliseconds interval);
+
+  bool isEjected(const std::size_t replica) const;
+  std::size_t numberOfReplicas() const noexcept { return replicas_.size(); }
+
+  UpstreamBalancer(const UpstreamBalancer&) = delete;
+  UpstreamBalancer& operator=(const UpstreamBalancer&) = delete;
+
+  /// The number of consecutive failures after which a replica is ejected.
+  static constexpr unsigned int EJECTION_THRESHOLD { 3 };
+
+private:
+  struct Replica {
+    std::string baseUrl_;
+    double latencyEwma_ { 0.0 };
+    std::size_t requestsInFlight_ { 0 };
+    unsigned int consecutiveFailures_ { 0 };
+    bool ejected_ { false };
+  };
+
+  void release(const std::size_t replica, const std::chrono::microseconds latency,
+    const bool failed) noexcept;
+  double costOf(const Replica& replica) const noexcept;
+  void runHealthChecks(const HealthProbe probe, const std::chrono::milliseconds interval);
+  void readmit(const std::size_t replica);
+
+  std::vector<Replica> replicas_;
+  mutable std::mutex mutex_;
+  std::minstd_rand randomNumberGenerator_;
+  std::thread healthCheckThread_;
+  std::condition_variable stopCondition_;
+  bool stopping_ { false };
+};
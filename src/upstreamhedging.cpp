@@ -0,0 +1,98 @@
+#include "upstreamhedging.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+  /// The delay is recomputed after this many latencies, not for every one.
+  constexpr size_t DELAY_UPDATE_INTERVAL { 16 };
+}
+
+HedgingController::HedgingController(const HedgingPolicy& policy) : policy_(policy) { }
+
+optional<chrono::microseconds> HedgingController::hedgeDelay() const {
+  lock_guard lock(mutex_);
+  return delay_;
+}
+
+void HedgingController::recordLatency(const chrono::microseconds latency) {
+  lock_guard lock(mutex_);
+  latencies_[nextLatency_] = latency.count();
+  nextLatency_ = (nextLatency_ + 1) % LATENCY_WINDOW;
+  numberOfLatencies_ = min(numberOfLatencies_ + 1, LATENCY_WINDOW);
+  savedHedges_ = min(savedHedges_ + policy_.budget_, MAX_SAVED_HEDGES);
+  if (numberOfLatencies_ >= MIN_LATENCIES && nextLatency_ % DELAY_UPDATE_INTERVAL == 0) {
+    updateDelay();
+  }
+}
+
+bool HedgingController::tryToSpendBudget() {
+  lock_guard lock(mutex_);
+  if (savedHedges_ < 1.0) {
+    return false;
+  }
+  savedHedges_ -= 1.0;
+  return true;
+}
+
+void HedgingController::updateDelay() {
+  array<int64_t, LATENCY_WINDOW> window;
+  copy_n(latencies_.begin(), numberOfLatencies_, window.begin());
+  const double rank = clamp(policy_.percentile_, 0.0, 100.0) / 100.0 *
+    static_cast<double>(numberOfLatencies_ - 1);
+  const auto percentile = window.begin() + static_cast<ptrdiff_t>(ceil(rank));
+  nth_element(window.begin(), percentile, window.begin() + numberOfLatencies_);
+  delay_ = max(chrono::microseconds(*percentile),
+    chrono::duration_cast<chrono::microseconds>(policy_.minDelay_));
+}
+
+HedgeTimer::HedgeTimer() : thread_([this] { processTasks(); }) { }
+
+HedgeTimer::~HedgeTimer() {
+  {
+    lock_guard lock(mutex_);
+    shuttingDown_ = true;
+  }
+  condition_.notify_all();
+  thread_.join();
+}
+
+void HedgeTimer::schedule(const chrono::steady_clock::time_point deadline, Task task) {
+  bool isNext { false };
+  {
+    lock_guard lock(mutex_);
+    const auto entry = tasks_.emplace(deadline, move(task));
+    isNext = entry == tasks_.begin();
+  }
+  if (isNext) {
+    condition_.notify_all();
+  }
+}
+
+void HedgeTimer::processTasks() {
+  unique_lock lock(mutex_);
+  while (! shuttingDown_) {
+    if (tasks_.empty()) {
+      condition_.wait(lock);
+      continue;
+    }
+    const auto deadline = tasks_.begin()->first;
+    if (chrono::steady_clock::now() < deadline) {
+      condition_.wait_until(lock, deadline);
+      continue;
+    }
+    Task task = move(tasks_.begin()->second);
+    tasks_.erase(tasks_.begin());
+    lock.unlock();
+    try {
+      task();
+    } catch (const exception& ex) {
+      spdlog::error("Uncaught exception in hedge timer: {}", ex.what());
+    }
+    lock.lock();
+  }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "globals.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+/// @brief The configuration of the hedging of upstream reads.
+struct HedgingPolicy {
+  /// The percentile of the recent read latencies after which a read is hedged, e.g. 95.0.
+  double percentile_ { globals::DEFAULT_HEDGING_PERCENTILE };
+  /// The maximum number of hedges in relation to the number of reads, e.g. 0.05 for 5 %.
+  double budget_ { globals::DEFAULT_HEDGING_BUDGET };
+  /// The minimum delay after which a read is hedged, so that fast reads are never hedged.
+  std::chrono::milliseconds minDelay_ { globals::MIN_HEDGING_DELAY_IN_MILLISECONDS };
+};
+
+/// @brief Decides when an idempotent upstream read is hedged, i.e., sent a second time while
+/// the first attempt is still outstanding.
+///
+/// The delay after which a read is hedged adapts to the chosen percentile of the latencies of
+/// the recent reads, so only reads in the tail are hedged. Every read earns a fraction of a
+/// hedge (the budget), and every hedge spends a whole one. This bounds the additional load on
+/// the upstream API, even if all reads become slow at once.
+class HedgingController {
+public:
+  explicit HedgingController(const HedgingPolicy& policy);
+
+  /// @return the delay after which a read is hedged, or no value as long as too few latencies
+  /// have been observed.
+  std::optional<std::chrono::microseconds> hedgeDelay() const;
+
+  /// @brief Observes the latency of a read and credits the budget for it.
+  void recordLatency(const std::chrono::microseconds latency);
+
+  /// @brief Takes one hedge from the budget.
+  /// @return false if the budget is exhausted, in which case the read must not be hedged.
+  bool tryToSpendBudget();
+
+  HedgingController(const HedgingController&) = delete;
+  HedgingController& operator=(const HedgingController&) = delete;
+
+  /// The number of recent latencies from which the delay is derived.
+  static constexpr std::size_t LATENCY_WINDOW { 512 };
+  /// The number of latencies that must be observed before reads are hedged.
+  static constexpr std::size_t MIN_LATENCIES { 32 };
+  /// The number of hedges that may be saved up for bursts.
+  static constexpr double MAX_SAVED_HEDGES { 10.0 };
+
+private:
+  void updateDelay();
+
+  const HedgingPolicy policy_;
+  mutable std::mutex mutex_;
+  std::array<int64_t, LATENCY_WINDOW> latencies_ { };
+  std::size_t numberOfLatencies_ { 0 };
+  std::size_t nextLatency_ { 0 };
+  std::optional<std::chrono::microseconds> delay_;
+  double savedHedges_ { 0.0 };
+};
+
+/// @brief Executes short tasks on a thread of its own once their deadline has passed.
+///
+/// Hedged reads schedule their hedge here, so no thread waits for the delay of a read. The
+/// tasks must not block, they hand the sending of the hedge on to a WorkerPool.
+class HedgeTimer {
+public:
+  using Task = std::function<void()>;
+
+  HedgeTimer();
+  /// Tasks whose deadline has not passed yet are dropped without being executed.
+  ~HedgeTimer();
+
+  void schedule(const std::chrono::steady_clock::time_point deadline, Task task);
+
+  HedgeTimer(const HedgeTimer&) = delete;
+  HedgeTimer& operator=(const HedgeTimer&) = delete;
+
+private:
+  void processTasks();
+
+  std::multimap<std::chrono::steady_clock::time_point, Task> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool shuttingDown_ { false };
+  // Started last, after all other members have been initialized.
+  std::thread thread_;
+};
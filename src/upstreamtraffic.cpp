@@ -0,0 +1,208 @@
+#include "upstreamtraffic.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+namespace {
+  constexpr string_view FILE_MAGIC { "SYSMLREC" };
+  constexpr string_view INDEX_MAGIC { "SYSMLIDX" };
+  constexpr uint32_t FORMAT_VERSION { 1 };
+  constexpr size_t FILE_HEADER_SIZE { 16 };
+  constexpr size_t RECORD_HEADER_SIZE { 24 };
+  constexpr size_t TRAILER_SIZE { 24 };
+
+  // All numbers are stored in little-endian byte order.
+  void appendNumber(string& output, const uint64_t value, const size_t size) {
+    for (size_t index = 0; index < size; ++index) {
+      output += static_cast<char>((value >> (8 * index)) & 0xff);
+    }
+  }
+
+  uint64_t readNumber(const string& input, const uint64_t offset, const size_t size) {
+    uint64_t value { 0 };
+    for (size_t index = 0; index < size; ++index) {
+      value |= static_cast<uint64_t>(static_cast<unsigned char>(input[offset + index])) <<
+        (8 * index);
+    }
+    return value;
+  }
+
+  string determineKey(const string& method, const string& path, const string& requestBody) {
+    string key;
+    key.reserve(method.size() + path.size() + requestBody.size() + 2);
+    key += method;
+    key += ' ';
+    key += path;
+    key += '\n';
+    key += requestBody;
+    return key;
+  }
+
+  string serializeHeaders(const httplib::Headers& headers) {
+    string serializedHeaders;
+    for (const auto& [name, value] : headers) {
+      serializedHeaders += name;
+      serializedHeaders += ": ";
+      serializedHeaders += value;
+      serializedHeaders += "\r\n";
+    }
+    return serializedHeaders;
+  }
+
+  httplib::Headers deserializeHeaders(string_view serializedHeaders) {
+    httplib::Headers headers;
+    while (! serializedHeaders.empty()) {
+      const size_t lineEnd = serializedHeaders.find("\r\n");
+      const string_view line = serializedHeaders.substr(0, lineEnd);
+      const size_t separator = line.find(": ");
+      if (separator != string_view::npos) {
+        headers.emplace(string(line.substr(0, separator)), string(line.substr(separator + 2)));
+      }
+      serializedHeaders = lineEnd == string_view::npos ? string_view() :
+        serializedHeaders.substr(lineEnd + 2);
+    }
+    return headers;
+  }
+}
+
+UpstreamTrafficRecorder::UpstreamTrafficRecorder(const string& fileName) :
+  file_(fileName, ios::out | ios::binary | ios::trunc) {
+  if (! file_) {
+    throw runtime_error("Cannot create the recording file '" + fileName + "'.");
+  }
+  string header(FILE_MAGIC);
+  appendNumber(header, FORMAT_VERSION, 4);
+  appendNumber(header, 0, 4);
+  file_.write(header.data(), static_cast<streamsize>(header.size()));
+  file_.flush();
+  offset_ = header.size();
+}
+
+UpstreamTrafficRecorder::~UpstreamTrafficRecorder() {
+  lock_guard lock(mutex_);
+  string index;
+  for (const uint64_t recordOffset : recordOffsets_) {
+    appendNumber(index, recordOffset, 8);
+  }
+  appendNumber(index, offset_, 8);
+  appendNumber(index, recordOffsets_.size(), 8);
+  index += INDEX_MAGIC;
+  file_.write(index.data(), static_cast<streamsize>(index.size()));
+  file_.close();
+}
+
+void UpstreamTrafficRecorder::record(const string& method, const string& path,
+  const string& requestBody, const UpstreamResponse& response, const chrono::microseconds latency) {
+  const string key = determineKey(method, path, requestBody);
+  const string headers = serializeHeaders(response.headers_);
+  string recordHeader;
+  appendNumber(recordHeader, key.size(), 4);
+  appendNumber(recordHeader, headers.size(), 4);
+  appendNumber(recordHeader, response.body_.size(), 8);
+  appendNumber(recordHeader, static_cast<uint32_t>(response.status_), 4);
+  appendNumber(recordHeader, static_cast<uint64_t>(clamp<chrono::microseconds::rep>(
+    latency.count(), 0, UINT32_MAX)), 4);
+
+  lock_guard lock(mutex_);
+  file_.write(recordHeader.data(), static_cast<streamsize>(recordHeader.size()));
+  file_.write(key.data(), static_cast<streamsize>(key.size()));
+  file_.write(headers.data(), static_cast<streamsize>(headers.size()));
+  file_.write(response.body_.data(), static_cast<streamsize>(response.body_.size()));
+  // Each record is complete on disk, so that a recording survives the server being killed.
+  file_.flush();
+  recordOffsets_.push_back(offset_);
+  offset_ += recordHeader.size() + key.size() + headers.size() + response.body_.size();
+}
+
+UpstreamTrafficReplayer::UpstreamTrafficReplayer(const string& fileName, const Latency latency) :
+  latency_(latency) {
+  ifstream file(fileName, ios::in | ios::binary);
+  if (! file) {
+    throw runtime_error("Cannot open the recording file '" + fileName + "'.");
+  }
+  data_.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+  if (data_.size() < FILE_HEADER_SIZE || string_view(data_).substr(0, FILE_MAGIC.size()) !=
+    FILE_MAGIC || readNumber(data_, FILE_MAGIC.size(), 4) != FORMAT_VERSION) {
+    throw runtime_error("The file '" + fileName + "' is not a recording of upstream traffic.");
+  }
+
+  const bool hasIndex = data_.size() >= FILE_HEADER_SIZE + TRAILER_SIZE &&
+    string_view(data_).substr(data_.size() - INDEX_MAGIC.size()) == INDEX_MAGIC;
+  const uint64_t indexOffset = hasIndex ? readNumber(data_, data_.size() - TRAILER_SIZE, 8) : 0;
+  const uint64_t numberOfRecords = hasIndex ?
+    readNumber(data_, data_.size() - TRAILER_SIZE + 8, 8) : 0;
+  if (hasIndex && indexOffset + numberOfRecords * 8 + TRAILER_SIZE == data_.size()) {
+    for (uint64_t record = 0; record < numberOfRecords; ++record) {
+      indexRecord(readNumber(data_, indexOffset + record * 8, 8), indexOffset);
+    }
+  } else {
+    // The recording has not been completed: read the records up to the first truncated one.
+    spdlog::warn("The recording file '{}' has no index, its records are read sequentially.",
+      fileName);
+    uint64_t offset = FILE_HEADER_SIZE;
+    while (offset < data_.size()) {
+      offset = indexRecord(offset, data_.size());
+      if (offset == 0) {
+        break;
+      }
+    }
+  }
+  spdlog::info("{} upstream exchanges loaded from the recording file '{}'.", exchanges_.size(),
+    fileName);
+}
+
+bool UpstreamTrafficReplayer::replay(const string& method, const string& path,
+  const string& requestBody, UpstreamResponse& response) const {
+  const auto exchangesOfRequest = exchangesByRequest_.find(
+    determineKey(method, path, requestBody));
+  if (exchangesOfRequest == exchangesByRequest_.end()) {
+    return false;
+  }
+  const auto& candidates = exchangesOfRequest->second->exchanges_;
+  const size_t next = exchangesOfRequest->second->nextExchange_.fetch_add(1,
+    memory_order_relaxed);
+  const Exchange& exchange = exchanges_[candidates[next % candidates.size()]];
+
+  const auto delay = latency_.recorded_ ? exchange.latency_ : latency_.fixed_;
+  if (delay.count() > 0) {
+    this_thread::sleep_for(delay);
+  }
+  response.status_ = exchange.status_;
+  response.headers_ = deserializeHeaders(exchange.headers_);
+  response.body_.assign(exchange.body_);
+  return true;
+}
+
+uint64_t UpstreamTrafficReplayer::indexRecord(const uint64_t offset, const uint64_t end) {
+  if (offset < FILE_HEADER_SIZE || offset + RECORD_HEADER_SIZE > end) {
+    return 0;
+  }
+  const uint64_t keySize = readNumber(data_, offset, 4);
+  const uint64_t headersSize = readNumber(data_, offset + 4, 4);
+  const uint64_t bodySize = readNumber(data_, offset + 8, 8);
+  const uint64_t keyOffset = offset + RECORD_HEADER_SIZE;
+  const uint64_t nextOffset = keyOffset + keySize + headersSize + bodySize;
+  if (bodySize > end || nextOffset > end) {
+    return 0;
+  }
+
+  const string_view data(data_);
+  exchanges_.push_back({
+    static_cast<int>(static_cast<int32_t>(readNumber(data_, offset + 16, 4))),
+    chrono::microseconds(readNumber(data_, offset + 20, 4)),
+    data.substr(keyOffset + keySize, headersSize),
+    data.substr(keyOffset + keySize + headersSize, bodySize)
+  });
+  auto& exchangesOfRequest = exchangesByRequest_[data.substr(keyOffset, keySize)];
+  if (! exchangesOfRequest) {
+    exchangesOfRequest = make_unique<ExchangesOfRequest>();
+  }
+  exchangesOfRequest->exchanges_.push_back(exchanges_.size() - 1);
+  return nextOffset;
+}
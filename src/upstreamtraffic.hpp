@@ -0,0 +1,98 @@
+#pragma once
+
+#include <httplib.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// @brief The response of an upstream API as it is recorded and replayed.
+struct UpstreamResponse {
+  int status_ { 0 };
+  httplib::Headers headers_;
+  std::string body_;
+};
+
+/// @brief Writes upstream requests and their responses to a recording file.
+///
+/// The file starts with a header, followed by one record per exchange and, once the recorder is
+/// destroyed, an index of the offsets of all records. A recording whose index is missing, e.g.
+/// because the server has been killed, can still be replayed.
+///
+/// A record holds the method, the path with its query and the body of the request, and the
+/// status, headers, body and latency of the response. The headers of requests, which may hold
+/// credentials, are not recorded.
+class UpstreamTrafficRecorder {
+public:
+  /// @throw std::runtime_error if the file cannot be created.
+  explicit UpstreamTrafficRecorder(const std::string& fileName);
+  ~UpstreamTrafficRecorder();
+
+  void record(const std::string& method, const std::string& path, const std::string& requestBody,
+    const UpstreamResponse& response, const std::chrono::microseconds latency);
+
+  UpstreamTrafficRecorder(const UpstreamTrafficRecorder&) = delete;
+  UpstreamTrafficRecorder& operator=(const UpstreamTrafficRecorder&) = delete;
+
+private:
+  std::mutex mutex_;
+  std::ofstream file_;
+  std::uint64_t offset_ { 0 };
+  std::vector<std::uint64_t> recordOffsets_;
+};
+
+/// @brief Answers upstream requests from a recording file instead of the network.
+///
+/// A request is answered with a recorded response to a request of the same method, path and
+/// body. If such a request has been recorded several times, its responses are replayed in the
+/// recorded order, starting over after the last one.
+class UpstreamTrafficReplayer {
+public:
+  /// @brief How long answering a request takes.
+  struct Latency {
+    /// Sleep for the latency of the recorded response instead of the fixed latency.
+    bool recorded_ { false };
+    std::chrono::microseconds fixed_ { 0 };
+  };
+
+  /// @throw std::runtime_error if the file cannot be read or is not a recording.
+  UpstreamTrafficReplayer(const std::string& fileName, const Latency latency);
+
+  /// @brief Answers a request after the configured latency.
+  /// @return false if no response to the request has been recorded.
+  bool replay(const std::string& method, const std::string& path, const std::string& requestBody,
+    UpstreamResponse& response) const;
+
+  std::size_t numberOfExchanges() const noexcept { return exchanges_.size(); }
+
+private:
+  struct Exchange {
+    int status_;
+    std::chrono::microseconds latency_;
+    std::string_view headers_;
+    std::string_view body_;
+  };
+
+  struct ExchangesOfRequest {
+    std::vector<std::size_t> exchanges_;
+    mutable std::atomic<std::size_t> nextExchange_ { 0 };
+  };
+
+  /// @brief Adds the record at the offset to the exchanges.
+  /// @return the offset of the next record, or 0 if the record does not end before end.
+  std::uint64_t indexRecord(const std::uint64_t offset, const std::uint64_t end);
+
+  const Latency latency_;
+  std::string data_;
+  std::vector<Exchange> exchanges_;
+  /// The keys refer to data_.
+  std::unordered_map<std::string_view, std::unique_ptr<ExchangesOfRequest>> exchangesByRequest_;
+};
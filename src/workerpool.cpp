@@ -0,0 +1,78 @@
+#include "workerpool.hpp"
+#include <spdlog/spdlog.h>
+
+using namespace std;
+
+WorkerPool::WorkerPool(size_t numberOfThreads, const size_t numberOfFastLaneThreads) {
+  if (numberOfThreads == 0) {
+    numberOfThreads = max(1u, thread::hardware_concurrency());
+  }
+  workers_.reserve(numberOfThreads + numberOfFastLaneThreads);
+  for (size_t index = 0; index < numberOfThreads; ++index) {
+    workers_.emplace_back([this]() { processTasks(false); });
+  }
+  for (size_t index = 0; index < numberOfFastLaneThreads; ++index) {
+    workers_.emplace_back([this]() { processTasks(true); });
+  }
+}
+
+bool WorkerPool::submit(Task task, const RequestLane lane) {
+  {
+    lock_guard lock(mutex_);
+    if (shuttingDown_) {
+      return false;
+    }
+    (lane == RequestLane::fast ? fastTasks_ : slowTasks_).push_back(move(task));
+  }
+  if (lane == RequestLane::fast) {
+    fastLaneCondition_.notify_one();
+  }
+  condition_.notify_one();
+  return true;
+}
+
+void WorkerPool::shutdown() noexcept {
+  {
+    lock_guard lock(mutex_);
+    if (shuttingDown_) {
+      return;
+    }
+    shuttingDown_ = true;
+  }
+  condition_.notify_all();
+  fastLaneCondition_.notify_all();
+  for (auto& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  shutdown();
+}
+
+void WorkerPool::processTasks(const bool isFastLaneOnly) {
+  condition_variable& condition = isFastLaneOnly ? fastLaneCondition_ : condition_;
+  while (true) {
+    Task task;
+    {
+      unique_lock lock(mutex_);
+      condition.wait(lock, [this, isFastLaneOnly]() {
+        return shuttingDown_ || ! fastTasks_.empty() || (! isFastLaneOnly && ! slowTasks_.empty());
+      });
+      deque<Task>& tasks = ! fastTasks_.empty() || isFastLaneOnly ? fastTasks_ : slowTasks_;
+      if (tasks.empty()) {
+        return;
+      }
+      task = move(tasks.front());
+      tasks.pop_front();
+    }
+
+    try {
+      task();
+    } catch (const exception& ex) {
+      spdlog::error("Uncaught exception in worker thread: {}", ex.what());
+    }
+  }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "requestlane.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// @brief A fixed-size pool of worker threads that execute submitted tasks.
+///
+/// Transports use the pool to decouple the thread(s) doing I/O from the (possibly slow)
+/// processing of MCP requests. Tasks of the fast lane are taken before those of the slow lane,
+/// and some threads are reserved for the fast lane, so fast tasks do not wait even if all
+/// other threads are busy with slow tasks.
+class WorkerPool {
+public:
+  using Task = std::function<void()>;
+
+  /// @brief An initialization constructor.
+  /// @param numberOfThreads is the number of worker threads to be started. If 0 is given,
+  /// the number of hardware threads is used.
+  /// @param numberOfFastLaneThreads is the number of additional threads that only execute
+  /// tasks of the fast lane.
+  explicit WorkerPool(std::size_t numberOfThreads, std::size_t numberOfFastLaneThreads = 0);
+
+  /// @brief Queues a task for execution by one of the worker threads.
+  /// @param task is the function to be executed.
+  /// @param lane is the lane in which the task is scheduled.
+  /// @return false if the pool has already been shut down, otherwise true.
+  bool submit(Task task, const RequestLane lane = RequestLane::slow);
+
+  /// @brief Stops accepting new tasks, waits until all queued tasks are done, and joins
+  /// all worker threads.
+  void shutdown() noexcept;
+
+  ~WorkerPool();
+
+  WorkerPool() = delete;
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+private:
+  void processTasks(const bool isFastLaneOnly);
+
+  std::vector<std::thread> workers_;
+  std::deque<Task> fastTasks_;
+  std::deque<Task> slowTasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::condition_variable fastLaneCondition_;
+  bool shuttingDown_ { false };
+};
@@ -0,0 +1,245 @@
+#include "../src/httprequestparser.hpp"
+#include "../src/httptoolclient.hpp"
+#include "../src/lineframer.hpp"
+#include "../src/mcpserver.hpp"
+#include "../src/requestarena.hpp"
+#include "../src/tooloutputwriter.hpp"
+#include "../srctest/testdata.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <string>
+
+// Microbenchmarks of the request hot path. Run the target with '--reporter XML::out=<file>'
+// (or the 'benchmark' build target) to obtain the results in a machine-readable form.
+
+namespace {
+  // Measure with the default log level of the server rather than with console output.
+  [[maybe_unused]] const bool logLevelConfigured = [] {
+    spdlog::set_level(spdlog::level::err);
+    return true;
+  }();
+
+  /// @brief Builds a page of SysML v2 elements shaped like the responses of the SysML v2 API.
+  json buildElementPage(const std::size_t numberOfElements) {
+    json page = json::array();
+    for (std::size_t index = 0; index < numberOfElements; ++index) {
+      const std::string id = "5f2b7c1e-8d4a-4e6b-9c3f-" + std::to_string(100000000000 + index);
+      page.push_back({
+        {"@id", id},
+        {"@type", index % 3 == 0 ? "PartUsage" :
+          (index % 3 == 1 ? "PortUsage" : "AttributeUsage")},
+        {"name", "element" + std::to_string(index)},
+        {"declaredName", "element" + std::to_string(index)},
+        {"qualifiedName", "Vehicle::Powertrain::element" + std::to_string(index)},
+        {"isAbstract", false},
+        {"isComposite", index % 2 == 0},
+        {"owner", {{"@id", "5f2b7c1e-8d4a-4e6b-9c3f-000000000000"}}},
+        {"ownedElement", json::array({ {{"@id", id + "-1"}}, {{"@id", id + "-2"}} })},
+        {"documentation", json::array()},
+        {"elementId", id}
+      });
+    }
+    return page;
+  }
+
+  json buildRequest(const int id, const std::string& method, const json& parameters) {
+    return {
+      {"jsonrpc", globals::REQUIRED_JSONRPC_VERSION},
+      {"id", id},
+      {"method", method},
+      {"params", parameters}
+    };
+  }
+
+  /// @brief Exposes the URL parsing of HttpToolClient to the benchmarks.
+  class UrlParsingClient : public HttpToolClient {
+  public:
+    using HttpToolClient::extractBaseUrl;
+    using HttpToolClient::extractPathFromUrl;
+  };
+}
+
+TEST_CASE("Benchmarking MCPServer::handleRequest per method", "[benchmark]") {
+  MCPServer server { SERVER_NAME, SERVER_VERSION };
+  server.handleRequest(initServerRequest);
+  const json listResourcesRequest = buildRequest(7, "resources/list", json::object());
+  const json listPromptsRequest = buildRequest(8, "prompts/list", json::object());
+
+  BENCHMARK("initialize") {
+    return server.handleRequest(initServerRequest);
+  };
+  BENCHMARK("tools/list") {
+    return server.handleRequest(listAvailableToolsRequest);
+  };
+  BENCHMARK("tools/call (echo)") {
+    return server.handleRequest(callEchoToolRequest);
+  };
+  BENCHMARK("resources/list") {
+    return server.handleRequest(listResourcesRequest);
+  };
+  BENCHMARK("prompts/list") {
+    return server.handleRequest(listPromptsRequest);
+  };
+  BENCHMARK("unknown method") {
+    return server.handleRequest(requestWithUnknownMethod);
+  };
+}
+
+TEST_CASE("Benchmarking the generation of serialized responses", "[benchmark]") {
+  MCPServer server { SERVER_NAME, SERVER_VERSION };
+  server.handleRequest(initServerRequest);
+
+  BENCHMARK("tools/list, serialized list cached") {
+    return server.handleRequestSerialized(listAvailableToolsRequest);
+  };
+  BENCHMARK("tools/list, generated and dumped") {
+    return server.handleRequest(listAvailableToolsRequest).dump();
+  };
+}
+
+TEST_CASE("Benchmarking the dispatch of tool calls", "[benchmark]") {
+  MCPServer server { SERVER_NAME, SERVER_VERSION };
+  server.handleRequest(initServerRequest);
+
+  const json page = buildElementPage(100);
+  const json pageResult = {
+    {"content", {{{"type", "text"}, {"text", page.dump()}}}}
+  };
+  ToolAnnotations annotations { true, true, { ToolCachePolicy::Scope::shared,
+    std::chrono::seconds(3600), { "commitId" } } };
+  const json inputSchema = {
+    {"type", "object"},
+    {"properties", {{"commitId", {{"type", "string"}}}}},
+    {"required", {"commitId"}}
+  };
+  server.registerTool("get_page", "Returns a page of elements.", inputSchema,
+    [&pageResult](const json&) { return pageResult; }, annotations);
+  annotations.cachePolicy_.scope_ = ToolCachePolicy::Scope::none;
+  server.registerTool("get_page_uncached", "Returns a page of elements.", inputSchema,
+    [&pageResult](const json&) { return pageResult; }, annotations);
+
+  const json callMemoizedRequest = buildRequest(9, "tools/call",
+    {{"name", "get_page"}, {"arguments", {{"commitId", "c1"}}}});
+  const json callUncachedRequest = buildRequest(10, "tools/call",
+    {{"name", "get_page_uncached"}, {"arguments", {{"commitId", "c1"}}}});
+  const json callInvalidRequest = buildRequest(11, "tools/call",
+    {{"name", "get_page_uncached"}, {"arguments", {{"commitId", 42}}}});
+
+  BENCHMARK("echo, serialized") {
+    return server.handleRequestSerialized(callEchoToolRequest);
+  };
+  BENCHMARK("100 elements, memoized") {
+    return server.handleRequestSerialized(callMemoizedRequest);
+  };
+  BENCHMARK("100 elements, not memoized") {
+    return server.handleRequestSerialized(callUncachedRequest);
+  };
+  BENCHMARK("invalid arguments") {
+    return server.handleRequestSerialized(callInvalidRequest);
+  };
+  BENCHMARK("echo, serialized, within a request arena") {
+    ArenaScope arenaScope;
+    return server.handleRequestSerialized(callEchoToolRequest);
+  };
+}
+
+TEST_CASE("Benchmarking the URL parsing of HttpToolClient", "[benchmark]") {
+  const UrlParsingClient client;
+  const std::string url { "http://sysml2.intercax.com:9000/projects/5f2b7c1e-8d4a-4e6b-9c3f-"
+    "100000000000/commits/8a1c2d3e-4f5a-6b7c-8d9e-0f1a2b3c4d5e/elements?page%5Bsize%5D=100" };
+
+  BENCHMARK("extractBaseUrl") {
+    return client.extractBaseUrl(url);
+  };
+  BENCHMARK("extractPathFromUrl") {
+    return client.extractPathFromUrl(url);
+  };
+}
+
+TEST_CASE("Benchmarking JSON parse and dump of SysML element pages", "[benchmark]") {
+  for (const std::size_t numberOfElements : { 10, 100, 1000 }) {
+    const json page = buildElementPage(numberOfElements);
+    const std::string text = page.dump();
+    const std::string suffix = " (" + std::to_string(numberOfElements) + " elements)";
+
+    BENCHMARK("parse" + suffix) {
+      return json::parse(text);
+    };
+    BENCHMARK("parse within a request arena" + suffix) {
+      ArenaScope arenaScope;
+      return json::parse(text).size();
+    };
+    BENCHMARK("dump" + suffix) {
+      return page.dump();
+    };
+    BENCHMARK("projection of 2 fields on demand" + suffix) {
+      const auto options = ToolOutputOptions::fromArguments({{"fields", {"@id", "name"}}});
+      std::string input = text;
+      std::string output;
+      ToolOutputWriter(options).writeText(input, output);
+      return output;
+    };
+    BENCHMARK("table on demand" + suffix) {
+      const auto options = ToolOutputOptions::fromArguments(
+        {{"format", "table"}, {"fields", {"@id", "@type", "name"}}});
+      std::string input = text;
+      std::string output;
+      ToolOutputWriter(options).writeText(input, output);
+      return output;
+    };
+  }
+}
+
+TEST_CASE("Benchmarking the framing of the transports", "[benchmark]") {
+  const std::string body = callEchoToolRequest.dump();
+  const std::string httpRequest = "POST /mcp HTTP/1.1\r\nHost: 127.0.0.1:8080\r\n"
+    "Content-Type: application/json\r\nAccept: application/json, text/event-stream\r\n"
+    "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+  std::string pipelinedHttpRequests;
+  std::string newlineDelimitedRequests;
+  for (int index = 0; index < 16; ++index) {
+    pipelinedHttpRequests += httpRequest;
+    newlineDelimitedRequests += body + '\n';
+  }
+  const HttpRequestParser parser;
+
+  BENCHMARK("HTTP/1.1, 16 pipelined requests") {
+    std::string buffer = pipelinedHttpRequests;
+    HttpRequest request;
+    std::size_t numberOfRequests { 0 };
+    while (parser.parse(buffer, request) == HttpRequestParser::Status::complete) {
+      ++numberOfRequests;
+    }
+    return numberOfRequests;
+  };
+  BENCHMARK("newline-delimited, 16 requests") {
+    LineFramer framer;
+    framer.append(newlineDelimitedRequests.data(), newlineDelimitedRequests.size());
+    std::size_t numberOfRequests { 0 };
+    framer.extractFrames([&numberOfRequests](std::string_view) { ++numberOfRequests; });
+    return numberOfRequests;
+  };
+  BENCHMARK("newline-delimited, 16 requests received in 256-byte pieces") {
+    LineFramer framer;
+    std::size_t numberOfRequests { 0 };
+    for (std::size_t offset = 0; offset < newlineDelimitedRequests.size(); offset += 256) {
+      framer.append(newlineDelimitedRequests.data() + offset,
+        std::min<std::size_t>(256, newlineDelimitedRequests.size() - offset));
+      framer.extractFrames([&numberOfRequests](std::string_view) { ++numberOfRequests; });
+    }
+    return numberOfRequests;
+  };
+  BENCHMARK("newline-delimited, 16 requests parsed") {
+    LineFramer framer;
+    framer.append(newlineDelimitedRequests.data(), newlineDelimitedRequests.size());
+    std::size_t numberOfRequests { 0 };
+    framer.extractFrames([&numberOfRequests](const std::string_view frame) {
+      numberOfRequests += json::parse(frame).size();
+    });
+    return numberOfRequests;
+  };
+}
@@ -0,0 +1,77 @@
+#include "latencyhistogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+  constexpr uint64_t SUB_BUCKET_COUNT { uint64_t { 1 } << LatencyHistogram::SUB_BUCKET_BITS };
+  /// Values of 2^MAX_EXPONENT microseconds (about 12 days) and more share the last bucket.
+  constexpr unsigned int MAX_EXPONENT { 40 };
+  constexpr size_t BUCKET_COUNT {
+    SUB_BUCKET_COUNT * (1 + MAX_EXPONENT - LatencyHistogram::SUB_BUCKET_BITS) };
+}
+
+LatencyHistogram::LatencyHistogram() : counts_(BUCKET_COUNT, 0) { }
+
+void LatencyHistogram::record(const uint64_t valueInMicroseconds) noexcept {
+  ++counts_[determineBucket(valueInMicroseconds)];
+  ++count_;
+  sum_ += valueInMicroseconds;
+  max_ = std::max(max_, valueInMicroseconds);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) noexcept {
+  for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+    counts_[bucket] += other.counts_[bucket];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  max_ = std::max(max_, other.max_);
+}
+
+double LatencyHistogram::mean() const noexcept {
+  return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_);
+}
+
+uint64_t LatencyHistogram::valueAtPercentile(const double percentile) const noexcept {
+  if (count_ == 0) {
+    return 0;
+  }
+  const double clampedPercentile = clamp(percentile, 0.0, 100.0);
+  const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(
+    ceil(clampedPercentile / 100.0 * static_cast<double>(count_))));
+  uint64_t cumulativeCount { 0 };
+  for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+    cumulativeCount += counts_[bucket];
+    if (cumulativeCount >= rank) {
+      return std::min(highestValueOf(bucket), max_);
+    }
+  }
+  return max_;
+}
+
+size_t LatencyHistogram::determineBucket(const uint64_t value) noexcept {
+  if (value < SUB_BUCKET_COUNT) {
+    return static_cast<size_t>(value);
+  }
+  const unsigned int exponent = static_cast<unsigned int>(bit_width(value)) - 1;
+  if (exponent >= MAX_EXPONENT) {
+    return BUCKET_COUNT - 1;
+  }
+  const uint64_t subBucket = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+  return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + subBucket);
+}
+
+uint64_t LatencyHistogram::highestValueOf(const size_t bucket) noexcept {
+  if (bucket < SUB_BUCKET_COUNT) {
+    return bucket;
+  }
+  const unsigned int exponent = static_cast<unsigned int>(bucket / SUB_BUCKET_COUNT) - 1 +
+    SUB_BUCKET_BITS;
+  const uint64_t subBucket = bucket % SUB_BUCKET_COUNT;
+  const uint64_t width = uint64_t { 1 } << (exponent - SUB_BUCKET_BITS);
+  return ((SUB_BUCKET_COUNT + subBucket) << (exponent - SUB_BUCKET_BITS)) + width - 1;
+}
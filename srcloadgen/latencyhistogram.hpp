@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief A histogram of latencies in microseconds with a bounded relative error, in the manner
+/// of HdrHistogram.
+///
+/// Values below 2^SUB_BUCKET_BITS are counted exactly; above, each power of two is split into
+/// 2^SUB_BUCKET_BITS buckets of equal width, so percentiles are off by less than 1 %. Recording
+/// is not synchronized: each thread records into its own histogram, which are merged afterwards.
+class LatencyHistogram {
+public:
+  LatencyHistogram();
+
+  void record(const std::uint64_t valueInMicroseconds) noexcept;
+  void merge(const LatencyHistogram& other) noexcept;
+
+  std::uint64_t count() const noexcept { return count_; }
+  std::uint64_t max() const noexcept { return max_; }
+  double mean() const noexcept;
+
+  /// @brief Determines the smallest value that the given percentage of all values does not exceed.
+  /// @param percentile is within [0, 100].
+  std::uint64_t valueAtPercentile(const double percentile) const noexcept;
+
+  static constexpr unsigned int SUB_BUCKET_BITS { 7 };
+
+private:
+  static std::size_t determineBucket(const std::uint64_t value) noexcept;
+  static std::uint64_t highestValueOf(const std::size_t bucket) noexcept;
+
+  std::vector<std::uint64_t> counts_;
+  std::uint64_t count_ { 0 };
+  std::uint64_t sum_ { 0 };
+  std::uint64_t max_ { 0 };
+};
@@ -0,0 +1,180 @@
+#include "loadgenerator.hpp"
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace {
+  constexpr array<double, 4> REPORTED_PERCENTILES { 50.0, 90.0, 99.0, 99.9 };
+
+  double toMilliseconds(const uint64_t microseconds) {
+    return static_cast<double>(microseconds) / 1000.0;
+  }
+
+  string formatPercentile(const double percentile) {
+    string name = "p" + to_string(percentile);
+    name.erase(name.find_last_not_of('0') + 1);
+    if (name.back() == '.') {
+      name.pop_back();
+    }
+    return name;
+  }
+}
+
+LoadGenerator::WorkerResult::WorkerResult(const size_t numberOfKinds) :
+  latenciesPerKind_(numberOfKinds), errorsPerKind_(numberOfKinds, 0) { }
+
+LoadGenerator::LoadGenerator(const RequestMix& requestMix, ConnectionFactory connect,
+  const LoadOptions& options) :
+  requestMix_(requestMix), connect_(move(connect)), options_(options) {
+  if (options_.concurrency_ == 0) {
+    throw invalid_argument("The concurrency must be at least 1.");
+  }
+  if (options_.arrivalMode_ == ArrivalMode::open && options_.requestsPerSecond_ <= 0.0) {
+    throw invalid_argument("The rate of requests must be positive in open mode.");
+  }
+}
+
+json LoadGenerator::run() {
+  const json initializeRequest = {
+    {"jsonrpc", "2.0"},
+    {"id", nextId_++},
+    {"method", "initialize"},
+    {"params", {
+      {"protocolVersion", "2025-06-18"},
+      {"capabilities", json::object()},
+      {"clientInfo", {{"name", "SysMLv2MCPLoadGenerator"}, {"version", "0.0.9"}}}
+    }}
+  };
+  const string initializeResponse = connect_()->call(initializeRequest["id"].get<int64_t>(),
+    initializeRequest.dump());
+  if (isErrorResponse(initializeResponse)) {
+    throw runtime_error("The server could not be initialized: " + initializeResponse);
+  }
+
+  vector<WorkerResult> results(options_.concurrency_, WorkerResult(requestMix_.numberOfKinds()));
+  vector<thread> workers;
+  start_ = chrono::steady_clock::now();
+  measurementStart_ = start_ + options_.warmup_;
+  end_ = start_ + options_.duration_;
+  for (size_t worker = 0; worker < options_.concurrency_; ++worker) {
+    workers.emplace_back([this, worker, &results] { runWorker(worker, results[worker]); });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  // Requests that were sent before the end are still measured after it, so the throughput is
+  // based on the time until the last worker has received its last response.
+  const auto measurementEnd = chrono::steady_clock::now();
+
+  WorkerResult total(requestMix_.numberOfKinds());
+  for (const auto& result : results) {
+    total.latencies_.merge(result.latencies_);
+    for (size_t kind = 0; kind < requestMix_.numberOfKinds(); ++kind) {
+      total.latenciesPerKind_[kind].merge(result.latenciesPerKind_[kind]);
+      total.errorsPerKind_[kind] += result.errorsPerKind_[kind];
+    }
+  }
+
+  const double measuredSeconds = chrono::duration<double>(
+    measurementEnd - measurementStart_).count();
+  uint64_t errors { 0 };
+  json kinds = json::object();
+  for (size_t kind = 0; kind < requestMix_.numberOfKinds(); ++kind) {
+    errors += total.errorsPerKind_[kind];
+    kinds[requestMix_.nameOf(kind)] = {
+      {"requests", total.latenciesPerKind_[kind].count()},
+      {"errors", total.errorsPerKind_[kind]},
+      {"latencyMilliseconds", reportLatencies(total.latenciesPerKind_[kind])}
+    };
+  }
+  json report = {
+    {"arrivalMode", options_.arrivalMode_ == ArrivalMode::open ? "open" : "closed"},
+    {"concurrency", options_.concurrency_},
+    {"durationSeconds", measuredSeconds},
+    {"requests", total.latencies_.count()},
+    {"errors", errors},
+    {"throughput", measuredSeconds > 0.0 ?
+      static_cast<double>(total.latencies_.count()) / measuredSeconds : 0.0},
+    {"latencyMilliseconds", reportLatencies(total.latencies_)},
+    {"requestKinds", move(kinds)}
+  };
+  if (options_.arrivalMode_ == ArrivalMode::open) {
+    report["targetThroughput"] = options_.requestsPerSecond_;
+  }
+  return report;
+}
+
+void LoadGenerator::runWorker(const size_t worker, WorkerResult& result) {
+  mt19937_64 randomNumberGenerator { options_.seed_ + worker };
+  shared_ptr<McpConnection> connection;
+  const auto interval = chrono::duration<double>(1.0 / options_.requestsPerSecond_);
+
+  while (true) {
+    chrono::steady_clock::time_point scheduledStart;
+    if (options_.arrivalMode_ == ArrivalMode::open) {
+      const uint64_t requestNumber = nextRequestNumber_.fetch_add(1);
+      scheduledStart = start_ + chrono::duration_cast<chrono::steady_clock::duration>(
+        interval * static_cast<double>(requestNumber));
+      if (scheduledStart >= end_) {
+        break;
+      }
+      this_thread::sleep_until(scheduledStart);
+    } else {
+      scheduledStart = chrono::steady_clock::now();
+      if (scheduledStart >= end_) {
+        break;
+      }
+    }
+
+    const size_t kind = requestMix_.pickKind(randomNumberGenerator);
+    const int64_t id = nextId_++;
+    const string request = requestMix_.buildRequest(kind, id, randomNumberGenerator);
+    bool isError { false };
+    try {
+      if (! connection) {
+        connection = connect_();
+      }
+      isError = isErrorResponse(connection->call(id, request));
+    } catch (const exception&) {
+      isError = true;
+      connection.reset(); // reconnect for the next request
+    }
+
+    if (scheduledStart >= measurementStart_) {
+      const auto latency = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - scheduledStart).count();
+      const uint64_t latencyInMicroseconds = latency > 0 ? static_cast<uint64_t>(latency) : 0;
+      result.latencies_.record(latencyInMicroseconds);
+      result.latenciesPerKind_[kind].record(latencyInMicroseconds);
+      result.errorsPerKind_[kind] += isError ? 1 : 0;
+    }
+  }
+}
+
+bool LoadGenerator::isErrorResponse(const string& response) {
+  const json parsedResponse = json::parse(response, nullptr, false);
+  if (parsedResponse.is_discarded() || ! parsedResponse.is_object() ||
+    parsedResponse.contains("error")) {
+    return true;
+  }
+  const auto result = parsedResponse.find("result");
+  return result == parsedResponse.end() ||
+    (result->is_object() && result->value("isError", false));
+}
+
+json LoadGenerator::reportLatencies(const LatencyHistogram& histogram) {
+  json latencies = {
+    {"mean", histogram.mean() / 1000.0},
+    {"max", toMilliseconds(histogram.max())}
+  };
+  for (const double percentile : REPORTED_PERCENTILES) {
+    latencies[formatPercentile(percentile)] = toMilliseconds(
+      histogram.valueAtPercentile(percentile));
+  }
+  return latencies;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "latencyhistogram.hpp"
+#include "mcpconnection.hpp"
+#include "requestmix.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/// @brief How the requests of a load test arrive at the server.
+enum class ArrivalMode {
+  /// Each worker sends its next request as soon as it has received the previous response.
+  closed,
+  /// Requests are sent at a fixed rate, whether or not the server keeps up.
+  open
+};
+
+struct LoadOptions {
+  ArrivalMode arrivalMode_ { ArrivalMode::closed };
+  /// The number of workers, i.e. the maximum number of requests in flight.
+  std::size_t concurrency_ { 16 };
+  /// The total rate of requests in open mode.
+  double requestsPerSecond_ { 100.0 };
+  std::chrono::seconds duration_ { 30 };
+  /// The initial part of the duration whose requests are sent but not measured.
+  std::chrono::seconds warmup_ { 0 };
+  std::uint64_t seed_ { 42 };
+};
+
+/// @brief Drives a MCP server with a RequestMix and measures the latencies of its responses.
+///
+/// In open mode, the latency of a request is measured from the time at which it was scheduled
+/// to be sent rather than from the time at which a worker became free to send it. Requests that
+/// queue up while the server stalls are therefore recorded with the time they waited, which
+/// avoids the coordinated omission of closed-loop measurements.
+class LoadGenerator {
+public:
+  using ConnectionFactory = std::function<std::shared_ptr<McpConnection>()>;
+
+  /// @param connect creates the connection of a worker, it may return a shared connection.
+  LoadGenerator(const RequestMix& requestMix, ConnectionFactory connect,
+    const LoadOptions& options);
+
+  /// @brief Initializes the server, runs the load test and reports its results.
+  /// @return the report, with latencies in milliseconds. Its throughput is the achieved one,
+  /// measured until the last response has arrived; in open mode the target is reported next
+  /// to it.
+  /// @throw std::runtime_error if the server cannot be initialized.
+  nlohmann::json run();
+
+private:
+  struct WorkerResult {
+    explicit WorkerResult(const std::size_t numberOfKinds);
+
+    LatencyHistogram latencies_;
+    std::vector<LatencyHistogram> latenciesPerKind_;
+    std::vector<std::uint64_t> errorsPerKind_;
+  };
+
+  void runWorker(const std::size_t worker, WorkerResult& result);
+  static bool isErrorResponse(const std::string& response);
+  static nlohmann::json reportLatencies(const LatencyHistogram& histogram);
+
+  const RequestMix& requestMix_;
+  const ConnectionFactory connect_;
+  const LoadOptions options_;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point measurementStart_;
+  std::chrono::steady_clock::time_point end_;
+  /// The number of the next request to schedule in open mode.
+  std::atomic<std::uint64_t> nextRequestNumber_ { 0 };
+  std::atomic<std::int64_t> nextId_ { 1 };
+};
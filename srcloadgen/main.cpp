@@ -0,0 +1,164 @@
+#include "loadgenerator.hpp"
+#include "mcpconnection.hpp"
+#include "requestmix.hpp"
+
+#include <argparse/argparse.hpp>
+
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+// An end-to-end load generator for the MCP server. It sends a mix of MCP requests through the
+// 'http' or 'stdinout' transport and reports the throughput and latency percentiles as JSON.
+// The tool calls refer to the model of the stand-in server (srcstandin), so the model options
+// must equal those the stand-in has been started with.
+
+namespace {
+  const char* const APPLICATION_NAME { "SysMLv2MCPLoadGenerator" };
+  const char* const APPLICATION_VERSION { "0.0.9 BETA" };
+
+  void addArgumentsToParser(argparse::ArgumentParser& parser) {
+    parser.add_argument("-t", "--transport")
+      .help("the MCP transport through which the server is driven, 'http' (which also drives\n"
+            "the 'epoll' transport) or 'stdinout'.")
+      .default_value(std::string("http"));
+
+    parser.add_argument("-s", "--serverurl")
+      .help("the URL of the MCP server if 'http' is chosen as transport.")
+      .default_value(std::string("http://127.0.0.1:8080"));
+
+    parser.add_argument("--command")
+      .help("the shell command that starts the MCP server if 'stdinout' is chosen as transport.")
+      .default_value(std::string(
+        "./SysMLv2MCPServer --transport stdinout --apiurl http://127.0.0.1:9000"));
+
+    parser.add_argument("-c", "--concurrency")
+      .help("the number of workers, i.e. the maximum number of requests in flight.")
+      .default_value(std::size_t { 16 })
+      .scan<'u', std::size_t>();
+
+    parser.add_argument("--arrival")
+      .help("'closed' (each worker sends its next request when it has received a response) or\n"
+            "'open' (requests are sent at the rate given by --rate). Only the latencies of open\n"
+            "mode include the time requests would have waited for a stalled server.")
+      .default_value(std::string("closed"));
+
+    parser.add_argument("-r", "--rate")
+      .help("the total number of requests per second in open mode.")
+      .default_value(100.0)
+      .scan<'g', double>();
+
+    parser.add_argument("-d", "--duration")
+      .help("the duration of the load test in seconds, including the warm-up.")
+      .default_value(30u)
+      .scan<'u', unsigned int>();
+
+    parser.add_argument("--warmup")
+      .help("the number of seconds at the start whose requests are not measured.")
+      .default_value(0u)
+      .scan<'u', unsigned int>();
+
+    parser.add_argument("-m", "--mix")
+      .help("the kinds of requests with their weights, e.g.\n"
+            "'tools/list=1,sysml_get_element=4,sysml_get_elements=2,sysml_execute_query=1'.")
+      .default_value(std::string(
+        "tools/list=1,sysml_get_element=4,sysml_get_elements=2,sysml_execute_query=1"));
+
+    parser.add_argument("-o", "--output")
+      .help("the file the JSON report is written to. It is written to stdout by default.")
+      .default_value(std::string());
+
+    parser.add_argument("--seed")
+      .help("the seed of the model of the stand-in server, which also seeds the request mix.")
+      .default_value(std::uint64_t { 42 })
+      .scan<'u', std::uint64_t>();
+
+    parser.add_argument("--projects")
+      .help("the number of projects of the stand-in server.")
+      .default_value(std::size_t { 1 })
+      .scan<'u', std::size_t>();
+
+    parser.add_argument("--elements")
+      .help("the number of elements of the stand-in server.")
+      .default_value(std::size_t { 1000 })
+      .scan<'u', std::size_t>();
+
+    parser.add_argument("--depth")
+      .help("the depth of the model of the stand-in server.")
+      .default_value(std::size_t { 4 })
+      .scan<'u', std::size_t>();
+
+    parser.add_argument("--fanout")
+      .help("the fan-out of the model of the stand-in server.")
+      .default_value(std::size_t { 8 })
+      .scan<'u', std::size_t>();
+
+    parser.add_argument("--commits")
+      .help("the number of commits of the stand-in server.")
+      .default_value(std::size_t { 10 })
+      .scan<'u', std::size_t>();
+  }
+}
+
+int main(int argc, const char** argv) {
+  argparse::ArgumentParser parser(APPLICATION_NAME, APPLICATION_VERSION);
+  addArgumentsToParser(parser);
+  parser.parse_args(argc, argv);
+
+  SyntheticModelOptions modelOptions;
+  modelOptions.numberOfProjects_ = parser.get<std::size_t>("projects");
+  modelOptions.numberOfElements_ = parser.get<std::size_t>("elements");
+  modelOptions.depth_ = parser.get<std::size_t>("depth");
+  modelOptions.fanOut_ = parser.get<std::size_t>("fanout");
+  modelOptions.numberOfCommits_ = parser.get<std::size_t>("commits");
+  modelOptions.seed_ = parser.get<std::uint64_t>("seed");
+
+  LoadOptions loadOptions;
+  loadOptions.arrivalMode_ = parser.get("arrival") == "open" ? ArrivalMode::open :
+    ArrivalMode::closed;
+  loadOptions.concurrency_ = parser.get<std::size_t>("concurrency");
+  loadOptions.requestsPerSecond_ = parser.get<double>("rate");
+  loadOptions.duration_ = std::chrono::seconds(parser.get<unsigned int>("duration"));
+  loadOptions.warmup_ = std::chrono::seconds(parser.get<unsigned int>("warmup"));
+  loadOptions.seed_ = modelOptions.seed_;
+
+  nlohmann::json report;
+  try {
+    const SyntheticModel model(modelOptions);
+    const RequestMix requestMix(parser.get("mix"), model);
+
+    const std::string transport = parser.get("transport");
+    LoadGenerator::ConnectionFactory connect;
+    if (transport == "stdinout") {
+#ifdef __linux__
+      // A server process that exits early must not terminate the load generator.
+      std::signal(SIGPIPE, SIG_IGN);
+      auto connection = std::make_shared<StdioMcpConnection>(parser.get("command"));
+      connect = [connection] { return connection; };
+#else
+      std::cerr << "FATAL ERROR - The 'stdinout' transport is only supported on Linux."
+        << std::endl;
+      return EXIT_FAILURE;
+#endif
+    } else {
+      const std::string serverUrl = parser.get("serverurl");
+      connect = [serverUrl] { return std::make_shared<HttpMcpConnection>(serverUrl); };
+    }
+
+    LoadGenerator loadGenerator(requestMix, std::move(connect), loadOptions);
+    report = loadGenerator.run();
+    report["transport"] = transport;
+  } catch (const std::exception& ex) {
+    std::cerr << "FATAL ERROR - " << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const std::string outputFileName = parser.get("output");
+  if (outputFileName.empty()) {
+    std::cout << report.dump(2) << std::endl;
+  } else {
+    std::ofstream(outputFileName) << report.dump(2) << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
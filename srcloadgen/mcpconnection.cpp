@@ -0,0 +1,147 @@
+#include "mcpconnection.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+HttpMcpConnection::HttpMcpConnection(const string& serverUrl) : client_(serverUrl) {
+  client_.set_keep_alive(true);
+}
+
+string HttpMcpConnection::call([[maybe_unused]] const int64_t id, const string& request) {
+  static const httplib::Headers headers {
+    { "Accept", "application/json, text/event-stream" }
+  };
+  const auto result = client_.Post("/mcp", headers, request, "application/json");
+  if (! result) {
+    throw runtime_error("HTTP request failed: " + httplib::to_string(result.error()));
+  }
+  return result->body;
+}
+
+#ifdef __linux__
+StdioMcpConnection::StdioMcpConnection(const string& command) {
+  int requestPipe[2];
+  int responsePipe[2];
+  if (::pipe2(requestPipe, O_CLOEXEC) != 0) {
+    throw runtime_error("Cannot create a pipe to the server process.");
+  }
+  if (::pipe2(responsePipe, O_CLOEXEC) != 0) {
+    ::close(requestPipe[0]);
+    ::close(requestPipe[1]);
+    throw runtime_error("Cannot create a pipe from the server process.");
+  }
+
+  childProcessId_ = ::fork();
+  if (childProcessId_ == 0) {
+    // dup2 clears O_CLOEXEC on the duplicates, all other descriptors are closed by exec.
+    ::dup2(requestPipe[0], STDIN_FILENO);
+    ::dup2(responsePipe[1], STDOUT_FILENO);
+    ::execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+    ::_exit(127);
+  }
+  ::close(requestPipe[0]);
+  ::close(responsePipe[1]);
+  if (childProcessId_ < 0) {
+    ::close(requestPipe[1]);
+    ::close(responsePipe[0]);
+    throw runtime_error("Cannot start the server process '" + command + "'.");
+  }
+  requestPipe_ = requestPipe[1];
+  responsePipe_ = responsePipe[0];
+  readerThread_ = thread([this] { readResponses(); });
+}
+
+StdioMcpConnection::~StdioMcpConnection() {
+  // The server shuts down once its stdin is closed, which closes its stdout in turn.
+  ::close(requestPipe_);
+  if (readerThread_.joinable()) {
+    readerThread_.join();
+  }
+  ::close(responsePipe_);
+  ::waitpid(childProcessId_, nullptr, 0);
+}
+
+string StdioMcpConnection::call(const int64_t id, const string& request) {
+  future<string> response;
+  {
+    lock_guard lock(pendingCallsMutex_);
+    if (isClosed_) {
+      throw runtime_error("The server process has closed its stdout.");
+    }
+    response = pendingCalls_[id].get_future();
+  }
+
+  string line = request + '\n';
+  {
+    lock_guard lock(writeMutex_);
+    size_t written { 0 };
+    while (written < line.size()) {
+      const ssize_t result = ::write(requestPipe_, line.data() + written, line.size() - written);
+      if (result < 0 && errno == EINTR) {
+        continue;
+      }
+      if (result <= 0) {
+        lock_guard pendingCallsLock(pendingCallsMutex_);
+        pendingCalls_.erase(id);
+        throw runtime_error("Cannot write to the stdin of the server process.");
+      }
+      written += static_cast<size_t>(result);
+    }
+  }
+  return response.get();
+}
+
+void StdioMcpConnection::readResponses() {
+  string buffer;
+  char chunk[65536];
+  while (true) {
+    const ssize_t result = ::read(responsePipe_, chunk, sizeof(chunk));
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      break;
+    }
+    buffer.append(chunk, static_cast<size_t>(result));
+
+    size_t lineStart { 0 };
+    for (size_t lineEnd = buffer.find('\n'); lineEnd != string::npos;
+      lineEnd = buffer.find('\n', lineStart)) {
+      string line = buffer.substr(lineStart, lineEnd - lineStart);
+      lineStart = lineEnd + 1;
+      const auto response = nlohmann::json::parse(line, nullptr, false);
+      if (response.is_discarded() || ! response.contains("id") ||
+        ! response["id"].is_number_integer()) {
+        continue; // e.g. a parse error of the server, which cannot be assigned to a request
+      }
+      lock_guard lock(pendingCallsMutex_);
+      const auto call = pendingCalls_.find(response["id"].get<int64_t>());
+      if (call != pendingCalls_.end()) {
+        call->second.set_value(move(line));
+        pendingCalls_.erase(call);
+      }
+    }
+    buffer.erase(0, lineStart);
+  }
+  failPendingCalls("The server process has closed its stdout.");
+}
+
+void StdioMcpConnection::failPendingCalls(const string& reason) {
+  lock_guard lock(pendingCallsMutex_);
+  isClosed_ = true;
+  for (auto& [id, call] : pendingCalls_) {
+    call.set_exception(make_exception_ptr(runtime_error(reason)));
+  }
+  pendingCalls_.clear();
+}
+#endif
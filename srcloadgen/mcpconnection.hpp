@@ -0,0 +1,75 @@
+#pragma once
+
+// IMPORTANT: httplib.h must be included BEFORE Windows.h!
+#include <httplib.h>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/// @brief A connection to a MCP server over which JSON-RPC requests are sent.
+class McpConnection {
+public:
+  virtual ~McpConnection() = default;
+
+  /// @brief Sends a request and waits for its response.
+  /// @param id is the JSON-RPC id of the request.
+  /// @param request is the serialized request.
+  /// @return the serialized response.
+  /// @throw std::runtime_error if the request cannot be sent or no response is received.
+  virtual std::string call(const std::int64_t id, const std::string& request) = 0;
+};
+
+/// @brief Sends requests to the '/mcp' endpoint of a server that uses the 'http' or 'epoll'
+/// transport, one request at a time over a persistent connection.
+class HttpMcpConnection final : public McpConnection {
+public:
+  /// @param serverUrl is e.g. 'http://127.0.0.1:8080'.
+  explicit HttpMcpConnection(const std::string& serverUrl);
+
+  std::string call(const std::int64_t id, const std::string& request) override;
+
+private:
+  httplib::Client client_;
+};
+
+#ifdef __linux__
+/// @brief Starts a server that uses the 'stdinout' transport as a child process and exchanges
+/// newline-delimited requests and responses through its stdin and stdout.
+///
+/// The connection is shared by all threads: the server processes requests concurrently and
+/// answers them in any order, so the responses are assigned to their requests by id.
+class StdioMcpConnection final : public McpConnection {
+public:
+  /// @param command is the shell command that starts the server, e.g.
+  /// 'SysMLv2MCPServer --transport stdinout'.
+  /// @throw std::runtime_error if the process cannot be started.
+  explicit StdioMcpConnection(const std::string& command);
+  ~StdioMcpConnection() override;
+
+  std::string call(const std::int64_t id, const std::string& request) override;
+
+  StdioMcpConnection(const StdioMcpConnection&) = delete;
+  StdioMcpConnection& operator=(const StdioMcpConnection&) = delete;
+
+private:
+  void readResponses();
+  void failPendingCalls(const std::string& reason);
+
+  int childProcessId_ { -1 };
+  int requestPipe_ { -1 };
+  int responsePipe_ { -1 };
+  std::thread readerThread_;
+  std::mutex writeMutex_;
+  std::mutex pendingCallsMutex_;
+  std::map<std::int64_t, std::promise<std::string>> pendingCalls_;
+  bool isClosed_ { false };
+};
+#endif
@@ -0,0 +1,118 @@
+#include "requestmix.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <stdexcept>
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace {
+  const char* const LIST_TOOLS_KIND { "tools/list" };
+
+  size_t drawIndex(const size_t count, mt19937_64& randomNumberGenerator) {
+    return uniform_int_distribution<size_t>(0, count - 1)(randomNumberGenerator);
+  }
+}
+
+RequestMix::RequestMix(const string& specification, const SyntheticModel& model) : model_(model) {
+  string_view remainder = specification;
+  while (! remainder.empty()) {
+    const auto comma = remainder.find(',');
+    const string_view entry = remainder.substr(0, comma);
+    remainder = comma == string_view::npos ? string_view() : remainder.substr(comma + 1);
+
+    const auto equalsSign = entry.find('=');
+    Kind kind { string(entry.substr(0, equalsSign)), 1 };
+    if (equalsSign != string_view::npos) {
+      const string_view weight = entry.substr(equalsSign + 1);
+      const auto [end, ec] = from_chars(weight.data(), weight.data() + weight.size(),
+        kind.weight_);
+      if (ec != errc() || end != weight.data() + weight.size()) {
+        throw invalid_argument("Invalid weight in the request mix: '" + string(entry) + "'");
+      }
+    }
+    if (ranges::find(supportedKinds(), kind.name_) == supportedKinds().end()) {
+      throw invalid_argument("Unknown kind of request in the request mix: '" + kind.name_ + "'");
+    }
+    if (kind.weight_ > 0) {
+      cumulativeWeights_.push_back(kind.weight_ +
+        (cumulativeWeights_.empty() ? 0 : cumulativeWeights_.back()));
+      kinds_.push_back(move(kind));
+    }
+  }
+  if (kinds_.empty()) {
+    throw invalid_argument("The request mix is empty.");
+  }
+}
+
+size_t RequestMix::pickKind(mt19937_64& randomNumberGenerator) const {
+  const unsigned int draw = uniform_int_distribution<unsigned int>(0,
+    cumulativeWeights_.back() - 1)(randomNumberGenerator);
+  return static_cast<size_t>(ranges::upper_bound(cumulativeWeights_, draw) -
+    cumulativeWeights_.begin());
+}
+
+string RequestMix::buildRequest(const size_t kind, const int64_t id,
+  mt19937_64& randomNumberGenerator) const {
+  json request = {
+    {"jsonrpc", "2.0"},
+    {"id", id}
+  };
+  const string& name = kinds_[kind].name_;
+  if (name == LIST_TOOLS_KIND) {
+    request["method"] = LIST_TOOLS_KIND;
+    request["params"] = json::object();
+  } else {
+    request["method"] = "tools/call";
+    request["params"] = {
+      {"name", name},
+      {"arguments", buildToolArguments(name, randomNumberGenerator)}
+    };
+  }
+  return request.dump();
+}
+
+const vector<string>& RequestMix::supportedKinds() {
+  static const vector<string> kinds {
+    LIST_TOOLS_KIND, "sysml_list_projects", "sysml_get_project", "sysml_get_elements",
+    "sysml_get_element", "sysml_get_root_elements", "sysml_get_branches", "sysml_get_commits",
+    "sysml_execute_query", "sysml_diff_commits"
+  };
+  return kinds;
+}
+
+json RequestMix::buildToolArguments(const string& toolName,
+  mt19937_64& randomNumberGenerator) const {
+  static const array<const char*, 3> QUERIED_TYPES { "PartDefinition", "PartUsage", "PortUsage" };
+  const SyntheticModelOptions& options = model_.options();
+  const size_t project = drawIndex(options.numberOfProjects_, randomNumberGenerator);
+  const size_t commit = drawIndex(options.numberOfCommits_, randomNumberGenerator);
+
+  json arguments = {{"projectId", model_.projectId(project)}};
+  if (toolName == "sysml_list_projects") {
+    return json::object();
+  } else if (toolName == "sysml_get_elements" || toolName == "sysml_get_root_elements") {
+    arguments["commitId"] = model_.commitId(project, commit);
+  } else if (toolName == "sysml_get_element") {
+    arguments["commitId"] = model_.commitId(project, commit);
+    arguments["elementId"] = model_.elementId(project,
+      drawIndex(max<size_t>(model_.numberOfElements(), 1), randomNumberGenerator));
+  } else if (toolName == "sysml_execute_query") {
+    arguments["commitId"] = model_.commitId(project, commit);
+    arguments["query"] = {
+      {"@type", "Query"},
+      {"where", {
+        {"@type", "PrimitiveConstraint"},
+        {"property", "@type"},
+        {"operator", "="},
+        {"value", QUERIED_TYPES[drawIndex(QUERIED_TYPES.size(), randomNumberGenerator)]}
+      }}
+    };
+  } else if (toolName == "sysml_diff_commits") {
+    arguments["baseCommitId"] = model_.commitId(project, 0);
+    arguments["compareCommitId"] = model_.commitId(project, commit);
+  }
+  return arguments;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../srcstandin/syntheticmodel.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/// @brief The weighted kinds of MCP requests that a load test sends.
+///
+/// The kinds are 'tools/list' and the SysML v2 tools, e.g. 'sysml_get_element'. The arguments
+/// of the tool calls are drawn at random from the identifiers of a SyntheticModel, so a load
+/// test against the stand-in server (srcstandin) must use the same model options.
+class RequestMix {
+public:
+  /// @param specification lists the kinds with their weights, e.g.
+  /// 'tools/list=1,sysml_get_element=4,sysml_execute_query=1'. The weight defaults to 1.
+  /// @throw std::invalid_argument if a kind is unknown or a weight is invalid.
+  RequestMix(const std::string& specification, const SyntheticModel& model);
+
+  std::size_t numberOfKinds() const noexcept { return kinds_.size(); }
+  const std::string& nameOf(const std::size_t kind) const { return kinds_[kind].name_; }
+
+  /// @brief Draws the kind of the next request according to the weights.
+  std::size_t pickKind(std::mt19937_64& randomNumberGenerator) const;
+
+  /// @brief Builds a serialized JSON-RPC request of the given kind.
+  std::string buildRequest(const std::size_t kind, const std::int64_t id,
+    std::mt19937_64& randomNumberGenerator) const;
+
+  static const std::vector<std::string>& supportedKinds();
+
+private:
+  struct Kind {
+    std::string name_;
+    unsigned int weight_;
+  };
+
+  nlohmann::json buildToolArguments(const std::string& toolName,
+    std::mt19937_64& randomNumberGenerator) const;
+
+  const SyntheticModel& model_;
+  std::vector<Kind> kinds_;
+  std::vector<unsigned int> cumulativeWeights_;
+};
@@ -0,0 +1,125 @@
+#include "standinserver.hpp"
+#include "syntheticmodel.hpp"
+
+#include <argparse/argparse.hpp>
+
+#include <cstdlib>
+#include <iostream>
+
+// A local stand-in for a SysML v2 API server, which serves a generated model, so that the MCP
+// server can be measured reproducibly without a real SysML v2 repository. Start the MCP server
+// with '--apiurl http://127.0.0.1:9000' to use it.
+
+namespace {
+  const char* const APPLICATION_NAME { "SysMLv2APIStandIn" };
+  const char* const APPLICATION_VERSION { "0.0.9 BETA" };
+
+  void addArgumentsToParser(argparse::ArgumentParser& parser) {
+    parser.add_argument("--host")
+      .help("the address at which the stand-in server is accessible.")
+      .default_value(std::string("127.0.0.1"));
+
+    parser.add_argument("-p", "--port")
+      .help("the port at which the stand-in server is accessible.")
+      .default_value(9000u)
+      .scan<'u', unsigned int>();
+
+    parser.add_argument("--projects")
+      .help("the number of generated projects.")
+      .default_value(std::size_t { 1 })
+      .scan<'u', std::size_t>();
+
+    parser.add_argument("--elements")
+      .help("the number of elements of each commit, e.g. '100000'. The number is lower if the\n"
+            "containment tree of the given depth and fan-out cannot hold all elements.")
+      .default_value(std::size_t { 1000 })
+      .scan<'u', std::size_t>();
+
+    parser.add_argument("--depth")
+      .help("the maximum nesting depth of the containment tree.")
+      .default_value(std::size_t { 4 })
+      .scan<'u', std::size_t>();
+
+    parser.add_argument("--fanout")
+      .help("the number of root elements, and of the owned elements of each element.")
+      .default_value(std::size_t { 8 })
+      .scan<'u', std::size_t>();
+
+    parser.add_argument("--commits")
+      .help("the length of the commit history of each project.")
+      .default_value(std::size_t { 10 })
+      .scan<'u', std::size_t>();
+
+    parser.add_argument("--changerate")
+      .help("the percentage of the elements that each commit modifies.")
+      .default_value(5u)
+      .scan<'u', unsigned int>();
+
+    parser.add_argument("--seed")
+      .help("the seed of the generated model. Equal seeds yield equal models and identifiers.")
+      .default_value(std::uint64_t { 42 })
+      .scan<'u', std::uint64_t>();
+
+    parser.add_argument("--latency")
+      .help("the delay in milliseconds that is added to every response.")
+      .default_value(0u)
+      .scan<'u', unsigned int>();
+
+    parser.add_argument("--jitter")
+      .help("the upper bound in milliseconds of a uniformly distributed random delay that is\n"
+            "added to the latency of every response.")
+      .default_value(0u)
+      .scan<'u', unsigned int>();
+
+    parser.add_argument("--threads")
+      .help("the number of requests that are served concurrently.")
+      .default_value(std::size_t { 8 })
+      .scan<'u', std::size_t>();
+
+    parser.add_argument("--pagesize")
+      .help("the page size of lists if a request has no 'page[size]' parameter.")
+      .default_value(std::size_t { 100 })
+      .scan<'u', std::size_t>();
+  }
+}
+
+int main(int argc, const char** argv) {
+  argparse::ArgumentParser parser(APPLICATION_NAME, APPLICATION_VERSION);
+  addArgumentsToParser(parser);
+  parser.parse_args(argc, argv);
+
+  SyntheticModelOptions modelOptions;
+  modelOptions.numberOfProjects_ = parser.get<std::size_t>("projects");
+  modelOptions.numberOfElements_ = parser.get<std::size_t>("elements");
+  modelOptions.depth_ = parser.get<std::size_t>("depth");
+  modelOptions.fanOut_ = parser.get<std::size_t>("fanout");
+  modelOptions.numberOfCommits_ = parser.get<std::size_t>("commits");
+  modelOptions.changeRate_ = parser.get<unsigned int>("changerate");
+  modelOptions.seed_ = parser.get<std::uint64_t>("seed");
+
+  StandInOptions serverOptions;
+  serverOptions.latency_ = std::chrono::milliseconds(parser.get<unsigned int>("latency"));
+  serverOptions.jitter_ = std::chrono::milliseconds(parser.get<unsigned int>("jitter"));
+  serverOptions.numberOfThreads_ = parser.get<std::size_t>("threads");
+  serverOptions.defaultPageSize_ = parser.get<std::size_t>("pagesize");
+
+  const SyntheticModel model(modelOptions);
+  const std::string hostAddress = parser.get("host");
+  const auto port = static_cast<std::uint16_t>(parser.get<unsigned int>("port"));
+  std::cout << "Serving " << model.options().numberOfProjects_ << " project(s) with "
+    << model.numberOfElements() << " elements and " << model.options().numberOfCommits_
+    << " commits at http://" << hostAddress << ":" << port << "." << std::endl;
+  for (std::size_t project = 0; project < model.options().numberOfProjects_; ++project) {
+    std::cout << "  project " << model.projectId(project) << ", head commit "
+      << model.commitId(project, model.options().numberOfCommits_ - 1) << std::endl;
+  }
+
+  StandInServer server(model, serverOptions);
+  try {
+    server.listen(hostAddress, port);
+  } catch (const std::runtime_error& ex) {
+    std::cerr << "FATAL ERROR - " << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
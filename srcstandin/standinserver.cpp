@@ -0,0 +1,385 @@
+#include "standinserver.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace {
+  const char* const JSON_MIME_TYPE { "application/json" };
+  const char* const PAGE_AFTER_PARAMETER { "page[after]" };
+  const char* const PAGE_SIZE_PARAMETER { "page[size]" };
+
+  /// @return the value of a numeric request parameter, or defaultValue if it is absent.
+  /// @throw std::invalid_argument if the value is not a number.
+  size_t retrieveNumericParameter(const httplib::Request& request, const string& name,
+    const size_t defaultValue) {
+    if (! request.has_param(name)) {
+      return defaultValue;
+    }
+    const string value = request.get_param_value(name);
+    size_t number { 0 };
+    const auto [end, ec] = from_chars(value.data(), value.data() + value.size(), number);
+    if (ec != errc() || end != value.data() + value.size()) {
+      throw invalid_argument("The parameter '" + name + "' must be a non-negative integer.");
+    }
+    return number;
+  }
+
+  /// @return the text percent-encoded for a query component, with all but the unreserved
+  /// characters of RFC 3986 escaped.
+  string encodeQueryComponent(const string& text) {
+    static const char* const HEX_DIGITS { "0123456789ABCDEF" };
+    string encoded;
+    encoded.reserve(text.size());
+    for (const unsigned char character : text) {
+      if (isalnum(character) || character == '-' || character == '.' || character == '_' ||
+          character == '~') {
+        encoded += static_cast<char>(character);
+      } else {
+        encoded += '%';
+        encoded += HEX_DIGITS[character >> 4];
+        encoded += HEX_DIGITS[character & 0x0F];
+      }
+    }
+    return encoded;
+  }
+
+  json findById(const json& objects, const string& id) {
+    for (const auto& object : objects) {
+      if (object.value("@id", "") == id) {
+        return object;
+      }
+    }
+    return nullptr;
+  }
+}
+
+StandInServer::StandInServer(const SyntheticModel& model, const StandInOptions& options) :
+  model_(model), options_(options) {
+  const size_t numberOfThreads = max<size_t>(options_.numberOfThreads_, 1);
+  server_.new_task_queue = [numberOfThreads] { return new httplib::ThreadPool(numberOfThreads); };
+  server_.set_pre_routing_handler([this](const httplib::Request&, httplib::Response&) {
+    injectLatency();
+    return httplib::Server::HandlerResponse::Unhandled;
+  });
+  createEndpoints();
+}
+
+void StandInServer::listen(const string& hostAddress, const uint16_t port) {
+  if (! server_.listen(hostAddress, port)) {
+    throw runtime_error("The stand-in server cannot listen at " + hostAddress + ":" +
+      to_string(port) + ".");
+  }
+}
+
+void StandInServer::stop() {
+  server_.stop();
+}
+
+void StandInServer::createEndpoints() {
+  server_.Get("/projects", [this](const httplib::Request& request, httplib::Response& response) {
+    respondWithPage(request, response, model_.options().numberOfProjects_,
+      [this](const size_t project) { return model_.renderProject(project); });
+  });
+
+  server_.Get("/projects/:projectId",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    if (resolveProject(request, response, project)) {
+      respondWithJson(response, model_.renderProject(project));
+    }
+  });
+
+  server_.Get("/projects/:projectId/commits",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    if (resolveProject(request, response, project)) {
+      respondWithPage(request, response, model_.options().numberOfCommits_,
+        [this, project](const size_t commit) { return model_.renderCommit(project, commit); });
+    }
+  });
+
+  server_.Get("/projects/:projectId/commits/:commitId",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    size_t commit { 0 };
+    if (resolveCommit(request, response, project, commit)) {
+      respondWithJson(response, model_.renderCommit(project, commit));
+    }
+  });
+
+  server_.Get("/projects/:projectId/commits/:commitId/elements",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    size_t commit { 0 };
+    if (resolveCommit(request, response, project, commit)) {
+      respondWithPage(request, response, model_.numberOfElements(),
+        [this, project, commit](const size_t element) {
+        return model_.renderElement(project, commit, element);
+      });
+    }
+  });
+
+  server_.Get("/projects/:projectId/commits/:commitId/elements/:elementId",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    size_t commit { 0 };
+    size_t element { 0 };
+    if (resolveCommit(request, response, project, commit) &&
+      resolveElement(request, response, project, element)) {
+      respondWithJson(response, model_.renderElement(project, commit, element));
+    }
+  });
+
+  server_.Get("/projects/:projectId/commits/:commitId/elements/:elementId/relationships",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    size_t commit { 0 };
+    size_t element { 0 };
+    if (resolveCommit(request, response, project, commit) &&
+      resolveElement(request, response, project, element)) {
+      const string direction = request.has_param("direction") ?
+        request.get_param_value("direction") : "both";
+      respondWithJson(response, model_.renderRelationships(project, element, direction));
+    }
+  });
+
+  server_.Get("/projects/:projectId/commits/:commitId/roots",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    size_t commit { 0 };
+    if (resolveCommit(request, response, project, commit)) {
+      // The roots are the first elements of the model.
+      respondWithPage(request, response, model_.numberOfRoots(),
+        [this, project, commit](const size_t element) {
+        return model_.renderElement(project, commit, element);
+      });
+    }
+  });
+
+  // The generated commits only update elements, so the parameter 'changeTypes' is ignored.
+  server_.Get("/projects/:projectId/commits/:commitId/changes",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    size_t commit { 0 };
+    if (! resolveCommit(request, response, project, commit)) {
+      return;
+    }
+    if (commit == 0) {
+      respondWithPage(request, response, model_.numberOfElements(),
+        [this, project](const size_t element) {
+        return model_.renderDataVersion(project, 0, element);
+      });
+      return;
+    }
+    const auto changedElements = model_.determineChangedElements(commit - 1, commit);
+    respondWithPage(request, response, changedElements.size(),
+      [this, project, commit, &changedElements](const size_t position) {
+      return model_.renderDataVersion(project, commit, changedElements[position]);
+    });
+  });
+
+  server_.Get("/projects/:projectId/commits/:commitId/diff",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    size_t compareCommit { 0 };
+    if (! resolveCommit(request, response, project, compareCommit)) {
+      return;
+    }
+    const auto baseCommit = model_.findCommit(project, request.get_param_value("baseCommit"));
+    if (! baseCommit) {
+      respondWithError(response, 404, "The base commit does not exist.");
+      return;
+    }
+    const auto changedElements = model_.determineChangedElements(*baseCommit, compareCommit);
+    respondWithPage(request, response, changedElements.size(),
+      [this, project, compareCommit, &changedElements](const size_t position) {
+      return model_.renderDataVersion(project, compareCommit, changedElements[position]);
+    });
+  });
+
+  server_.Get("/projects/:projectId/branches",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    if (resolveProject(request, response, project)) {
+      respondWithJson(response, model_.renderBranches(project));
+    }
+  });
+
+  server_.Get("/projects/:projectId/branches/:branchId",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    if (resolveProject(request, response, project)) {
+      const json branch = findById(model_.renderBranches(project),
+        request.path_params.at("branchId"));
+      if (branch.is_null()) {
+        respondWithError(response, 404, "The branch does not exist.");
+      } else {
+        respondWithJson(response, branch);
+      }
+    }
+  });
+
+  server_.Get("/projects/:projectId/tags",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    if (resolveProject(request, response, project)) {
+      respondWithJson(response, model_.renderTags(project));
+    }
+  });
+
+  server_.Get("/projects/:projectId/tags/:tagId",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    if (resolveProject(request, response, project)) {
+      const json tag = findById(model_.renderTags(project), request.path_params.at("tagId"));
+      if (tag.is_null()) {
+        respondWithError(response, 404, "The tag does not exist.");
+      } else {
+        respondWithJson(response, tag);
+      }
+    }
+  });
+
+  server_.Post("/projects/:projectId/query-results",
+    [this](const httplib::Request& request, httplib::Response& response) {
+    size_t project { 0 };
+    if (! resolveProject(request, response, project)) {
+      return;
+    }
+    size_t commit = model_.options().numberOfCommits_ - 1;
+    if (request.has_param("commitId")) {
+      const auto requestedCommit = model_.findCommit(project, request.get_param_value("commitId"));
+      if (! requestedCommit) {
+        respondWithError(response, 404, "The commit does not exist.");
+        return;
+      }
+      commit = *requestedCommit;
+    }
+    const json query = json::parse(request.body, nullptr, false);
+    if (query.is_discarded() || ! query.is_object()) {
+      respondWithError(response, 400, "The query is not a JSON object.");
+      return;
+    }
+    vector<size_t> result;
+    try {
+      result = model_.evaluateQuery(commit, query);
+    } catch (const json::exception&) {
+      respondWithError(response, 400, "The query is invalid.");
+      return;
+    }
+    respondWithPage(request, response, result.size(),
+      [this, project, commit, &result](const size_t position) {
+      return model_.renderElement(project, commit, result[position]);
+    });
+  });
+}
+
+void StandInServer::injectLatency() const {
+  auto delay = options_.latency_;
+  if (options_.jitter_.count() > 0) {
+    thread_local mt19937_64 randomNumberGenerator { random_device {}() };
+    uniform_int_distribution<chrono::milliseconds::rep> distribution(0, options_.jitter_.count());
+    delay += chrono::milliseconds(distribution(randomNumberGenerator));
+  }
+  if (delay.count() > 0) {
+    this_thread::sleep_for(delay);
+  }
+}
+
+void StandInServer::respondWithPage(const httplib::Request& request, httplib::Response& response,
+  const size_t numberOfItems, const ItemRenderer& renderItem) const {
+  size_t first { 0 };
+  size_t pageSize { 0 };
+  try {
+    // The cursor of a page is the position of its last item, which is opaque to clients.
+    if (request.has_param(PAGE_AFTER_PARAMETER)) {
+      const size_t after = retrieveNumericParameter(request, PAGE_AFTER_PARAMETER, 0);
+      if (after == numeric_limits<size_t>::max()) {
+        throw invalid_argument("The parameter '" + string(PAGE_AFTER_PARAMETER) +
+          "' is out of range.");
+      }
+      first = after + 1;
+    }
+    pageSize = retrieveNumericParameter(request, PAGE_SIZE_PARAMETER, options_.defaultPageSize_);
+  } catch (const invalid_argument& ex) {
+    respondWithError(response, 400, ex.what());
+    return;
+  }
+  pageSize = clamp<size_t>(pageSize, 1, options_.maxPageSize_);
+  first = min(first, numberOfItems);
+  const size_t last = min(numberOfItems, first + pageSize);
+
+  json page = json::array();
+  for (size_t position = first; position < last; ++position) {
+    page.push_back(renderItem(position));
+  }
+
+  if (last < numberOfItems) {
+    // The parameters have been decoded by httplib, so they are encoded again.
+    string nextPage = request.path + "?";
+    for (const auto& [name, value] : request.params) {
+      if (name != PAGE_AFTER_PARAMETER && name != PAGE_SIZE_PARAMETER) {
+        nextPage += encodeQueryComponent(name) + "=" + encodeQueryComponent(value) + "&";
+      }
+    }
+    nextPage += encodeQueryComponent(PAGE_AFTER_PARAMETER) + "=" + to_string(last - 1) + "&" +
+      encodeQueryComponent(PAGE_SIZE_PARAMETER) + "=" + to_string(pageSize);
+    response.set_header("Link", "<" + nextPage + ">; rel=\"next\"");
+  }
+  respondWithJson(response, page);
+}
+
+void StandInServer::respondWithJson(httplib::Response& response, const json& body) const {
+  response.status = 200;
+  response.set_content(body.dump(), JSON_MIME_TYPE);
+}
+
+void StandInServer::respondWithError(httplib::Response& response, const int status,
+  const string& message) const {
+  response.status = status;
+  response.set_content(json {{"error", message}}.dump(), JSON_MIME_TYPE);
+}
+
+bool StandInServer::resolveProject(const httplib::Request& request, httplib::Response& response,
+  size_t& project) const {
+  const auto resolvedProject = model_.findProject(request.path_params.at("projectId"));
+  if (! resolvedProject) {
+    respondWithError(response, 404, "The project does not exist.");
+    return false;
+  }
+  project = *resolvedProject;
+  return true;
+}
+
+bool StandInServer::resolveCommit(const httplib::Request& request, httplib::Response& response,
+  size_t& project, size_t& commit) const {
+  if (! resolveProject(request, response, project)) {
+    return false;
+  }
+  const auto resolvedCommit = model_.findCommit(project, request.path_params.at("commitId"));
+  if (! resolvedCommit) {
+    respondWithError(response, 404, "The commit does not exist.");
+    return false;
+  }
+  commit = *resolvedCommit;
+  return true;
+}
+
+bool StandInServer::resolveElement(const httplib::Request& request, httplib::Response& response,
+  const size_t project, size_t& element) const {
+  const auto resolvedElement = model_.findElement(project, request.path_params.at("elementId"));
+  if (! resolvedElement) {
+    respondWithError(response, 404, "The element does not exist.");
+    return false;
+  }
+  element = *resolvedElement;
+  return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "syntheticmodel.hpp"
+
+// IMPORTANT: httplib.h must be included BEFORE Windows.h!
+#include <httplib.h>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/// @brief How the stand-in server behaves, apart from the model it serves.
+struct StandInOptions {
+  /// The delay that is added to every response.
+  std::chrono::milliseconds latency_ { 0 };
+  /// The upper bound of a uniformly distributed random delay that is added to the latency.
+  std::chrono::milliseconds jitter_ { 0 };
+  /// The number of requests that are served concurrently.
+  std::size_t numberOfThreads_ { 8 };
+  /// The page size if a request has no 'page[size]' parameter.
+  std::size_t defaultPageSize_ { 100 };
+  std::size_t maxPageSize_ { 1000 };
+};
+
+/// @brief A local stand-in for a SysML v2 API server, which serves a SyntheticModel.
+///
+/// Implements the read operations of the endpoints that SysMLv2APIClient calls: projects,
+/// commits, elements, roots, relationships, changes, diff, branches, tags and query-results.
+/// Lists are paged as by the SysML v2 API pilot implementation: 'page[size]' limits the number
+/// of items, and the 'Link' header of a page refers to the next page ('page[after]').
+class StandInServer {
+public:
+  StandInServer(const SyntheticModel& model, const StandInOptions& options);
+
+  /// @brief Serves requests until stop() is called.
+  /// @throw std::runtime_error if the server cannot listen at the given address.
+  void listen(const std::string& hostAddress, const std::uint16_t port);
+
+  void stop();
+
+  StandInServer() = delete;
+
+private:
+  using ItemRenderer = std::function<nlohmann::json(const std::size_t position)>;
+
+  void createEndpoints();
+  void injectLatency() const;
+
+  /// @brief Responds with the page of a list that the request asks for.
+  void respondWithPage(const httplib::Request& request, httplib::Response& response,
+    const std::size_t numberOfItems, const ItemRenderer& renderItem) const;
+  void respondWithJson(httplib::Response& response, const nlohmann::json& body) const;
+  void respondWithError(httplib::Response& response, const int status,
+    const std::string& message) const;
+
+  /// @brief Resolve the ids in the path of a request, responding with 404 if one is unknown.
+  /// @return false if a response has been given.
+  bool resolveProject(const httplib::Request& request, httplib::Response& response,
+    std::size_t& project) const;
+  bool resolveCommit(const httplib::Request& request, httplib::Response& response,
+    std::size_t& project, std::size_t& commit) const;
+  bool resolveElement(const httplib::Request& request, httplib::Response& response,
+    const std::size_t project, std::size_t& element) const;
+
+  const SyntheticModel& model_;
+  const StandInOptions options_;
+  httplib::Server server_;
+};
@@ -0,0 +1,336 @@
+#include "syntheticmodel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace {
+  constexpr size_t COMMITS_PER_TAG { 5 };
+
+  /// @brief The SplitMix64 finalizer, which turns consecutive inputs into well-mixed outputs.
+  uint64_t mix(uint64_t value) noexcept {
+    value += 0x9e3779b97f4a7c15;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+    return value ^ (value >> 31);
+  }
+
+  uint64_t mix(const uint64_t seed, const uint64_t first, const uint64_t second) noexcept {
+    return mix(mix(mix(seed) ^ first) ^ second);
+  }
+
+  /// @brief The creation time of a commit: the history starts at 2025-01-01, one commit an hour.
+  string timestampOf(const size_t commit) {
+    using namespace chrono;
+    const sys_days firstDay { year(2025) / January / 1 };
+    const sys_seconds time = firstDay + hours(commit);
+    const sys_days day = floor<days>(time);
+    const year_month_day date { day };
+    const hh_mm_ss timeOfDay { time - day };
+    array<char, 32> buffer;
+    snprintf(buffer.data(), buffer.size(), "%04d-%02u-%02uT%02d:%02d:%02dZ",
+      static_cast<int>(date.year()), static_cast<unsigned int>(date.month()),
+      static_cast<unsigned int>(date.day()), static_cast<int>(timeOfDay.hours().count()),
+      static_cast<int>(timeOfDay.minutes().count()),
+      static_cast<int>(timeOfDay.seconds().count()));
+    return buffer.data();
+  }
+
+  SyntheticModelOptions normalize(SyntheticModelOptions options) noexcept {
+    options.numberOfProjects_ = max<size_t>(options.numberOfProjects_, 1);
+    options.depth_ = max<size_t>(options.depth_, 1);
+    options.fanOut_ = max<size_t>(options.fanOut_, 1);
+    options.numberOfCommits_ = max<size_t>(options.numberOfCommits_, 1);
+    return options;
+  }
+
+  json reference(const string& id) {
+    return {{"@id", id}};
+  }
+}
+
+SyntheticModel::SyntheticModel(const SyntheticModelOptions& options) :
+  options_(normalize(options)) {
+  elements_.reserve(options_.numberOfElements_);
+
+  // The containment tree is built breadth first, so the owned elements of each element are
+  // contiguous and the roots come first.
+  numberOfRoots_ = min(options_.fanOut_, options_.numberOfElements_);
+  for (size_t root = 0; root < numberOfRoots_; ++root) {
+    elements_.push_back({ NO_OWNER, 0, 0, 0 });
+  }
+  for (size_t index = 0; index < elements_.size() &&
+    elements_.size() < options_.numberOfElements_; ++index) {
+    if (elements_[index].level_ + 1 >= options_.depth_) {
+      break;
+    }
+    const size_t numberOfOwned = min(options_.fanOut_,
+      options_.numberOfElements_ - elements_.size());
+    elements_[index].firstOwned_ = elements_.size();
+    elements_[index].numberOfOwned_ = numberOfOwned;
+    const size_t level = elements_[index].level_ + 1;
+    for (size_t owned = 0; owned < numberOfOwned; ++owned) {
+      elements_.push_back({ index, 0, 0, level });
+    }
+  }
+}
+
+string SyntheticModel::projectId(const size_t project) const {
+  return formatId(IdKind::project, project, project);
+}
+
+string SyntheticModel::commitId(const size_t project, const size_t commit) const {
+  return formatId(IdKind::commit, project, commit);
+}
+
+string SyntheticModel::elementId(const size_t project, const size_t element) const {
+  return formatId(IdKind::element, project, element);
+}
+
+optional<size_t> SyntheticModel::findProject(const string_view id) const {
+  return parseId(IdKind::project, 0, id);
+}
+
+optional<size_t> SyntheticModel::findCommit(const size_t project, const string_view id) const {
+  const auto commit = parseId(IdKind::commit, project, id);
+  return commit && *commit < options_.numberOfCommits_ ? commit : nullopt;
+}
+
+optional<size_t> SyntheticModel::findElement(const size_t project, const string_view id) const {
+  const auto element = parseId(IdKind::element, project, id);
+  return element && *element < elements_.size() ? element : nullopt;
+}
+
+json SyntheticModel::renderProject(const size_t project) const {
+  return {
+    {"@id", projectId(project)},
+    {"@type", "Project"},
+    {"name", "Synthetic Project " + to_string(project + 1)},
+    {"description", "A generated model with " + to_string(elements_.size()) + " elements."},
+    {"created", timestampOf(0)},
+    {"defaultBranch", reference(formatId(IdKind::branch, project, 0))}
+  };
+}
+
+json SyntheticModel::renderCommit(const size_t project, const size_t commit) const {
+  return {
+    {"@id", commitId(project, commit)},
+    {"@type", "Commit"},
+    {"created", timestampOf(commit)},
+    {"description", commit == 0 ? string("Initial commit") : "Revision " + to_string(commit)},
+    {"owningProject", reference(projectId(project))},
+    {"previousCommit", commit == 0 ? json::array() :
+      json::array({ reference(commitId(project, commit - 1)) })}
+  };
+}
+
+json SyntheticModel::renderBranches(const size_t project) const {
+  const size_t head = options_.numberOfCommits_ - 1;
+  return json::array({{
+    {"@id", formatId(IdKind::branch, project, 0)},
+    {"@type", "Branch"},
+    {"name", "main"},
+    {"created", timestampOf(0)},
+    {"head", reference(commitId(project, head))},
+    {"referencedCommit", reference(commitId(project, head))},
+    {"owningProject", reference(projectId(project))}
+  }});
+}
+
+json SyntheticModel::renderTags(const size_t project) const {
+  json tags = json::array();
+  for (size_t commit = COMMITS_PER_TAG - 1; commit < options_.numberOfCommits_;
+    commit += COMMITS_PER_TAG) {
+    tags.push_back({
+      {"@id", formatId(IdKind::tag, project, commit)},
+      {"@type", "Tag"},
+      {"name", "v" + to_string((commit + 1) / COMMITS_PER_TAG)},
+      {"created", timestampOf(commit)},
+      {"taggedCommit", reference(commitId(project, commit))},
+      {"referencedCommit", reference(commitId(project, commit))},
+      {"owningProject", reference(projectId(project))}
+    });
+  }
+  return tags;
+}
+
+json SyntheticModel::renderElement(const size_t project, const size_t commit,
+  const size_t element) const {
+  const Element& node = elements_[element];
+  json ownedElements = json::array();
+  for (size_t owned = node.firstOwned_; owned < node.firstOwned_ + node.numberOfOwned_; ++owned) {
+    ownedElements.push_back(reference(elementId(project, owned)));
+  }
+  const string name = nameOf(element, commit);
+  return {
+    {"@id", elementId(project, element)},
+    {"@type", typeOf(node.level_)},
+    {"elementId", elementId(project, element)},
+    {"name", name},
+    {"declaredName", name},
+    {"qualifiedName", qualifiedNameOf(element, commit)},
+    {"isLibraryElement", false},
+    {"owner", node.owner_ == NO_OWNER ? json(nullptr) :
+      reference(elementId(project, node.owner_))},
+    {"ownedElement", move(ownedElements)},
+    {"documentation", json::array()}
+  };
+}
+
+json SyntheticModel::renderDataVersion(const size_t project, const size_t commit,
+  const size_t element) const {
+  return {
+    {"@type", "DataVersion"},
+    {"identity", reference(elementId(project, element))},
+    {"payload", renderElement(project, commit, element)}
+  };
+}
+
+json SyntheticModel::renderRelationships(const size_t project, const size_t element,
+  const string_view direction) const {
+  const auto renderMembership = [this, project](const size_t owner, const size_t owned) {
+    return json {
+      {"@id", formatId(IdKind::relationship, project, owned)},
+      {"@type", "OwningMembership"},
+      {"source", json::array({ reference(elementId(project, owner)) })},
+      {"target", json::array({ reference(elementId(project, owned)) })}
+    };
+  };
+
+  json relationships = json::array();
+  const Element& node = elements_[element];
+  if (direction != "out" && node.owner_ != NO_OWNER) {
+    relationships.push_back(renderMembership(node.owner_, element));
+  }
+  if (direction != "in") {
+    for (size_t owned = node.firstOwned_; owned < node.firstOwned_ + node.numberOfOwned_;
+      ++owned) {
+      relationships.push_back(renderMembership(element, owned));
+    }
+  }
+  return relationships;
+}
+
+vector<size_t> SyntheticModel::determineChangedElements(const size_t baseCommit,
+  const size_t compareCommit) const {
+  const size_t from = min(baseCommit, compareCommit);
+  const size_t to = max(baseCommit, compareCommit);
+  vector<size_t> changedElements;
+  for (size_t element = 0; element < elements_.size(); ++element) {
+    for (size_t commit = from + 1; commit <= to; ++commit) {
+      if (isModifiedBy(element, commit)) {
+        changedElements.push_back(element);
+        break;
+      }
+    }
+  }
+  return changedElements;
+}
+
+vector<size_t> SyntheticModel::evaluateQuery(const size_t commit, const json& query) const {
+  string property;
+  string value;
+  const auto where = query.find("where");
+  if (where != query.end() && where->is_object() &&
+    where->value("@type", "") == "PrimitiveConstraint" && where->value("operator", "=") == "=") {
+    property = where->value("property", "");
+    const auto constraintValue = where->find("value");
+    if (constraintValue != where->end()) {
+      value = constraintValue->is_array() && ! constraintValue->empty() ?
+        constraintValue->front().get<string>() : constraintValue->get<string>();
+    }
+  }
+
+  vector<size_t> result;
+  for (size_t element = 0; element < elements_.size(); ++element) {
+    if (property == "@type") {
+      if (value != typeOf(elements_[element].level_)) {
+        continue;
+      }
+    } else if (property == "name" || property == "declaredName") {
+      if (value != nameOf(element, commit)) {
+        continue;
+      }
+    }
+    result.push_back(element);
+  }
+  return result;
+}
+
+size_t SyntheticModel::revisionOf(const size_t element, const size_t commit) const noexcept {
+  size_t revision { 0 };
+  for (size_t modifyingCommit = 1; modifyingCommit <= commit; ++modifyingCommit) {
+    revision += isModifiedBy(element, modifyingCommit) ? 1 : 0;
+  }
+  return revision;
+}
+
+string SyntheticModel::formatId(const IdKind kind, const size_t project, const size_t index) const {
+  const uint64_t prefix = mix(options_.seed_, static_cast<uint64_t>(kind), project);
+  array<char, 40> buffer;
+  snprintf(buffer.data(), buffer.size(), "%08x-%04x-4%03x-%04x-%012llx",
+    static_cast<unsigned int>(prefix >> 32), static_cast<unsigned int>((prefix >> 16) & 0xffff),
+    static_cast<unsigned int>(prefix & 0xfff), static_cast<unsigned int>(
+      0x8000 | ((prefix >> 12) & 0x3fff)),
+    static_cast<unsigned long long>(index & 0xffffffffffffull));
+  return buffer.data();
+}
+
+optional<size_t> SyntheticModel::parseId(const IdKind kind, const size_t project,
+  const string_view id) const {
+  constexpr size_t ID_LENGTH { 36 };
+  constexpr size_t INDEX_LENGTH { 12 };
+  if (id.size() != ID_LENGTH) {
+    return nullopt;
+  }
+  uint64_t index { 0 };
+  const char* const indexBegin = id.data() + ID_LENGTH - INDEX_LENGTH;
+  const auto [end, ec] = from_chars(indexBegin, id.data() + ID_LENGTH, index, 16);
+  if (ec != errc() || end != id.data() + ID_LENGTH) {
+    return nullopt;
+  }
+  const size_t owningProject = kind == IdKind::project ? static_cast<size_t>(index) : project;
+  if (kind == IdKind::project && owningProject >= options_.numberOfProjects_) {
+    return nullopt;
+  }
+  if (formatId(kind, owningProject, static_cast<size_t>(index)) != id) {
+    return nullopt;
+  }
+  return static_cast<size_t>(index);
+}
+
+bool SyntheticModel::isModifiedBy(const size_t element, const size_t commit) const noexcept {
+  return commit > 0 && mix(options_.seed_, element, commit) % 100 < options_.changeRate_;
+}
+
+string SyntheticModel::nameOf(const size_t element, const size_t commit) const {
+  static constexpr array<const char*, 5> NAME_PREFIXES {
+    "package", "partDef", "part", "port", "attribute" };
+  string name = NAME_PREFIXES[min(elements_[element].level_, NAME_PREFIXES.size() - 1)];
+  name += to_string(element);
+  const size_t revision = revisionOf(element, commit);
+  if (revision > 0) {
+    name += "_r" + to_string(revision);
+  }
+  return name;
+}
+
+string SyntheticModel::qualifiedNameOf(const size_t element, const size_t commit) const {
+  string qualifiedName = nameOf(element, commit);
+  for (size_t owner = elements_[element].owner_; owner != NO_OWNER;
+    owner = elements_[owner].owner_) {
+    qualifiedName = nameOf(owner, commit) + "::" + qualifiedName;
+  }
+  return qualifiedName;
+}
+
+const char* SyntheticModel::typeOf(const size_t level) noexcept {
+  static constexpr array<const char*, 5> TYPES {
+    "Package", "PartDefinition", "PartUsage", "PortUsage", "AttributeUsage" };
+  return TYPES[min(level, TYPES.size() - 1)];
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief The shape of a generated model. Counts of zero are raised to one, except for the
+/// number of elements.
+struct SyntheticModelOptions {
+  std::size_t numberOfProjects_ { 1 };
+  /// The number of elements of each commit of each project.
+  std::size_t numberOfElements_ { 1000 };
+  /// The maximum nesting depth of the containment tree (1 means that there are only roots).
+  std::size_t depth_ { 4 };
+  /// The number of roots, and of the owned elements of each element above the deepest level.
+  std::size_t fanOut_ { 8 };
+  /// The length of the (linear) commit history of each project.
+  std::size_t numberOfCommits_ { 10 };
+  /// The percentage of the elements that each commit modifies.
+  unsigned int changeRate_ { 5 };
+  std::uint64_t seed_ { 42 };
+};
+
+/// @brief A SysML v2 model that is generated deterministically from a seed, to stand in for the
+/// repository of a SysML v2 API server.
+///
+/// Only the containment tree is kept in memory; the elements, relationships, commits, branches
+/// and tags are rendered as JSON on request. All identifiers are UUIDs whose last 48 bits are the
+/// index of the identified object, so that they can be resolved without a lookup table.
+class SyntheticModel {
+public:
+  explicit SyntheticModel(const SyntheticModelOptions& options);
+
+  const SyntheticModelOptions& options() const noexcept { return options_; }
+  std::size_t numberOfElements() const noexcept { return elements_.size(); }
+  std::size_t numberOfRoots() const noexcept { return numberOfRoots_; }
+
+  std::string projectId(const std::size_t project) const;
+  std::string commitId(const std::size_t project, const std::size_t commit) const;
+  std::string elementId(const std::size_t project, const std::size_t element) const;
+
+  /// @brief Resolves an identifier issued by this model.
+  /// @return the project or commit index, or std::nullopt if the identifier is unknown.
+  std::optional<std::size_t> findProject(std::string_view id) const;
+  std::optional<std::size_t> findCommit(const std::size_t project, std::string_view id) const;
+  std::optional<std::size_t> findElement(const std::size_t project, std::string_view id) const;
+
+  nlohmann::json renderProject(const std::size_t project) const;
+  nlohmann::json renderCommit(const std::size_t project, const std::size_t commit) const;
+  nlohmann::json renderBranches(const std::size_t project) const;
+  nlohmann::json renderTags(const std::size_t project) const;
+
+  /// @brief Renders an element as it is at the given commit.
+  nlohmann::json renderElement(const std::size_t project, const std::size_t commit,
+    const std::size_t element) const;
+
+  /// @brief Renders an element as the payload of a DataVersion, as used by commits and diffs.
+  nlohmann::json renderDataVersion(const std::size_t project, const std::size_t commit,
+    const std::size_t element) const;
+
+  /// @brief Renders the owning relationships of an element.
+  /// @param direction is 'in' (to the owner), 'out' (to the owned elements) or 'both'.
+  nlohmann::json renderRelationships(const std::size_t project, const std::size_t element,
+    std::string_view direction) const;
+
+  /// @brief Determines the elements whose revision differs between two commits.
+  std::vector<std::size_t> determineChangedElements(const std::size_t baseCommit,
+    const std::size_t compareCommit) const;
+
+  /// @brief Determines the elements that satisfy a SysML v2 API query at a commit. Only 'where'
+  /// clauses that are PrimitiveConstraints with the operator '=' on '@type', 'name' or
+  /// 'declaredName' are evaluated; any other query selects all elements.
+  std::vector<std::size_t> evaluateQuery(const std::size_t commit,
+    const nlohmann::json& query) const;
+
+  /// @brief Determines the revision of an element at a commit, i.e. the number of commits up to
+  /// and including the given one that have modified it.
+  std::size_t revisionOf(const std::size_t element, const std::size_t commit) const noexcept;
+
+private:
+  struct Element {
+    std::size_t owner_;
+    std::size_t firstOwned_;
+    std::size_t numberOfOwned_;
+    std::size_t level_;
+  };
+
+  enum class IdKind : std::uint16_t {
+    project = 1, commit, element, branch, tag, relationship
+  };
+
+  std::string formatId(const IdKind kind, const std::size_t project,
+    const std::size_t index) const;
+  std::optional<std::size_t> parseId(const IdKind kind, const std::size_t project,
+    std::string_view id) const;
+  bool isModifiedBy(const std::size_t element, const std::size_t commit) const noexcept;
+  std::string nameOf(const std::size_t element, const std::size_t commit) const;
+  std::string qualifiedNameOf(const std::size_t element, const std::size_t commit) const;
+  static const char* typeOf(const std::size_t level) noexcept;
+
+  static constexpr std::size_t NO_OWNER { static_cast<std::size_t>(-1) };
+
+  const SyntheticModelOptions options_;
+  std::vector<Element> elements_;
+  std::size_t numberOfRoots_ { 0 };
+};
@@ -3,9 +3,7 @@
 /// @file Provides prepared test data.
 
 #include "../src/globals.hpp"
-#include <nlohmann/json.hpp>
-
-using json = nlohmann::json;
+#include "../src/arenajson.hpp"
 
 const char* const SERVER_NAME = "SysMLv2MCPServer4Testing";
 const char* const SERVER_VERSION = "0.0.0";
@@ -25,7 +23,7 @@ const json requestWithInvalidJsonRpcVersion = {
 
 const json expectedJsonRpcVersionErrorResponse = {
   {"jsonrpc", globals::REQUIRED_JSONRPC_VERSION},
-  {"id", 0},
+  {"id", 1},
   {"error" , { {"code", globals::JSONRPC_ERROR_GENERAL},
     {"message", "Missing or invalid JSON-RPC version -- must be version 2.0!"}}
   }
@@ -46,7 +44,7 @@ const json requestWithInvalidMcpProtocolVersion = {
 
 const json expectedMcpProtocolVersionErrorResponse = {
   {"jsonrpc", globals::REQUIRED_JSONRPC_VERSION},
-  {"id", 0},
+  {"id", 2},
   {"error" , { {"code", globals::JSONRPC_ERROR_GENERAL},
     {"message", "Unsupported MCP protocol version: 1972-01-01"}}
   }
@@ -134,4 +132,18 @@ const json expectedToolListResponse = {
     {"required", {"message"}}}
     }}}
   }}
-};
\ No newline at end of file
+};
+
+const json requestWithUnknownMethod = {
+  {"jsonrpc", globals::REQUIRED_JSONRPC_VERSION},
+  {"id", "request-6"},
+  {"method", "tools/unknown"}
+};
+
+const json expectedUnknownMethodErrorResponse = {
+  {"jsonrpc", globals::REQUIRED_JSONRPC_VERSION},
+  {"id", "request-6"},
+  {"error" , { {"code", globals::JSONRPC_ERROR_METHOD_NOT_FOUND},
+    {"message", "The requested method 'tools/unknown' does not exist."}}
+  }
+};
@@ -1,7 +1,128 @@
+#include "../src/admissioncontroller.hpp"
+#include "../src/compression.hpp"
+#include "../src/concurrencylimiter.hpp"
+#ifdef __linux__
+#include "../src/epollhttpmcptransport.hpp"
+#endif
+#include "../src/httpmcptransport.hpp"
+#include "../src/httprequestparser.hpp"
+#include "../src/httptoolclient.hpp"
+#include "../src/lineframer.hpp"
+#include "../src/logpayload.hpp"
 #include "../src/mcpserver.hpp"
+#include "../src/metrics.hpp"
+#include "../src/mpscqueue.hpp"
+#include "../src/stdinstdoutmcptransport.hpp"
+#include "../src/tooloutputwriter.hpp"
+#include "../src/tracing.hpp"
+#ifdef __linux__
+#include "../src/unixsocketmcptransport.hpp"
+#endif
+#include "../src/upstreambalancer.hpp"
+#include "../src/upstreamhedging.hpp"
+#include "../src/upstreamtraffic.hpp"
+#include "../src/workerpool.hpp"
+#include "../srcloadgen/latencyhistogram.hpp"
+#include "../srcstandin/syntheticmodel.hpp"
 #include "testdata.hpp"
 
 #include <catch2/catch_test_macros.hpp>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+  /// @brief Waits until a HTTP server on localhost answers requests to the given path.
+  bool waitUntilServing(const int port, const std::string& path) {
+    httplib::Client client("http://127.0.0.1:" + std::to_string(port));
+    client.set_keep_alive(false);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+      if (client.Get(path, {})) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+#ifdef __linux__
+  /// @brief Connects to a TCP port on localhost, with a receive timeout of 5 seconds.
+  int connectToLocalPort(const uint16_t port) {
+    const int socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    const timeval timeout { 5, 0 };
+    ::setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in address { };
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int attempt = 0; attempt < 100; ++attempt) {
+      if (::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        return socket;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ::close(socket);
+    return -1;
+  }
+
+  /// @brief Connects to a Unix domain socket, with a receive timeout of 5 seconds.
+  int connectToUnixSocket(const std::string& socketPath) {
+    const int socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    const timeval timeout { 5, 0 };
+    ::setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_un address { };
+    address.sun_family = AF_UNIX;
+    socketPath.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    if (::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+      ::close(socket);
+      return -1;
+    }
+    return socket;
+  }
+
+  /// @brief Receives from a socket until the peer closes it or the receive timeout expires.
+  std::string receiveUntilClosed(const int socket) {
+    std::string received;
+    char chunk[4096];
+    ssize_t length { 0 };
+    while ((length = ::recv(socket, chunk, sizeof(chunk), 0)) > 0) {
+      received.append(chunk, static_cast<std::size_t>(length));
+    }
+    return received;
+  }
+
+  std::size_t countOccurrences(const std::string& text, const std::string& pattern) {
+    std::size_t count { 0 };
+    for (auto position = text.find(pattern); position != std::string::npos;
+      position = text.find(pattern, position + pattern.size())) {
+      ++count;
+    }
+    return count;
+  }
+#endif
+}
 
 TEST_CASE("Verifying SysML v2 API MCP-Server") {
 
@@ -11,6 +132,24 @@ TEST_CASE("Verifying SysML v2 API MCP-Server") {
     REQUIRE(response == expectedJsonRpcVersionErrorResponse);
   }
 
+  SECTION("Concurrent failing requests are answered with errors that carry their own ids") {
+    MCPServer server { SERVER_NAME, SERVER_VERSION };
+    json firstRequest = requestWithInvalidJsonRpcVersion;
+    firstRequest["id"] = "first";
+    json secondRequest = requestWithInvalidJsonRpcVersion;
+    secondRequest["id"] = 42;
+    json firstResponse;
+    json secondResponse;
+    std::thread first([&]() { firstResponse = server.handleRequest(firstRequest); });
+    std::thread second([&]() { secondResponse = server.handleRequest(secondRequest); });
+    first.join();
+    second.join();
+    REQUIRE(firstResponse.contains("error"));
+    REQUIRE(firstResponse["id"] == "first");
+    REQUIRE(secondResponse.contains("error"));
+    REQUIRE(secondResponse["id"] == 42);
+  }
+
   SECTION("Unsupported MCP protocol version leads to an error response") {
     MCPServer server { SERVER_NAME, SERVER_VERSION };
     const json response = server.handleRequest(requestWithInvalidMcpProtocolVersion);
@@ -36,4 +175,1295 @@ TEST_CASE("Verifying SysML v2 API MCP-Server") {
     const json response = server.handleRequest(listAvailableToolsRequest);
     REQUIRE(response == expectedToolListResponse);
   }
+
+  SECTION("A ping is answered with an empty result") {
+    MCPServer server { SERVER_NAME, SERVER_VERSION };
+    const json response = server.handleRequest({
+      {"jsonrpc", globals::REQUIRED_JSONRPC_VERSION}, {"id", 7}, {"method", "ping"} });
+    REQUIRE(response == json { {"jsonrpc", globals::REQUIRED_JSONRPC_VERSION}, {"id", 7},
+      {"result", json::object()} });
+  }
+
+  SECTION("An unknown method leads to a 'method not found' error response") {
+    MCPServer server { SERVER_NAME, SERVER_VERSION };
+    const json response = server.handleRequest(requestWithUnknownMethod);
+    REQUIRE(response == expectedUnknownMethodErrorResponse);
+  }
+
+  SECTION("Serialized 'tools/list' responses are cached until the next registration") {
+    MCPServer server { SERVER_NAME, SERVER_VERSION };
+    server.handleRequest(initServerRequest);
+    const std::string serializedResponse = server.handleRequestSerialized(listAvailableToolsRequest);
+    REQUIRE(serializedResponse == server.handleRequest(listAvailableToolsRequest).dump());
+
+    server.registerTool("noop", "Does nothing.", {{"type", "object"}},
+      [](const json&) -> json { return {{"content", json::array()}}; });
+    const json response = json::parse(server.handleRequestSerialized(listAvailableToolsRequest));
+    REQUIRE(response == server.handleRequest(listAvailableToolsRequest));
+    REQUIRE(response["result"]["tools"].size() ==
+      json::parse(serializedResponse)["result"]["tools"].size() + 1);
+  }
+
+  SECTION("Results of read-only tools are memoized if all required arguments are given") {
+    MCPServer server { SERVER_NAME, SERVER_VERSION };
+    server.handleRequest(initServerRequest);
+    int numberOfCalls { 0 };
+    server.registerTool("count", "Counts its calls.", {{"type", "object"}},
+      [&numberOfCalls](const json&) -> json {
+        ++numberOfCalls;
+        return {{"content", {{{"type", "text"}, {"text", std::to_string(numberOfCalls)}}}}};
+      },
+      ToolAnnotations { true, true, { ToolCachePolicy::Scope::shared, std::chrono::seconds(60),
+        { "commitId" } } });
+
+    const json pinnedCall = {
+      {"jsonrpc", "2.0"}, {"id", 7}, {"method", "tools/call"},
+      {"params", {{"name", "count"}, {"arguments", {{"commitId", "c1"}, {"page", 1}}}}}
+    };
+    const json response = server.handleRequest(pinnedCall);
+    REQUIRE(server.handleRequest(pinnedCall) == response);
+    REQUIRE(json::parse(server.handleRequestSerialized(pinnedCall)) == response);
+    REQUIRE(numberOfCalls == 1);
+
+    json unpinnedCall = pinnedCall;
+    unpinnedCall["params"]["arguments"].erase("commitId");
+    server.handleRequest(unpinnedCall);
+    server.handleRequestSerialized(unpinnedCall);
+    REQUIRE(numberOfCalls == 3);
+
+    const json toolList = server.handleRequest(listAvailableToolsRequest);
+    const auto countTool = std::find_if(toolList["result"]["tools"].begin(),
+      toolList["result"]["tools"].end(), [](const json& tool) { return tool["name"] == "count"; });
+    REQUIRE((*countTool)["annotations"]["readOnlyHint"] == true);
+  }
+
+  SECTION("Tool arguments are validated against the input schema before the handler runs") {
+    MCPServer server { SERVER_NAME, SERVER_VERSION };
+    server.handleRequest(initServerRequest);
+    json passedArguments;
+    server.registerTool("list", "Lists something.", {
+        {"type", "object"},
+        {"properties", {
+          {"projectId", {{"type", "string"}}},
+          {"pageSize", {{"type", "integer"}, {"default", 50}}},
+          {"order", {{"type", "string"}, {"enum", {"asc", "desc"}}}}
+        }},
+        {"required", {"projectId"}}
+      },
+      [&passedArguments](const json& arguments) -> json {
+        passedArguments = arguments;
+        return {{"content", json::array()}};
+      });
+
+    const auto callWith = [&server](const json& arguments) {
+      return server.handleRequest({
+        {"jsonrpc", "2.0"}, {"id", 8}, {"method", "tools/call"},
+        {"params", {{"name", "list"}, {"arguments", arguments}}}
+      })["result"];
+    };
+
+    REQUIRE(callWith({{"projectId", "p1"}})["isError"] == false);
+    REQUIRE(passedArguments == json {{"projectId", "p1"}, {"pageSize", 50}});
+
+    passedArguments = nullptr;
+    REQUIRE(callWith({{"pageSize", 10}})["isError"] == true);
+    REQUIRE(callWith({{"projectId", 42}})["isError"] == true);
+    REQUIRE(callWith({{"projectId", "p1"}, {"pageSize", "ten"}})["isError"] == true);
+    REQUIRE(callWith({{"projectId", "p1"}, {"order", "random"}})["isError"] == true);
+    REQUIRE(passedArguments.is_null());
+  }
+}
+
+TEST_CASE("Verifying the per-request arena for JSON documents") {
+
+  SECTION("JSON built within an arena scope is allocated from the arena") {
+    ArenaScope arenaScope;
+    const json document = json::parse(R"({"elements": [1, 2, 3]})");
+    REQUIRE(RequestArena::ownsMemory(&document["elements"]));
+    {
+      ArenaSuspension arenaSuspension;
+      const json persistent = document;
+      REQUIRE_FALSE(RequestArena::ownsMemory(&persistent["elements"]));
+    }
+  }
+
+  SECTION("Registrations during a request outlive the request's arena") {
+    MCPServer server { SERVER_NAME, SERVER_VERSION };
+    {
+      ArenaScope arenaScope;
+      server.handleRequestSerialized(initServerRequest); // registers the echo tool
+    }
+    {
+      ArenaScope arenaScope;
+      const json overwrite = json::parse(R"({"overwrite": ["the", "released", "arena"]})");
+      REQUIRE(json::parse(server.handleRequestSerialized(callEchoToolRequest)) ==
+        expectedEchoToolResponse);
+    }
+  }
+
+  SECTION("Chunks beyond the maximum size are not kept after a request") {
+    void* small { nullptr };
+    void* huge { nullptr };
+    {
+      ArenaScope arenaScope;
+      small = RequestArena::current()->allocate(1024, alignof(std::max_align_t));
+      huge = RequestArena::current()->allocate(16 * 1024 * 1024, alignof(std::max_align_t));
+      REQUIRE(RequestArena::ownsMemory(huge));
+    }
+    REQUIRE(RequestArena::ownsMemory(small));
+    REQUIRE_FALSE(RequestArena::ownsMemory(huge));
+  }
+
+#ifndef NDEBUG
+  SECTION("Debug builds recognize the arena memory of other threads") {
+    ArenaScope arenaScope;
+    const void* memory = RequestArena::current()->allocate(64, alignof(std::max_align_t));
+    bool isOwnedByOtherThread { true };
+    bool isArenaMemory { false };
+    std::thread([&] {
+      isOwnedByOtherThread = RequestArena::ownsMemory(memory);
+      isArenaMemory = RequestArena::isArenaMemory(memory);
+    }).join();
+    REQUIRE_FALSE(isOwnedByOtherThread);
+    REQUIRE(isArenaMemory);
+  }
+#endif
+}
+
+TEST_CASE("Verifying the shaping of tool output") {
+  const json elements = json::parse(R"([
+    {"@id": "e1", "@type": "PartUsage", "name": "engine", "owner": {"@id": "e0"}},
+    {"@id": "e2", "@type": "PartUsage", "name": "wheel", "owner": {"@id": "e0"}},
+    {"@id": "e3", "@type": "PortUsage", "name": "axle", "owner": {"@id": "e2"}}
+  ])");
+
+  SECTION("Only the requested fields are written") {
+    const auto options = ToolOutputOptions::fromArguments({{"fields", {"name", "@id"}}});
+    std::string output;
+    REQUIRE(ToolOutputWriter(options).write(elements, output).empty());
+    REQUIRE(output == R"([{"name":"engine","@id":"e1"},{"name":"wheel","@id":"e2"},)"
+      R"({"name":"axle","@id":"e3"}])");
+  }
+
+  SECTION("A list exceeding the size limit is cut off and can be continued with the cursor") {
+    auto options = ToolOutputOptions::fromArguments({{"fields", {"@id"}}, {"maxResultBytes", 30}});
+    std::string output;
+    const std::string cursor = ToolOutputWriter(options).write(elements, output);
+    REQUIRE(output == R"([{"@id":"e1"},{"@id":"e2"}])");
+    REQUIRE(cursor == "2");
+
+    options = ToolOutputOptions::fromArguments({{"fields", {"@id"}}, {"cursor", cursor}});
+    output.clear();
+    REQUIRE(ToolOutputWriter(options).write(elements, output).empty());
+    REQUIRE(output == R"([{"@id":"e3"}])");
+  }
+
+  SECTION("Non-compact output is indented like json::dump()") {
+    const auto options = ToolOutputOptions::fromArguments({{"compact", false}});
+    std::string output;
+    ToolOutputWriter(options).write(elements, output);
+    REQUIRE(output == elements.dump(2));
+  }
+
+  SECTION("Non-compact projections are indented like json::dump() of the projected items") {
+    const auto options = ToolOutputOptions::fromArguments({{"compact", false},
+      {"fields", {"name", "owner"}}});
+    json projected = json::array();
+    for (const json& element : elements) {
+      projected.push_back({{"name", element["name"]}, {"owner", element["owner"]}});
+    }
+    std::string output;
+    ToolOutputWriter(options).write(elements, output);
+    REQUIRE(output == projected.dump(2));
+  }
+
+  SECTION("Projections read on demand from the JSON text equal those of the parsed data") {
+    std::string text = R"([ {"@id" : "e1", "name": "engine", "owner": { "@id": "e0" } },
+      {"name": "wheel\tleft", "@id": "e2", "owner": null}, {"@id": "e3"} ])";
+    for (const json& arguments : {
+           json {{"fields", {"@id", "owner"}}},
+           json {{"fields", {"owner", "name"}}, {"maxResultBytes", 30}, {"cursor", "1"}},
+           json {{"format", "table"}},
+           json {{"format", "table"}, {"fields", {"name", "owner"}}}}) {
+      const auto options = ToolOutputOptions::fromArguments(arguments);
+      std::string expected;
+      std::string output;
+      const std::string expectedCursor = ToolOutputWriter(options).write(json::parse(text),
+        expected);
+      REQUIRE(ToolOutputWriter(options).writeText(text, output) == expectedCursor);
+      REQUIRE(output == expected);
+    }
+  }
+
+  SECTION("Malformed JSON text leaves the output as it was") {
+    for (const json& arguments : {
+           json::object(),
+           json {{"fields", {"@id", "owner"}}},
+           json {{"format", "table"}}}) {
+      const auto options = ToolOutputOptions::fromArguments(arguments);
+      std::string text = R"([{"@id": "e1", "owner": {"@id": "e0"}}, {"@id": "e2", "owner": {"@id": ]})";
+      std::string output { "prefix" };
+      REQUIRE_THROWS(ToolOutputWriter(options).writeText(text, output));
+      REQUIRE(output == "prefix");
+    }
+  }
+
+  SECTION("The table format writes a header row followed by one row per item") {
+    const auto options = ToolOutputOptions::fromArguments({{"format", "table"}});
+    std::string output;
+    REQUIRE(ToolOutputWriter(options).write(elements, output).empty());
+    REQUIRE(output ==
+      "@id\t@type\tname\towner\n"
+      "e1\tPartUsage\tengine\t{\"@id\":\"e0\"}\n"
+      "e2\tPartUsage\twheel\t{\"@id\":\"e0\"}\n"
+      "e3\tPortUsage\taxle\t{\"@id\":\"e2\"}\n");
+  }
+
+  SECTION("Without fields, the table has a column for every member of any listed object") {
+    std::string text = R"([{"@id": "e1"}, {"@id": "e2", "name": "wheel"}, 42,
+      {"@id": "e3", "@type": "PortUsage"}])";
+    const auto options = ToolOutputOptions::fromArguments({{"format", "table"}});
+    std::string output;
+    REQUIRE(ToolOutputWriter(options).write(json::parse(text), output).empty());
+    REQUIRE(output ==
+      "@id\tname\t@type\n"
+      "e1\t\t\n"
+      "e2\twheel\t\n"
+      "42\n"
+      "e3\t\tPortUsage\n");
+    std::string onDemandOutput;
+    REQUIRE(ToolOutputWriter(options).writeText(text, onDemandOutput).empty());
+    REQUIRE(onDemandOutput == output);
+  }
+}
+
+TEST_CASE("Verifying the formatting of logged payloads") {
+  const json payload = json::parse(R"({"jsonrpc":"2.0","id":1,"method":"tools/list"})");
+
+  SECTION("Payloads are serialized only up to the maximum size") {
+    LogPayload::configure(1000, 1);
+    REQUIRE(fmt::format("{}", LogPayload(payload)) == payload.dump());
+    LogPayload::configure(10, 1);
+    REQUIRE(fmt::format("{}", LogPayload(payload)) == payload.dump().substr(0, 10) + "...(truncated)");
+    REQUIRE(fmt::format("{}", LogPayload(std::string("0123456789abc"))) == "0123456789...(truncated)");
+  }
+
+  SECTION("Strings with invalid UTF-8 are written with replacement characters") {
+    LogPayload::configure(1000, 1);
+    const json invalid = { {"text", std::string("ab\xFF")} };
+    REQUIRE(fmt::format("{}", LogPayload(invalid)) ==
+      invalid.dump(-1, ' ', false, json::error_handler_t::replace));
+  }
+
+  SECTION("Only every n-th payload is written if sampling is configured") {
+    LogPayload::configure(1000, 3);
+    unsigned int written { 0 };
+    for (int i = 0; i < 9; ++i) {
+      written += fmt::format("{}", LogPayload(payload)) == payload.dump() ? 1 : 0;
+    }
+    REQUIRE(written == 3);
+  }
+
+  LogPayload::configure(globals::DEFAULT_MAX_LOGGED_PAYLOAD_SIZE, 1);
+}
+
+TEST_CASE("Verifying the metrics and their export") {
+  SECTION("Observed values fall into log-linear buckets") {
+    const HistogramLayout layout { 4, 8, 1.0 };
+    REQUIRE(layout.bucketCount() == 10);
+    REQUIRE(layout.determineBucket(15) == 0);
+    REQUIRE(layout.determineBucket(16) == 1);
+    REQUIRE(layout.determineBucket(23) == 1);
+    REQUIRE(layout.determineBucket(24) == 2);
+    REQUIRE(layout.determineBucket(255) == 8);
+    REQUIRE(layout.determineBucket(256) == 9);
+    REQUIRE(layout.upperBoundOf(0) == 16);
+    REQUIRE(layout.upperBoundOf(1) == 24);
+    REQUIRE(layout.upperBoundOf(2) == 32);
+    REQUIRE(layout.upperBoundOf(8) == 256);
+    REQUIRE(layout.upperBoundOf(9) == 0);
+  }
+
+  SECTION("Metrics are exported in the Prometheus text format") {
+    MetricsRegistry registry;
+    auto& lookups = registry.addCounter("test_lookups_total", "Lookups.", { "result" });
+    lookups.withLabels({ "hit" }).increment(3);
+    auto& sizes = registry.addHistogram("test_size_bytes", "Sizes.", { 4, 6, 1.0 });
+    sizes.withLabels({}).observe(20);
+    sizes.withLabels({}).observe(100);
+
+    REQUIRE(registry.exportAsText() ==
+      "# HELP test_lookups_total Lookups.\n"
+      "# TYPE test_lookups_total counter\n"
+      "test_lookups_total{result=\"hit\"} 3\n"
+      "# HELP test_size_bytes Sizes.\n"
+      "# TYPE test_size_bytes histogram\n"
+      "test_size_bytes_bucket{le=\"16\"} 0\n"
+      "test_size_bytes_bucket{le=\"24\"} 1\n"
+      "test_size_bytes_bucket{le=\"32\"} 1\n"
+      "test_size_bytes_bucket{le=\"48\"} 1\n"
+      "test_size_bytes_bucket{le=\"64\"} 1\n"
+      "test_size_bytes_bucket{le=\"+Inf\"} 2\n"
+      "test_size_bytes_sum 120\n"
+      "test_size_bytes_count 2\n");
+  }
+}
+
+TEST_CASE("Verifying the tracing of request phases") {
+  const auto traceFileName = (std::filesystem::temp_directory_path() / "mcpservertest_trace.json").string();
+  MCPServer server { SERVER_NAME, SERVER_VERSION };
+
+  SECTION("Spans of sampled requests are written as Chrome trace events") {
+    Tracer::start(traceFileName, 2);
+    for (int i = 0; i < 4; ++i) {
+      const TracedRequest tracedRequest;
+      server.handleRequestSerialized(initServerRequest);
+    }
+    server.handleRequestSerialized(initServerRequest); // not within a traced request
+    Tracer::stop();
+
+    std::ifstream traceFile(traceFileName);
+    const json trace = json::parse(std::string(std::istreambuf_iterator<char>(traceFile), {}));
+    REQUIRE(trace.is_array());
+    const auto requestSpans = std::count_if(trace.begin(), trace.end(), [](const json& event) {
+      return event["name"] == "handle request" && event["args"]["detail"] == "initialize" &&
+        event["ph"] == "X";
+    });
+    REQUIRE(requestSpans == 2);
+    const auto dispatchSpans = std::count_if(trace.begin(), trace.end(), [](const json& event) {
+      return event["name"] == "dispatch";
+    });
+    REQUIRE(dispatchSpans == 2);
+  }
+
+  std::filesystem::remove(traceFileName);
+}
+
+TEST_CASE("Verifying the admission control of MCP requests") {
+  AdmissionController controller({ 1, 1, std::chrono::milliseconds(50) });
+
+  SECTION("Requests beyond the queue are rejected at once, queued ones are admitted in turn") {
+    std::optional<AdmissionController::Ticket> first { controller.admit() };
+    REQUIRE(first->isAdmitted());
+    AdmissionController::Outcome queuedOutcome { AdmissionController::Outcome::queueFull };
+    std::thread queued([&controller, &queuedOutcome] {
+      queuedOutcome = controller.admit().outcome();
+    });
+    while (controller.numberOfQueuedRequests() == 0) {
+      std::this_thread::yield();
+    }
+    REQUIRE(controller.admit().outcome() == AdmissionController::Outcome::queueFull);
+    first.reset();
+    queued.join();
+    REQUIRE(queuedOutcome == AdmissionController::Outcome::admitted);
+    REQUIRE(controller.numberOfRequestsInFlight() == 0);
+  }
+
+  SECTION("Requests waiting longer than the queue time are rejected") {
+    const AdmissionController::Ticket first = controller.admit();
+    REQUIRE(controller.admit().outcome() == AdmissionController::Outcome::queueTimeout);
+    REQUIRE(controller.numberOfQueuedRequests() == 0);
+    REQUIRE(controller.numberOfRequestsInFlight() == 1);
+    REQUIRE(controller.retryAfterSeconds() == 1);
+  }
+}
+
+#ifdef __linux__
+TEST_CASE("Verifying the admission control of connections to the HTTP MCP transport", "[http]") {
+  constexpr uint16_t port { 18931 };
+  HttpMcpTransport transport("127.0.0.1", port, SERVER_NAME, SERVER_VERSION);
+  transport.setAdmissionLimits({ 1, 1, std::chrono::milliseconds(50) });
+  transport.start([](const json&) { return std::string(R"({"jsonrpc":"2.0","id":1,"result":{}})"); });
+  REQUIRE(waitUntilServing(port, "/health"));
+
+  // Idle connections occupy all threads of the pool (1 in flight, 1 queued and the spare
+  // threads) and the one place in its queue.
+  std::vector<int> idleConnections;
+  for (int connection = 0; connection < 1 + 1 + 4 + 1; ++connection) {
+    const int socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address { };
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    REQUIRE(::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+    idleConnections.push_back(socket);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  httplib::Client client("http://127.0.0.1:" + std::to_string(port));
+  const httplib::Result result = client.Post("/mcp", {},
+    R"({"jsonrpc":"2.0","id":1,"method":"tools/call","params":{"name":"echo"}})",
+    "application/json");
+  REQUIRE(result);
+  REQUIRE(result->status == 503);
+  REQUIRE(result->get_header_value("Retry-After") == "1");
+  REQUIRE(client.Get("/health", {})->status == 200);
+
+  for (const int socket : idleConnections) {
+    ::close(socket);
+  }
+  transport.stop();
+}
+#endif
+
+TEST_CASE("Verifying the compression of responses of the HTTP MCP transport", "[http]") {
+  constexpr uint16_t port { 18934 };
+  const std::string largeText(8 * 1024, 'x');
+  HttpMcpTransport transport("127.0.0.1", port, SERVER_NAME, SERVER_VERSION);
+  transport.setMinCompressedResponseSize(1024);
+  transport.start([&largeText](const json& request) {
+    const json text = request["method"] == "ping" ? json("pong") : json(largeText);
+    return json { {"jsonrpc", "2.0"}, {"id", request["id"]}, {"result", {{"text", text}}} }.dump();
+  });
+  REQUIRE(waitUntilServing(port, "/health"));
+
+  httplib::Client client("http://127.0.0.1:" + std::to_string(port));
+  client.set_decompress(false); // no Accept-Encoding is sent unless it is given explicitly
+  const std::string largeRequest = R"({"jsonrpc":"2.0","id":1,"method":"tools/call"})";
+  const std::string smallRequest = R"({"jsonrpc":"2.0","id":2,"method":"ping"})";
+
+  SECTION("Large responses are compressed in the encoding accepted by the client") {
+    for (const std::string encoding : { "gzip", "zstd" }) {
+      const httplib::Result result = client.Post("/mcp", {{"Accept-Encoding", encoding}},
+        largeRequest, "application/json");
+      REQUIRE(result);
+      REQUIRE(result->status == 200);
+      REQUIRE(result->get_header_value("Content-Encoding") == encoding);
+      REQUIRE(result->get_header_value("Vary") == "Accept-Encoding");
+      REQUIRE(result->body.size() < largeText.size() / 5);
+    }
+  }
+
+  SECTION("Large responses are sent uncompressed with their length if no encoding is accepted") {
+    const httplib::Result result = client.Post("/mcp", {}, largeRequest, "application/json");
+    REQUIRE(result);
+    REQUIRE_FALSE(result->has_header("Content-Encoding"));
+    REQUIRE(result->get_header_value("Content-Length") == std::to_string(result->body.size()));
+    REQUIRE(result->get_header_value("Vary") == "Accept-Encoding");
+    REQUIRE(json::parse(result->body)["result"]["text"] == largeText);
+  }
+
+  SECTION("The headers of large responses depend only on whether gzip is accepted") {
+    const httplib::Result compressed = client.Post("/mcp", {{"Accept-Encoding", "gzip"}},
+      largeRequest, "application/json");
+    REQUIRE(compressed);
+    REQUIRE(compressed->get_header_value("Content-Type") == "application/json");
+    REQUIRE(compressed->get_header_value("Content-Encoding") == "gzip");
+    REQUIRE(compressed->get_header_value("Transfer-Encoding") == "chunked");
+    REQUIRE(compressed->get_header_value("Vary") == "Accept-Encoding");
+    REQUIRE_FALSE(compressed->has_header("Content-Length"));
+
+    for (const std::string acceptEncoding : { "", "identity", "gzip;q=0" }) {
+      const httplib::Result uncompressed = client.Post("/mcp",
+        {{"Accept-Encoding", acceptEncoding}}, largeRequest, "application/json");
+      REQUIRE(uncompressed);
+      REQUIRE(uncompressed->get_header_value("Content-Type") == "application/json");
+      REQUIRE_FALSE(uncompressed->has_header("Content-Encoding"));
+      REQUIRE_FALSE(uncompressed->has_header("Transfer-Encoding"));
+      REQUIRE(uncompressed->get_header_value("Vary") == "Accept-Encoding");
+      REQUIRE(uncompressed->get_header_value("Content-Length") ==
+        std::to_string(uncompressed->body.size()));
+    }
+  }
+
+  SECTION("Responses below the threshold are never compressed") {
+    const httplib::Result result = client.Post("/mcp", {{"Accept-Encoding", "gzip"}},
+      smallRequest, "application/json");
+    REQUIRE(result);
+    REQUIRE_FALSE(result->has_header("Content-Encoding"));
+    REQUIRE_FALSE(result->has_header("Vary"));
+  }
+
+  transport.stop();
+}
+
+TEST_CASE("Verifying the scheduling lanes and tool bulkheads") {
+  MCPServer server { SERVER_NAME, SERVER_VERSION };
+  server.handleRequest(initServerRequest);
+
+  SECTION("Control-plane methods and fast tools are scheduled in the fast lane") {
+    REQUIRE(server.determineLane(initServerRequest.dump()) == RequestLane::fast);
+    REQUIRE(server.determineLane(listAvailableToolsRequest.dump()) == RequestLane::fast);
+    REQUIRE(server.determineLane(R"({"jsonrpc":"2.0","id":1,"method":"tools/call",)"
+      R"("params":{"name":"echo","arguments":{"message":"hi"}}})") == RequestLane::fast);
+    server.registerTool("slow", "Waits for an upstream API.", {{"type", "object"}},
+      [](const json&) -> json { return {{"content", json::array()}}; });
+    REQUIRE(server.determineLane(R"({"jsonrpc":"2.0","id":2,"method":"tools/call",)"
+      R"("params":{"name":"slow"}})") == RequestLane::slow);
+    REQUIRE(server.determineLane(R"({"jsonrpc":"2.0","id":3,"method":"tools/call",)"
+      R"("params":{"name":"unknown"}})") == RequestLane::slow);
+    REQUIRE(server.determineLane("not JSON") == RequestLane::slow);
+  }
+
+  SECTION("Only whitelisted methods are scheduled in the fast lane") {
+    REQUIRE(server.determineLane(R"({"jsonrpc":"2.0","id":4,"method":"ping"})") ==
+      RequestLane::fast);
+    REQUIRE(server.determineLane(R"({"jsonrpc":"2.0","method":"notifications/cancelled"})") ==
+      RequestLane::fast);
+    REQUIRE(server.determineLane(R"({"jsonrpc":"2.0","id":5,"method":"resources/read",)"
+      R"("params":{"uri":"file:///large"}})") == RequestLane::slow);
+    REQUIRE(server.determineLane(R"({"jsonrpc":"2.0","id":6,"method":"unknown/method"})") ==
+      RequestLane::slow);
+  }
+
+  SECTION("Requests are classified by a bounded prefix") {
+    const std::string padding(8192, ' ');
+    REQUIRE(server.determineLane(R"({"jsonrpc":"2.0","id":7,"method":"tools/list","params":{)" +
+      padding + "}}") == RequestLane::fast);
+    REQUIRE(server.determineLane(R"({"jsonrpc":"2.0","id":8,)" + padding +
+      R"("method":"tools/list"})") == RequestLane::slow);
+    REQUIRE(server.determineLane(R"({"jsonrpc":"2.0","id":9,"method":"tools/call",)"
+      R"("params":{"name":"echo","arguments":{"message":")" + std::string(8192, 'x') + R"("}}})") ==
+      RequestLane::fast);
+  }
+
+  SECTION("Fast tasks are executed while all other workers are busy with slow tasks") {
+    WorkerPool workerPool(1, 1);
+    std::promise<void> releaseSlowTask;
+    std::shared_future<void> slowTaskReleased = releaseSlowTask.get_future().share();
+    workerPool.submit([slowTaskReleased] { slowTaskReleased.wait(); });
+    workerPool.submit([slowTaskReleased] { slowTaskReleased.wait(); });
+    std::promise<void> fastTaskDone;
+    workerPool.submit([&fastTaskDone] { fastTaskDone.set_value(); }, RequestLane::fast);
+    REQUIRE(fastTaskDone.get_future().wait_for(std::chrono::seconds(5)) ==
+      std::future_status::ready);
+    releaseSlowTask.set_value();
+    workerPool.shutdown();
+  }
+
+  SECTION("Calls of a tool beyond its bulkhead are rejected") {
+    std::promise<void> releaseCall;
+    std::shared_future<void> callReleased = releaseCall.get_future().share();
+    std::promise<void> callStarted;
+    server.registerTool("heavy", "Runs a heavy query.", {{"type", "object"}},
+      [callReleased, &callStarted](const json&) -> json {
+        callStarted.set_value();
+        callReleased.wait();
+        return {{"content", json::array()}};
+      },
+      ToolAnnotations { true, false, {}, RequestLane::slow, 1 });
+    const json heavyCall = {
+      {"jsonrpc", "2.0"}, {"id", 9}, {"method", "tools/call"}, {"params", {{"name", "heavy"}}}
+    };
+    std::thread firstCall([&server, &heavyCall] { server.handleRequest(heavyCall); });
+    callStarted.get_future().wait();
+    const json rejected = server.handleRequest(heavyCall);
+    releaseCall.set_value();
+    firstCall.join();
+    REQUIRE(rejected["result"]["isError"] == true);
+
+    Bulkhead bulkhead(1);
+    {
+      const Bulkhead::Entry first(&bulkhead);
+      REQUIRE(first.isAdmitted());
+      REQUIRE_FALSE(Bulkhead::Entry(&bulkhead).isAdmitted());
+    }
+    REQUIRE(Bulkhead::Entry(&bulkhead).isAdmitted());
+  }
+}
+
+TEST_CASE("Verifying the balancing of upstream requests across replicas") {
+  UpstreamBalancer balancer({ "http://primary:9000", "http://replica1:9000",
+    "http://replica2:9000" });
+
+  SECTION("Replicas with a lower latency are chosen more often") {
+    std::vector<int> choices(balancer.numberOfReplicas(), 0);
+    for (int request = 0; request < 300; ++request) {
+      UpstreamBalancer::Lease lease = balancer.acquireReplica();
+      const bool isSlowReplica = lease.baseUrl() == "http://replica2:9000";
+      ++choices[isSlowReplica ? 2 : lease.baseUrl() == "http://primary:9000" ? 0 : 1];
+      lease.complete(std::chrono::microseconds(isSlowReplica ? 50000 : 1000), false);
+    }
+    REQUIRE(choices[2] < choices[0]);
+    REQUIRE(choices[2] < choices[1]);
+  }
+
+  SECTION("Failing replicas are ejected and re-admitted by the health check") {
+    for (unsigned int failure = 0; failure < UpstreamBalancer::EJECTION_THRESHOLD * 10;
+      ++failure) {
+      UpstreamBalancer::Lease lease = balancer.acquireReplica();
+      lease.complete(std::chrono::microseconds(1000), lease.baseUrl() == "http://replica1:9000");
+    }
+    REQUIRE(balancer.isEjected(1));
+    for (int request = 0; request < 20; ++request) {
+      UpstreamBalancer::Lease lease = balancer.acquireReplica();
+      REQUIRE(lease.baseUrl() != "http://replica1:9000");
+      lease.complete(std::chrono::microseconds(1000), false);
+    }
+    REQUIRE_FALSE(balancer.isEjected(0));
+
+    balancer.startHealthChecks([](const std::string&) { return true; },
+      std::chrono::milliseconds(5));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (balancer.isEjected(1) && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    REQUIRE_FALSE(balancer.isEjected(1));
+  }
+}
+
+TEST_CASE("Verifying the hedging of slow upstream reads") {
+  HedgingPolicy policy;
+  policy.percentile_ = 90.0;
+  policy.budget_ = 0.125;
+  policy.minDelay_ = std::chrono::milliseconds(1);
+  HedgingController controller(policy);
+
+  SECTION("The delay follows the chosen percentile of the recent latencies") {
+    for (std::size_t read = 0; read < HedgingController::MIN_LATENCIES - 1; ++read) {
+      controller.recordLatency(std::chrono::microseconds(10000));
+    }
+    REQUIRE_FALSE(controller.hedgeDelay().has_value());
+
+    // 90 % of the reads take 10 ms, the others 500 ms.
+    for (std::size_t read = 0; read < HedgingController::LATENCY_WINDOW; ++read) {
+      controller.recordLatency(std::chrono::microseconds(read % 10 == 9 ? 500000 : 10000));
+    }
+    REQUIRE(controller.hedgeDelay() == std::chrono::microseconds(10000));
+
+    for (std::size_t read = 0; read < HedgingController::LATENCY_WINDOW; ++read) {
+      controller.recordLatency(std::chrono::microseconds(200));
+    }
+    REQUIRE(controller.hedgeDelay() == std::chrono::microseconds(1000));
+  }
+
+  SECTION("The budget bounds the number of hedges") {
+    REQUIRE_FALSE(controller.tryToSpendBudget());
+    int hedges { 0 };
+    for (int read = 0; read < 1000; ++read) {
+      controller.recordLatency(std::chrono::microseconds(10000));
+      if (controller.tryToSpendBudget()) {
+        ++hedges;
+      }
+    }
+    REQUIRE(hedges == 125);
+  }
+
+  SECTION("The timer executes the hedges in the order of their deadlines") {
+    std::mutex orderMutex;
+    std::vector<int> order;
+    std::promise<void> done;
+    HedgeTimer timer;
+    const auto now = std::chrono::steady_clock::now();
+    timer.schedule(now + std::chrono::milliseconds(40), [&] {
+      std::lock_guard lock(orderMutex);
+      order.push_back(2);
+      done.set_value();
+    });
+    timer.schedule(now + std::chrono::milliseconds(20), [&] {
+      std::lock_guard lock(orderMutex);
+      order.push_back(1);
+    });
+    timer.schedule(now + std::chrono::hours(1), [&] { FAIL("A dropped task has been executed."); });
+    REQUIRE(done.get_future().wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    std::lock_guard lock(orderMutex);
+    REQUIRE(order == std::vector<int> { 1, 2 });
+  }
+}
+
+TEST_CASE("Verifying the hedging of slow reads from a local upstream server", "[http]") {
+  constexpr int port { 18932 };
+  httplib::Server upstream;
+  std::mutex delaysMutex;
+  std::map<int, std::chrono::milliseconds> delays;
+  int numberOfRequests { 0 };
+  upstream.Get("/items", [&](const httplib::Request&, httplib::Response& response) {
+    std::chrono::milliseconds delay { 0 };
+    {
+      std::lock_guard lock(delaysMutex);
+      if (const auto entry = delays.find(numberOfRequests++); entry != delays.end()) {
+        delay = entry->second;
+      }
+    }
+    std::this_thread::sleep_for(delay);
+    response.set_content(R"({"items":[]})", "application/json");
+  });
+  std::thread serverThread([&upstream] { upstream.listen("127.0.0.1", port); });
+  REQUIRE(waitUntilServing(port, "/items"));
+
+  HedgingPolicy policy;
+  policy.percentile_ = 50.0;
+  policy.budget_ = 1.0;
+  policy.minDelay_ = std::chrono::milliseconds(20);
+  HttpToolClient client;
+  client.hedgeUpstreamReads(policy);
+  const std::string url = "http://127.0.0.1:" + std::to_string(port) + "/items";
+  for (std::size_t read = 0; read < HedgingController::MIN_LATENCIES; ++read) {
+    REQUIRE(client.httpGet(url)["status"] == 200);
+  }
+  const auto delayNextRequests = [&](const std::chrono::milliseconds first,
+    const std::chrono::milliseconds hedge) {
+    std::lock_guard lock(delaysMutex);
+    delays[numberOfRequests] = first;
+    delays[numberOfRequests + 1] = hedge;
+  };
+  ServerMetrics& metrics = ServerMetrics::instance();
+
+  SECTION("The hedge answers a read whose first attempt is slow") {
+    const auto hedgesWon = metrics.upstreamHedgesWon_.value();
+    delayNextRequests(std::chrono::milliseconds(2000), std::chrono::milliseconds(0));
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(client.httpGet(url)["json"]["items"].is_array());
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1000));
+    REQUIRE(metrics.upstreamHedgesWon_.value() == hedgesWon + 1);
+  }
+
+  SECTION("A slow hedge is cancelled once the first attempt has answered") {
+    const auto hedgesLost = metrics.upstreamHedgesLost_.value();
+    delayNextRequests(std::chrono::milliseconds(100), std::chrono::milliseconds(2000));
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(client.httpGet(url)["json"]["items"].is_array());
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1000));
+    // The hedge is done long before the upstream server would have answered it.
+    while (metrics.upstreamHedgesLost_.value() == hedgesLost &&
+      std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1000)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(metrics.upstreamHedgesLost_.value() == hedgesLost + 1);
+  }
+
+  upstream.stop();
+  serverThread.join();
+}
+
+TEST_CASE("Verifying the adaptive limit of concurrent upstream requests") {
+  ConcurrencyLimits limits;
+  limits.initialLimit_ = 4;
+  limits.maxLimit_ = 32;
+  AdaptiveConcurrencyLimiter limiter("http://upstream:9000", limits);
+  const auto sendRequests = [&limiter](const int rounds, const std::chrono::microseconds latency) {
+    for (int round = 0; round < rounds; ++round) {
+      std::vector<AdaptiveConcurrencyLimiter::Permit> permits;
+      while (permits.size() < limiter.limit()) {
+        permits.push_back(limiter.acquire(std::chrono::steady_clock::now()));
+      }
+      for (auto& permit : permits) {
+        permit.complete(latency, false);
+      }
+    }
+  };
+
+  SECTION("The limit grows while the latency is stable and shrinks when it rises") {
+    sendRequests(20, std::chrono::microseconds(10000));
+    const std::size_t grownLimit = limiter.limit();
+    REQUIRE(grownLimit > 4);
+    sendRequests(20, std::chrono::microseconds(100000));
+    REQUIRE(limiter.limit() < grownLimit);
+
+    const std::size_t limitBeforeFailure = limiter.limit();
+    limiter.acquire(std::chrono::steady_clock::now()).complete(std::chrono::microseconds(0), true);
+    REQUIRE(limiter.limit() < limitBeforeFailure);
+  }
+
+  SECTION("Requests beyond the limit wait in the queue until their deadline") {
+    std::vector<AdaptiveConcurrencyLimiter::Permit> permits;
+    for (int request = 0; request < 4; ++request) {
+      permits.push_back(limiter.acquire(std::chrono::steady_clock::now()));
+      REQUIRE(permits.back().isAcquired());
+    }
+    REQUIRE_FALSE(limiter.acquire(std::chrono::steady_clock::now() +
+      std::chrono::milliseconds(10)).isAcquired());
+
+    auto waitingRequest = std::async(std::launch::async, [&limiter] {
+      return limiter.acquire(std::chrono::steady_clock::now() + std::chrono::seconds(5))
+        .isAcquired();
+    });
+    while (limiter.numberOfQueuedRequests() == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    permits.front().complete(std::chrono::microseconds(10000), false);
+    REQUIRE(waitingRequest.get());
+  }
+
+  SECTION("Hedges only take a free permit, and abandoned permits leave the limit as it is") {
+    std::vector<AdaptiveConcurrencyLimiter::Permit> permits;
+    for (int request = 0; request < 4; ++request) {
+      permits.push_back(limiter.tryAcquire());
+      REQUIRE(permits.back().isAcquired());
+    }
+    REQUIRE_FALSE(limiter.tryAcquire().isAcquired());
+    permits.front().abandon();
+    REQUIRE(limiter.numberOfRequestsInFlight() == 3);
+    REQUIRE(limiter.limit() == 4);
+    REQUIRE(limiter.tryAcquire().isAcquired());
+  }
+
+  SECTION("A shift of the traffic to a slower endpoint does not shrink the limit") {
+    for (int round = 0; round < 20; ++round) {
+      std::vector<AdaptiveConcurrencyLimiter::Permit> permits;
+      while (permits.size() < limiter.limit()) {
+        permits.push_back(limiter.acquire(std::chrono::steady_clock::now()));
+      }
+      for (std::size_t request = 0; request < permits.size(); ++request) {
+        const bool isSlow = round >= 10 || request % 2 == 1;
+        permits[request].complete(std::chrono::microseconds(isSlow ? 100000 : 10000), false,
+          isSlow ? "/projects/{id}/commits" : "/projects");
+      }
+    }
+    REQUIRE(limiter.limit() > 4);
+  }
+}
+
+TEST_CASE("Verifying the gzip compression of request bodies") {
+  std::string body = R"({"@type":"Commit","change":[)";
+  for (int element = 0; element < 200; ++element) {
+    body += R"({"@type":"DataVersion","payload":{"@type":"PartUsage","name":"part)" +
+      std::to_string(element) + R"("}},)";
+  }
+  body += "{}]}";
+  const std::string compressed = compressWithGzip(body);
+  REQUIRE(compressed.size() < body.size() / 5);
+  REQUIRE(static_cast<unsigned char>(compressed[0]) == 0x1f);
+  REQUIRE(static_cast<unsigned char>(compressed[1]) == 0x8b);
+
+  z_stream stream { };
+  REQUIRE(inflateInit2(&stream, MAX_WBITS + 16) == Z_OK);
+  std::string decompressed(body.size(), '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  stream.avail_in = static_cast<uInt>(compressed.size());
+  stream.next_out = reinterpret_cast<Bytef*>(decompressed.data());
+  stream.avail_out = static_cast<uInt>(decompressed.size());
+  REQUIRE(inflate(&stream, Z_FINISH) == Z_STREAM_END);
+  inflateEnd(&stream);
+  REQUIRE(decompressed == body);
+}
+
+TEST_CASE("Verifying the decompression of upstream responses", "[http]") {
+  constexpr int port { 18935 };
+  const std::string largeBody = json { {"items", std::vector<std::string>(1000, "element")} }.dump();
+  httplib::Server upstream;
+  std::string acceptedEncodings;
+  upstream.Get("/items", [&](const httplib::Request& request, httplib::Response& response) {
+    acceptedEncodings = request.get_header_value("Accept-Encoding");
+    response.set_content(largeBody, "application/json"); // compressed as accepted by the client
+  });
+  std::thread serverThread([&upstream] { upstream.listen("127.0.0.1", port); });
+  REQUIRE(waitUntilServing(port, "/items"));
+
+  const auto recordFileName = (std::filesystem::temp_directory_path() /
+    "mcpservertest_decompression.rec").string();
+  const std::string url = "http://127.0.0.1:" + std::to_string(port) + "/items";
+  {
+    HttpToolClient client;
+    client.recordUpstreamTraffic(std::make_shared<UpstreamTrafficRecorder>(recordFileName));
+    const json response = client.httpGet(url);
+    REQUIRE(acceptedEncodings.find("gzip") != std::string::npos);
+    REQUIRE(acceptedEncodings.find("zstd") != std::string::npos);
+    REQUIRE(response["status"] == 200);
+    REQUIRE(response["body"] == largeBody);
+    REQUIRE_FALSE(response["headers"].contains("Content-Encoding"));
+    REQUIRE_FALSE(response["headers"].contains("Content-Length"));
+
+    for (const std::string encoding : { "gzip", "zstd" }) {
+      REQUIRE(client.httpGet(url, { {"Accept-Encoding", encoding} })["body"] == largeBody);
+    }
+  }
+
+  const UpstreamTrafficReplayer replayer(recordFileName, { });
+  UpstreamResponse recorded;
+  REQUIRE(replayer.replay("GET", "/items", "", recorded));
+  REQUIRE(recorded.body_ == largeBody);
+  REQUIRE(recorded.headers_.find("Content-Encoding") == recorded.headers_.end());
+  REQUIRE(recorded.headers_.find("Content-Length") == recorded.headers_.end());
+
+  upstream.stop();
+  serverThread.join();
+}
+
+TEST_CASE("Verifying the recording and replay of upstream traffic") {
+  const auto recordFileName = (std::filesystem::temp_directory_path() / "mcpservertest_upstream.rec").string();
+  const auto truncatedFileName = (std::filesystem::temp_directory_path() / "mcpservertest_upstream_truncated.rec").string();
+  {
+    UpstreamTrafficRecorder recorder(recordFileName);
+    recorder.record("GET", "/projects", "", { 200, { { "Content-Type", "application/json" } },
+      R"([{"@id":"p1"}])" }, std::chrono::microseconds(1500));
+    recorder.record("GET", "/projects", "", { 503, { }, "busy" }, std::chrono::microseconds(10));
+    recorder.record("POST", "/projects/p1/query-results", R"({"q":1})", { 200, { }, "[]" },
+      std::chrono::microseconds(20));
+    // Records are complete on disk before the index is written by the destructor.
+    std::filesystem::copy_file(recordFileName, truncatedFileName,
+      std::filesystem::copy_options::overwrite_existing);
+  }
+
+  SECTION("Responses are replayed per request in the recorded order") {
+    const UpstreamTrafficReplayer replayer(recordFileName, { });
+    REQUIRE(replayer.numberOfExchanges() == 3);
+    UpstreamResponse response;
+    REQUIRE(replayer.replay("GET", "/projects", "", response));
+    REQUIRE(response.status_ == 200);
+    REQUIRE(response.body_ == R"([{"@id":"p1"}])");
+    REQUIRE(response.headers_.find("Content-Type")->second == "application/json");
+    REQUIRE(replayer.replay("GET", "/projects", "", response));
+    REQUIRE(response.status_ == 503);
+    REQUIRE(replayer.replay("GET", "/projects", "", response));
+    REQUIRE(response.status_ == 200);
+    REQUIRE(replayer.replay("POST", "/projects/p1/query-results", R"({"q":1})", response));
+    REQUIRE(response.body_ == "[]");
+    REQUIRE_FALSE(replayer.replay("POST", "/projects/p1/query-results", R"({"q":2})", response));
+  }
+
+  SECTION("A recording without index is read up to its last complete record") {
+    std::filesystem::resize_file(truncatedFileName,
+      std::filesystem::file_size(truncatedFileName) - 1);
+    const UpstreamTrafficReplayer replayer(truncatedFileName, { });
+    REQUIRE(replayer.numberOfExchanges() == 2);
+  }
+
+  SECTION("The HTTP tool client answers requests from the replayer without network access") {
+    HttpToolClient client;
+    client.replayUpstreamTraffic(std::make_shared<UpstreamTrafficReplayer>(recordFileName,
+      UpstreamTrafficReplayer::Latency { false, std::chrono::milliseconds(1) }));
+    const json response = client.httpGet("http://upstream.invalid:9000/projects");
+    REQUIRE(response["status"] == 200);
+    REQUIRE(response["json"][0]["@id"] == "p1");
+    const json missing = client.httpGet("http://upstream.invalid:9000/projects/p2");
+    REQUIRE(missing["error"] == true);
+  }
+
+  std::filesystem::remove(recordFileName);
+  std::filesystem::remove(truncatedFileName);
+}
+
+TEST_CASE("Verifying the splitting of newline-delimited frames") {
+  LineFramer framer;
+  std::vector<std::string> frames;
+  const auto collectFrames = [&frames](const std::string_view frame) {
+    frames.emplace_back(frame);
+  };
+  const std::string input { "{\"id\":1}\r\n\n{\"id\":2}\n{\"id\":3}" };
+  for (const char character : input) {
+    framer.append(&character, 1);
+    framer.extractFrames(collectFrames);
+  }
+  REQUIRE(frames == std::vector<std::string> { "{\"id\":1}", "{\"id\":2}" });
+  REQUIRE(framer.bufferedSize() == 8);
+  framer.finish();
+  framer.extractFrames(collectFrames);
+  REQUIRE(frames.back() == "{\"id\":3}");
+  REQUIRE(framer.bufferedSize() == 0);
+}
+
+TEST_CASE("Verifying the pipelined stdin/stdout MCP transport") {
+  SECTION("The response queue keeps the elements of concurrent producers in their order") {
+    constexpr int numberOfProducers { 4 };
+    constexpr int elementsPerProducer { 10000 };
+    MpscQueue<std::pair<int, int>> queue;
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < numberOfProducers; ++producer) {
+      producers.emplace_back([&queue, producer] {
+        for (int element = 0; element < elementsPerProducer; ++element) {
+          queue.push({ producer, element });
+        }
+      });
+    }
+    std::thread closer([&] {
+      for (auto& producer : producers) {
+        producer.join();
+      }
+      queue.close();
+    });
+
+    std::vector<int> nextElements(numberOfProducers, 0);
+    int numberOfElements { 0 };
+    bool isOrdered { true };
+    while (const auto element = queue.waitAndPop()) {
+      isOrdered = isOrdered && element->second == nextElements[element->first]++;
+      ++numberOfElements;
+    }
+    closer.join();
+    REQUIRE(isOrdered);
+    REQUIRE(numberOfElements == numberOfProducers * elementsPerProducer);
+    REQUIRE_FALSE(queue.tryPop());
+  }
+
+  SECTION("Responses are written in completion order and keep the ids of their requests") {
+    std::istringstream input(
+      R"({"jsonrpc":"2.0","id":1,"method":"slow","params":{"tag":"first"}})" "\n"
+      R"({"jsonrpc":"2.0","id":2,"method":"fast","params":{"tag":"second"}})" "\n");
+    std::ostringstream output;
+    std::streambuf* const stdinBuffer = std::cin.rdbuf(input.rdbuf());
+    std::streambuf* const stdoutBuffer = std::cout.rdbuf(output.rdbuf());
+    {
+      StdinStdoutMcpTransport transport(2);
+      transport.start([](const json& request) {
+        if (request["method"] == "slow") {
+          std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+        return json { {"jsonrpc", "2.0"}, {"id", request["id"]},
+          {"result", {{"tag", request["params"]["tag"]}}} }.dump();
+      });
+      const auto start = std::chrono::steady_clock::now();
+      while (transport.isRunning() &&
+        std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      transport.stop();
+    }
+    std::cin.rdbuf(stdinBuffer);
+    std::cout.rdbuf(stdoutBuffer);
+
+    std::istringstream responses(output.str());
+    std::vector<json> lines;
+    for (std::string line; std::getline(responses, line); ) {
+      lines.push_back(json::parse(line));
+    }
+    REQUIRE(lines.size() == 2);
+    REQUIRE(lines[0]["id"] == 2);
+    REQUIRE(lines[0]["result"]["tag"] == "second");
+    REQUIRE(lines[1]["id"] == 1);
+    REQUIRE(lines[1]["result"]["tag"] == "first");
+  }
+}
+
+#ifdef __linux__
+TEST_CASE("Verifying the connection handling of the epoll HTTP MCP transport") {
+  constexpr uint16_t port { 18933 };
+  EpollHttpMcpTransport transport("127.0.0.1", port, SERVER_NAME, SERVER_VERSION, 2);
+  transport.start([](const json& request) {
+    return json { {"jsonrpc", "2.0"}, {"id", request["id"]}, {"result", json::object()} }.dump();
+  });
+  const int socket = connectToLocalPort(port);
+  REQUIRE(socket >= 0);
+
+  SECTION("Pipelined requests are answered although the client has shut down its side") {
+    std::string requests;
+    for (int id = 1; id <= 2; ++id) {
+      const std::string body = R"({"jsonrpc":"2.0","id":)" + std::to_string(id) +
+        R"(,"method":"ping"})";
+      requests += "POST /mcp HTTP/1.1\r\nHost: localhost\r\nContent-Length: " +
+        std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+    REQUIRE(::send(socket, requests.data(), requests.size(), 0) ==
+      static_cast<ssize_t>(requests.size()));
+    ::shutdown(socket, SHUT_WR);
+    const std::string responses = receiveUntilClosed(socket);
+    REQUIRE(countOccurrences(responses, "HTTP/1.1 200 OK") == 2);
+    REQUIRE(responses.find(R"("id":1)") < responses.find(R"("id":2)"));
+  }
+
+  SECTION("A request whose body exceeds the maximum size is rejected with 413") {
+    const std::string request = "POST /mcp HTTP/1.1\r\nHost: localhost\r\nContent-Length: " +
+      std::to_string(HttpRequestParser::MAX_BODY_SIZE + 1) + "\r\n\r\n";
+    REQUIRE(::send(socket, request.data(), request.size(), 0) ==
+      static_cast<ssize_t>(request.size()));
+    REQUIRE(receiveUntilClosed(socket).starts_with("HTTP/1.1 413 Payload Too Large"));
+  }
+
+  SECTION("Thousands of pipelined requests are answered, more than fit into the output buffer") {
+    constexpr std::size_t numberOfRequests { 5000 };
+    std::string requests;
+    for (std::size_t index = 0; index < numberOfRequests; ++index) {
+      requests += "GET /health HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    }
+    // The server stops reading while the responses are not read, so they are sent concurrently.
+    std::thread sender([socket, &requests]() {
+      ::send(socket, requests.data(), requests.size(), MSG_NOSIGNAL);
+      ::shutdown(socket, SHUT_WR);
+    });
+    const std::string responses = receiveUntilClosed(socket);
+    sender.join();
+    REQUIRE(countOccurrences(responses, "HTTP/1.1 200 OK") == numberOfRequests);
+  }
+
+  ::close(socket);
+  transport.stop();
+}
+#endif
+
+#ifdef __linux__
+TEST_CASE("Verifying the round trip through the Unix domain socket transport") {
+  const std::string socketPath = "/tmp/sysmlv2mcp-test-" + std::to_string(::getpid()) + ".sock";
+  const McpRequestHandler requestHandler = [](const json& request) {
+    if (! request.contains("id"))
+      return std::string();
+    return json { {"jsonrpc", "2.0"}, {"id", request["id"]}, {"result", json::object()} }.dump();
+  };
+
+  SECTION("All frames are answered although the client has shut down its side") {
+    UnixSocketMcpTransport transport(socketPath, {}, 2);
+    transport.start(requestHandler);
+    const int socket = connectToUnixSocket(socketPath);
+    REQUIRE(socket >= 0);
+
+    const std::string frames =
+      R"({"jsonrpc":"2.0","id":1,"method":"ping"})" "\n"
+      R"({"jsonrpc":"2.0","method":"notifications/initialized"})" "\n"
+      R"({"jsonrpc":"2.0","id":2,"method":"ping"})";
+    REQUIRE(::send(socket, frames.data(), frames.size(), 0) == static_cast<ssize_t>(frames.size()));
+    ::shutdown(socket, SHUT_WR);
+    const std::string responses = receiveUntilClosed(socket);
+    REQUIRE(countOccurrences(responses, "\n") == 2);
+    REQUIRE(responses.find(R"("id":1)") != std::string::npos);
+    REQUIRE(responses.find(R"("id":2)") != std::string::npos);
+
+    ::close(socket);
+    transport.stop();
+  }
+
+  SECTION("More frames than may be pending at once are all answered") {
+    UnixSocketMcpTransport transport(socketPath, {}, 2);
+    transport.start(requestHandler);
+    const int socket = connectToUnixSocket(socketPath);
+    REQUIRE(socket >= 0);
+
+    constexpr std::size_t numberOfFrames { 2000 };
+    std::string frames;
+    for (std::size_t id = 1; id <= numberOfFrames; ++id) {
+      frames += R"({"jsonrpc":"2.0","id":)" + std::to_string(id) + R"(,"method":"ping"})" "\n";
+    }
+    // The server stops reading while responses are pending, so the frames are sent concurrently.
+    std::thread sender([socket, &frames]() {
+      ::send(socket, frames.data(), frames.size(), MSG_NOSIGNAL);
+      ::shutdown(socket, SHUT_WR);
+    });
+    const std::string responses = receiveUntilClosed(socket);
+    sender.join();
+    REQUIRE(countOccurrences(responses, "\n") == numberOfFrames);
+
+    ::close(socket);
+    transport.stop();
+  }
+
+  SECTION("Peers running as a user that is not allowed are rejected") {
+    UnixSocketMcpTransport transport(socketPath,
+      UnixSocketMcpTransport::allowUids({ ::geteuid() + 1 }), 2);
+    transport.start(requestHandler);
+    const int socket = connectToUnixSocket(socketPath);
+    REQUIRE(socket >= 0);
+
+    const std::string frame = R"({"jsonrpc":"2.0","id":1,"method":"ping"})" "\n";
+    ::send(socket, frame.data(), frame.size(), MSG_NOSIGNAL);
+    REQUIRE(receiveUntilClosed(socket).empty());
+
+    ::close(socket);
+    transport.stop();
+  }
+}
+#endif
+
+TEST_CASE("Verifying the incremental HTTP/1.1 request parser") {
+  const HttpRequestParser parser;
+
+  SECTION("A request split over several reads is parsed once it is complete") {
+    std::string buffer { "POST /mcp HTTP/1.1\r\nHost: localhost\r\nContent-Length: 2\r\n" };
+    HttpRequest request;
+    REQUIRE(parser.parse(buffer, request) == HttpRequestParser::Status::incomplete);
+    buffer += "\r\n{}GET /health HTTP/1.1\r\n\r\n";
+    REQUIRE(parser.parse(buffer, request) == HttpRequestParser::Status::complete);
+    REQUIRE(request.method_ == "POST");
+    REQUIRE(request.target_ == "/mcp");
+    REQUIRE(request.body_ == "{}");
+    REQUIRE(request.keepAlive());
+    REQUIRE(buffer == "GET /health HTTP/1.1\r\n\r\n");
+  }
+
+  SECTION("Pipelined requests are parsed one after another from unchanged input") {
+    const std::string_view input { "GET /health HTTP/1.1\r\n\r\nGET /info HTTP/1.0\r\n\r\n" };
+    HttpRequest request;
+    std::size_t requestSize { 0 };
+    REQUIRE(parser.parse(input, request, requestSize) == HttpRequestParser::Status::complete);
+    REQUIRE(request.target_ == "/health");
+    REQUIRE(requestSize == input.find("GET /info"));
+    REQUIRE(parser.parse(input.substr(requestSize), request, requestSize) ==
+      HttpRequestParser::Status::complete);
+    REQUIRE(request.target_ == "/info");
+    REQUIRE_FALSE(request.keepAlive());
+  }
+
+  SECTION("A malformed request line is rejected") {
+    std::string buffer { "GARBAGE\r\n\r\n" };
+    HttpRequest request;
+    REQUIRE(parser.parse(buffer, request) == HttpRequestParser::Status::error);
+  }
+
+  SECTION("A body beyond the maximum size is too large, a header beyond it is malformed") {
+    std::string buffer { "POST /mcp HTTP/1.1\r\nContent-Length: 99999999999999999999\r\n\r\n" };
+    HttpRequest request;
+    REQUIRE(parser.parse(buffer, request) == HttpRequestParser::Status::tooLarge);
+    buffer = "GET / HTTP/1.1\r\nX-Padding: " + std::string(HttpRequestParser::MAX_HEADER_SIZE, 'x') +
+      "\r\n\r\n";
+    REQUIRE(parser.parse(buffer, request) == HttpRequestParser::Status::error);
+  }
+}
+
+TEST_CASE("Verifying the synthetic model of the SysML v2 API stand-in") {
+  SyntheticModelOptions options;
+  options.numberOfProjects_ = 2;
+  options.numberOfElements_ = 100;
+  options.depth_ = 3;
+  options.fanOut_ = 4;
+  options.numberOfCommits_ = 6;
+  options.changeRate_ = 20;
+  const SyntheticModel model(options);
+
+  SECTION("The containment tree is limited by depth and fan-out") {
+    REQUIRE(model.numberOfRoots() == 4);
+    REQUIRE(model.numberOfElements() == 4 + 16 + 64);
+    const nlohmann::json root = model.renderElement(0, 0, 0);
+    REQUIRE(root["owner"].is_null());
+    REQUIRE(root["ownedElement"].size() == 4);
+    REQUIRE(model.renderElement(0, 0, 83)["ownedElement"].empty());
+  }
+
+  SECTION("Identifiers are resolved within their project only") {
+    REQUIRE(model.findElement(0, model.elementId(0, 42)) == 42);
+    REQUIRE_FALSE(model.findElement(1, model.elementId(0, 42)));
+    REQUIRE_FALSE(model.findElement(0, model.elementId(0, 84)));
+    REQUIRE(model.findProject(model.projectId(1)) == 1);
+    REQUIRE_FALSE(model.findProject(model.commitId(0, 1)));
+    REQUIRE(model.findCommit(1, model.commitId(1, 5)) == 5);
+    REQUIRE_FALSE(model.findCommit(1, model.commitId(1, 6)));
+  }
+
+  SECTION("Diffs contain exactly the elements that have a new revision") {
+    const auto changedElements = model.determineChangedElements(0, 5);
+    REQUIRE_FALSE(changedElements.empty());
+    for (std::size_t element = 0; element < model.numberOfElements(); ++element) {
+      const bool isChanged = std::ranges::find(changedElements, element) != changedElements.end();
+      REQUIRE(isChanged == (model.revisionOf(element, 5) > 0));
+      REQUIRE(isChanged == (model.renderElement(0, 0, element)["name"] !=
+        model.renderElement(0, 5, element)["name"]));
+    }
+  }
+
+  SECTION("Queries with a primitive constraint select the matching elements") {
+    const nlohmann::json query = {
+      {"@type", "Query"},
+      {"where", {{"@type", "PrimitiveConstraint"}, {"property", "@type"}, {"operator", "="},
+        {"value", "PartDefinition"}}}
+    };
+    REQUIRE(model.evaluateQuery(0, query).size() == 16);
+    REQUIRE(model.evaluateQuery(0, {{"@type", "Query"}}).size() == model.numberOfElements());
+  }
+}
+
+TEST_CASE("Verifying the latency histogram of the load generator") {
+  SECTION("Small values are counted exactly") {
+    LatencyHistogram histogram;
+    for (std::uint64_t value = 1; value <= 100; ++value) {
+      histogram.record(value);
+    }
+    REQUIRE(histogram.count() == 100);
+    REQUIRE(histogram.valueAtPercentile(50.0) == 50);
+    REQUIRE(histogram.valueAtPercentile(99.0) == 99);
+    REQUIRE(histogram.valueAtPercentile(100.0) == 100);
+  }
+
+  SECTION("Percentiles of large values are off by less than 1 %") {
+    LatencyHistogram histogram;
+    LatencyHistogram otherHistogram;
+    for (std::uint64_t value = 1; value <= 100000; ++value) {
+      (value % 2 == 0 ? histogram : otherHistogram).record(value * 10);
+    }
+    histogram.merge(otherHistogram);
+    REQUIRE(histogram.count() == 100000);
+    REQUIRE(histogram.max() == 1000000);
+    for (const double percentile : { 50.0, 90.0, 99.0, 99.9 }) {
+      const double exactValue = percentile * 10000.0;
+      const double error = static_cast<double>(histogram.valueAtPercentile(percentile)) -
+        exactValue;
+      REQUIRE(error >= 0.0);
+      REQUIRE(error < exactValue / 100.0);
+    }
+  }
 }